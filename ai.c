@@ -0,0 +1,1001 @@
+#include "ai.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "thread.h"
+
+#define AI_INF 1000000
+#define AI_LEAF_BITS 14
+
+enum {
+    TT_EXACT = 0,
+    TT_LOWER = 1,
+    TT_UPPER = 2
+};
+
+struct AiEntry {
+    unsigned long long key;
+    AiAction move;
+    int score;
+    int depth;
+    int flag;
+};
+
+/* The parts of the evaluation that depend only on pawns and walls. */
+struct AiLeaf {
+    unsigned long long key;
+    int path;
+    int mobility;
+};
+
+/* Per-ply scratch for the magic search: a board for outcomes that clear
+ * the walls, and the last action list, which the outcomes of one chance
+ * node share since they leave the same pawns and walls. */
+struct AiPly {
+    Game board;
+    unsigned long long key;
+    int count;
+    AiAction actions[AI_MAX_ACTIONS];
+};
+
+static const int step_dr[4] = {-1, 1, 0, 0};
+static const int step_dc[4] = {0, 0, -1, 1};
+
+void ai_default_config(AiConfig *cfg) {
+    if (!cfg) return;
+    cfg->depth = 4;
+    cfg->node_limit = 200000;
+    cfg->time_limit_ms = 3000;
+    cfg->max_walls = 24;
+    cfg->table_bits = 18;
+    cfg->magic = 0;
+    cfg->weights[AI_TERM_PATH] = 10;
+    cfg->weights[AI_TERM_WALLS] = 0;
+    cfg->weights[AI_TERM_MOBILITY] = 0;
+    cfg->weights[AI_TERM_BLOCKED] = 0;
+    cfg->weights[AI_TERM_TEMPO] = 5;
+}
+
+static const char *const term_names[AI_EVAL_TERMS] = {"path", "walls", "mobility", "blocked", "tempo"};
+
+const char *ai_term_name(int term) {
+    if (term < 0 || term >= AI_EVAL_TERMS) return "";
+    return term_names[term];
+}
+
+/* Weight file: one "name value" pair per line. Terms not listed keep
+ * their current weight. */
+int ai_load_weights(AiConfig *cfg, const char *path) {
+    FILE *fp;
+    char name[32];
+    int value;
+    int seen = 0;
+    int i;
+
+    if (!cfg || !path) return 0;
+    fp = fopen(path, "r");
+    if (!fp) return 0;
+    while (fscanf(fp, "%31s %d", name, &value) == 2) {
+        for (i = 0; i < AI_EVAL_TERMS; i++) {
+            if (strcmp(name, term_names[i]) != 0) continue;
+            cfg->weights[i] = value;
+            seen++;
+        }
+    }
+    fclose(fp);
+    return seen > 0;
+}
+
+int ai_save_weights(const int *weights, const char *path) {
+    FILE *fp;
+    int i;
+    if (!weights || !path) return 0;
+    fp = fopen(path, "w");
+    if (!fp) return 0;
+    for (i = 0; i < AI_EVAL_TERMS; i++) fprintf(fp, "%s %d\n", term_names[i], weights[i]);
+    return fclose(fp) == 0;
+}
+
+int ai_init(Ai *ai, const AiConfig *cfg) {
+    size_t entries;
+    if (!ai) return 0;
+    memset(ai, 0, sizeof(*ai));
+    game_init(&ai->work);
+    impact_init(&ai->impact);
+    race_init(&ai->race);
+    if (cfg) {
+        ai->cfg = *cfg;
+    } else {
+        ai_default_config(&ai->cfg);
+    }
+    if (ai->cfg.table_bits < 10) ai->cfg.table_bits = 10;
+    if (ai->cfg.table_bits > 26) ai->cfg.table_bits = 26;
+    if (ai->cfg.max_walls > AI_MAX_ACTIONS - 16) ai->cfg.max_walls = AI_MAX_ACTIONS - 16;
+
+    entries = (size_t)1 << ai->cfg.table_bits;
+    ai->table = (AiEntry *)calloc(entries, sizeof(AiEntry));
+    if (!ai->table) return 0;
+    ai->table_mask = entries - 1;
+    return 1;
+}
+
+void ai_free(Ai *ai) {
+    int i;
+    if (!ai) return;
+    free(ai->table);
+    free(ai->dist);
+    free(ai->queue);
+    game_free(&ai->work);
+    impact_free(&ai->impact);
+    race_free(&ai->race);
+    for (i = 0; i < ai->chance_cap; i++) game_free(&ai->chance[i].board);
+    free(ai->chance);
+    free(ai->leaves);
+    ai->chance = NULL;
+    ai->leaves = NULL;
+    ai->chance_cap = 0;
+    ai->table = NULL;
+    ai->dist = NULL;
+    ai->queue = NULL;
+    ai->scratch_cells = 0;
+}
+
+void ai_clear_table(Ai *ai) {
+    if (!ai || !ai->table) return;
+    memset(ai->table, 0, (ai->table_mask + 1) * sizeof(AiEntry));
+}
+
+static int ensure_scratch(Ai *ai, int size) {
+    int cells = size * size;
+    int *dist;
+    int *queue;
+    if (cells <= ai->scratch_cells) return 1;
+    dist = (int *)malloc(sizeof(int) * 2 * (size_t)cells);
+    queue = (int *)malloc(sizeof(int) * (size_t)cells);
+    if (!dist || !queue) {
+        free(dist);
+        free(queue);
+        return 0;
+    }
+    free(ai->dist);
+    free(ai->queue);
+    ai->dist = dist;
+    ai->queue = queue;
+    ai->scratch_cells = cells;
+    return 1;
+}
+
+static void distance_field(Ai *ai, const Game *g, int player, int *dist) {
+    int n = g->size;
+    int head = 0;
+    int tail = 0;
+    int r;
+    int c;
+    int i;
+
+    for (i = 0; i < n * n; i++) dist[i] = -1;
+    for (r = 0; r < n; r++) {
+        for (c = 0; c < n; c++) {
+            if (!game_is_goal(g, player, r, c)) continue;
+            dist[r * n + c] = 0;
+            ai->queue[tail++] = r * n + c;
+        }
+    }
+
+    while (head < tail) {
+        int cell = ai->queue[head++];
+        int cr = cell / n;
+        int cc = cell % n;
+        for (i = 0; i < 4; i++) {
+            int nr = cr + step_dr[i];
+            int nc = cc + step_dc[i];
+            if (game_is_blocked(g, cr, cc, nr, nc)) continue;
+            if (dist[nr * n + nc] >= 0) continue;
+            dist[nr * n + nc] = dist[cell] + 1;
+            ai->queue[tail++] = nr * n + nc;
+        }
+    }
+}
+
+static int path_length(Ai *ai, const Game *g, int player) {
+    int n = g->size;
+    int *seen = ai->dist;
+    Pos start = g->players[player];
+    int head = 0;
+    int tail = 0;
+    int i;
+
+    for (i = 0; i < n * n; i++) seen[i] = -1;
+    seen[start.row * n + start.col] = 0;
+    ai->queue[tail++] = start.row * n + start.col;
+
+    while (head < tail) {
+        int cell = ai->queue[head++];
+        int cr = cell / n;
+        int cc = cell % n;
+        if (game_is_goal(g, player, cr, cc)) return seen[cell];
+        for (i = 0; i < 4; i++) {
+            int nr = cr + step_dr[i];
+            int nc = cc + step_dc[i];
+            if (game_is_blocked(g, cr, cc, nr, nc)) continue;
+            if (seen[nr * n + nc] >= 0) continue;
+            seen[nr * n + nc] = seen[cell] + 1;
+            ai->queue[tail++] = nr * n + nc;
+        }
+    }
+    return n * n;
+}
+
+int ai_path_length(Ai *ai, const Game *g, int player) {
+    if (!ai || !g || player < 0 || player >= PLAYER_COUNT) return 0;
+    if (!ensure_scratch(ai, g->size)) return 0;
+    return path_length(ai, g, player);
+}
+
+static int mobility(const Game *g, int player) {
+    Pos moves[16];
+    return game_list_moves(g, player, moves, 16);
+}
+
+static void eval_features(Ai *ai, const Game *g, int player, int *f, int with_mobility) {
+    int other = 1 - player;
+    f[AI_TERM_PATH] = path_length(ai, g, other) - path_length(ai, g, player);
+    f[AI_TERM_WALLS] = g->walls_left[player] - g->walls_left[other];
+    f[AI_TERM_MOBILITY] = with_mobility ? mobility(g, player) - mobility(g, other) : 0;
+    f[AI_TERM_BLOCKED] = g->blocked_turns[other] - g->blocked_turns[player];
+    f[AI_TERM_TEMPO] = 1;
+}
+
+int ai_eval_features(Ai *ai, const Game *g, int player, int *features) {
+    if (!ai || !g || !features || player < 0 || player >= PLAYER_COUNT) return 0;
+    if (!ensure_scratch(ai, g->size)) return 0;
+    eval_features(ai, g, player, features, 1);
+    return 1;
+}
+
+int ai_evaluate(Ai *ai, const Game *g, int player) {
+    int f[AI_EVAL_TERMS];
+    int score = 0;
+    int i;
+    if (!ai || !g || !ensure_scratch(ai, g->size)) return 0;
+    eval_features(ai, g, player, f, ai->cfg.weights[AI_TERM_MOBILITY] != 0);
+    for (i = 0; i < AI_EVAL_TERMS; i++) score += ai->cfg.weights[i] * f[i];
+    return score;
+}
+
+static unsigned long long mix64(unsigned long long x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+static unsigned long long pawn_key(int player, Pos p) {
+    return mix64((1ULL << 60) ^ ((unsigned long long)player << 48) ^
+                 ((unsigned long long)p.row << 24) ^ (unsigned long long)p.col);
+}
+
+static unsigned long long wall_key(int row, int col, WallDir dir) {
+    return mix64((2ULL << 60) ^ ((unsigned long long)dir << 48) ^
+                 ((unsigned long long)row << 24) ^ (unsigned long long)col);
+}
+
+static unsigned long long board_key(const Game *g) {
+    unsigned long long key = mix64((5ULL << 60) ^ (unsigned long long)g->size);
+    int r;
+    int c;
+    int i;
+    for (i = 0; i < PLAYER_COUNT; i++) key ^= pawn_key(i, g->players[i]);
+    for (r = 0; r < g->size - 1; r++) {
+        for (c = 0; c < g->size - 1; c++) {
+            if (game_wall_at(g, r, c, DIR_H)) key ^= wall_key(r, c, DIR_H);
+            if (game_wall_at(g, r, c, DIR_V)) key ^= wall_key(r, c, DIR_V);
+        }
+    }
+    return key;
+}
+
+/* With the walls weight at 0, wall counts above what a side can still
+ * place within the search horizon cannot change the result, so they are
+ * clamped before hashing. A nonzero walls weight scores the full counts,
+ * and a search that plays magic can lose walls on the way, so either one
+ * hashes them all; pondering with magic then covers the counters the draw
+ * can leave through ai_ponder. */
+static unsigned long long node_key(const Ai *ai, const Game *g, int side, unsigned long long board) {
+    int exact = ai->cfg.magic || ai->cfg.weights[AI_TERM_WALLS] != 0;
+    int cap = exact ? g->walls_left[0] + g->walls_left[1] : (ai->cfg.depth + 1) / 2;
+    unsigned long long key = board ^ mix64((4ULL << 60) ^ (unsigned long long)side);
+    int i;
+    for (i = 0; i < PLAYER_COUNT; i++) {
+        int walls = g->walls_left[i] < cap ? g->walls_left[i] : cap;
+        key ^= mix64((3ULL << 60) ^ ((unsigned long long)i << 48) ^
+                     ((unsigned long long)walls << 24) ^ (unsigned long long)g->blocked_turns[i]);
+    }
+    return key;
+}
+
+static int score_to_table(int score, int ply) {
+    if (score > AI_WIN_BOUND) return score + ply;
+    if (score < -AI_WIN_BOUND) return score - ply;
+    return score;
+}
+
+static int score_from_table(int score, int ply) {
+    if (score > AI_WIN_BOUND) return score - ply;
+    if (score < -AI_WIN_BOUND) return score + ply;
+    return score;
+}
+
+static int same_action(const AiAction *a, const AiAction *b) {
+    if (a->type != b->type) return 0;
+    if (a->type == AI_ACT_MOVE) return a->target.row == b->target.row && a->target.col == b->target.col;
+    if (a->type == AI_ACT_WALL) return a->row == b->row && a->col == b->col && a->dir == b->dir;
+    return 1;
+}
+
+static int add_wall_candidate(const Game *g, AiAction *out, int count, int max_out, int row, int col, WallDir dir) {
+    AiAction a;
+    int i;
+    if (count >= max_out) return count;
+    if (!game_can_place_wall(g, row, col, dir)) return count;
+    a.type = AI_ACT_WALL;
+    a.target.row = 0;
+    a.target.col = 0;
+    a.row = row;
+    a.col = col;
+    a.dir = dir;
+    for (i = 0; i < count; i++) {
+        if (same_action(&out[i], &a)) return count;
+    }
+    out[count++] = a;
+    return count;
+}
+
+static int generate_actions(Ai *ai, const Game *g, int player, AiAction *out, int max_out) {
+    int n = g->size;
+    int *mine = ai->dist;
+    int *theirs = ai->dist + n * n;
+    Pos moves[16];
+    int move_count;
+    int count = 0;
+    int i;
+    int j;
+
+    distance_field(ai, g, player, mine);
+    move_count = game_list_moves(g, player, moves, 16);
+    for (i = 1; i < move_count; i++) {
+        Pos key = moves[i];
+        int kd = mine[key.row * n + key.col];
+        for (j = i - 1; j >= 0 && mine[moves[j].row * n + moves[j].col] > kd; j--) moves[j + 1] = moves[j];
+        moves[j + 1] = key;
+    }
+    for (i = 0; i < move_count && count < max_out; i++) {
+        out[count].type = AI_ACT_MOVE;
+        out[count].target = moves[i];
+        out[count].row = 0;
+        out[count].col = 0;
+        out[count].dir = DIR_H;
+        count++;
+    }
+
+    if (g->walls_left[player] > 0) {
+        int wall_cap = count + ai->cfg.max_walls;
+        Pos cur = g->players[1 - player];
+        if (wall_cap > max_out) wall_cap = max_out;
+        distance_field(ai, g, 1 - player, theirs);
+        while (count < wall_cap && theirs[cur.row * n + cur.col] > 0) {
+            int d = theirs[cur.row * n + cur.col];
+            Pos next = cur;
+            for (i = 0; i < 4; i++) {
+                int nr = cur.row + step_dr[i];
+                int nc = cur.col + step_dc[i];
+                if (game_is_blocked(g, cur.row, cur.col, nr, nc)) continue;
+                if (theirs[nr * n + nc] != d - 1) continue;
+                next.row = nr;
+                next.col = nc;
+                break;
+            }
+            if (i == 4) break;
+
+            if (next.col == cur.col) {
+                int top = cur.row < next.row ? cur.row : next.row;
+                count = add_wall_candidate(g, out, count, wall_cap, top, cur.col, DIR_H);
+                count = add_wall_candidate(g, out, count, wall_cap, top, cur.col - 1, DIR_H);
+            } else {
+                int left = cur.col < next.col ? cur.col : next.col;
+                count = add_wall_candidate(g, out, count, wall_cap, cur.row, left, DIR_V);
+                count = add_wall_candidate(g, out, count, wall_cap, cur.row - 1, left, DIR_V);
+            }
+            cur = next;
+        }
+    }
+    return count;
+}
+
+/* Root ordering: moves, then the walls that gain the most by the batch
+ * impact scan, then the walls along the opponent's path not yet listed. */
+static int root_actions(Ai *ai, const Game *g, int player, AiAction *out, int max_out) {
+    AiAction base[AI_MAX_ACTIONS];
+    int base_count = generate_actions(ai, g, player, base, AI_MAX_ACTIONS);
+    int count = 0;
+    int walls = 0;
+    int i;
+
+    for (i = 0; i < base_count && count < max_out; i++) {
+        if (base[i].type == AI_ACT_MOVE) out[count++] = base[i];
+    }
+    if (g->walls_left[player] > 0 && impact_scan(&ai->impact, g, player)) {
+        for (i = 0; i < ai->impact.count && walls < ai->cfg.max_walls && count < max_out; i++) {
+            const WallImpact *w = &ai->impact.list[i];
+            if (w->gain <= 0) break;
+            out[count].type = AI_ACT_WALL;
+            out[count].target.row = 0;
+            out[count].target.col = 0;
+            out[count].row = w->row;
+            out[count].col = w->col;
+            out[count].dir = w->dir;
+            count++;
+            walls++;
+        }
+    }
+    for (i = 0; i < base_count && count < max_out; i++) {
+        int j;
+        if (base[i].type != AI_ACT_WALL) continue;
+        for (j = 0; j < count && !same_action(&out[j], &base[i]); j++) {
+        }
+        if (j == count) out[count++] = base[i];
+    }
+    return count;
+}
+
+int ai_list_actions(Ai *ai, const Game *g, int player, AiAction *out, int max_out) {
+    if (!ai || !g || !out || max_out <= 0) return 0;
+    if (player < 0 || player >= PLAYER_COUNT) return 0;
+    if (!ensure_scratch(ai, g->size)) return 0;
+    return generate_actions(ai, g, player, out, max_out);
+}
+
+int ai_apply_action(Game *g, int player, const AiAction *a, char *err, size_t err_cap) {
+    if (!g || !a) return 0;
+    if (a->type == AI_ACT_MOVE) return game_move_player(g, player, a->target, err, err_cap);
+    if (a->type == AI_ACT_WALL) return game_place_wall(g, player, a->row, a->col, a->dir, err, err_cap);
+    if (err) snprintf(err, err_cap, "No action.");
+    return 0;
+}
+
+static int should_stop(Ai *ai) {
+    if (ai->aborted) return 1;
+    if (ai->nodes >= ai->cfg.node_limit) ai->aborted = 1;
+    if (ai->cfg.time_limit_ms > 0 && thread_now_ms() >= ai->deadline_ms) ai->aborted = 1;
+    if ((ai->nodes & 255) == 0 && thread_atomic_load(&ai->stop)) ai->aborted = 1;
+    return ai->aborted;
+}
+
+/* Sized before the search so no ply moves while a deeper one is in use. */
+static int ensure_chance(Ai *ai, int plies) {
+    AiPly *grown;
+    int i;
+    if (!ai->leaves) {
+        ai->leaves = (AiLeaf *)calloc((size_t)1 << AI_LEAF_BITS, sizeof(AiLeaf));
+        if (!ai->leaves) return 0;
+    }
+    if (plies <= ai->chance_cap) return 1;
+    grown = (AiPly *)realloc(ai->chance, sizeof(AiPly) * (size_t)plies);
+    if (!grown) return 0;
+    for (i = ai->chance_cap; i < plies; i++) {
+        game_init(&grown[i].board);
+        grown[i].key = 0;
+        grown[i].count = 0;
+    }
+    ai->chance = grown;
+    ai->chance_cap = plies;
+    return 1;
+}
+
+/* Actions depend on the board and on whether any walls are left, not on
+ * how many, so the search under each outcome reuses the list. */
+static int ply_actions(Ai *ai, const Game *g, int side, int ply, unsigned long long board, AiAction *out) {
+    AiPly *p;
+    unsigned long long key;
+    if (!ai->cfg.magic || ply >= ai->chance_cap) return generate_actions(ai, g, side, out, AI_MAX_ACTIONS);
+    p = &ai->chance[ply];
+    key = board ^ mix64((8ULL << 60) ^ ((unsigned long long)(g->walls_left[side] > 0) << 1) ^ (unsigned long long)side);
+    if (p->key != key) {
+        p->count = generate_actions(ai, g, side, p->actions, AI_MAX_ACTIONS);
+        p->key = key;
+    }
+    memcpy(out, p->actions, (size_t)p->count * sizeof(AiAction));
+    return p->count;
+}
+
+static int next_node(Ai *ai, Game *g, int side, int depth, int ply, int alpha, int beta, unsigned long long board);
+
+static int search(Ai *ai, Game *g, int side, int depth, int ply, int alpha, int beta, unsigned long long board) {
+    AiAction actions[AI_MAX_ACTIONS];
+    AiAction best_move;
+    AiAction tt_move;
+    AiEntry *entry;
+    unsigned long long key;
+    int other = 1 - side;
+    int alpha_orig = alpha;
+    int best = -AI_INF;
+    int count;
+    int winner;
+    int i;
+
+    winner = game_check_winner(g);
+    if (winner >= 0) return winner == side ? AI_WIN - ply : -(AI_WIN - ply);
+    if (depth <= 0) return ai_evaluate(ai, g, side);
+    if (should_stop(ai)) return 0;
+    ai->nodes++;
+
+    key = node_key(ai, g, side, board);
+    entry = &ai->table[key & ai->table_mask];
+    tt_move.type = AI_ACT_NONE;
+    if (entry->key == key) {
+        tt_move = entry->move;
+        if (entry->depth >= depth) {
+            int score = score_from_table(entry->score, ply);
+            if (ply == 0) {
+                if (entry->flag == TT_EXACT && tt_move.type != AI_ACT_NONE) {
+                    ai->root_best = tt_move;
+                    return score;
+                }
+            } else if (entry->flag == TT_EXACT ||
+                       (entry->flag == TT_LOWER && score >= beta) ||
+                       (entry->flag == TT_UPPER && score <= alpha)) {
+                return score;
+            }
+        }
+    }
+
+    if (g->blocked_turns[side] > 0) {
+        int score;
+        g->blocked_turns[side]--;
+        score = -next_node(ai, g, other, depth - 1, ply + 1, -beta, -alpha, board);
+        g->blocked_turns[side]++;
+        return score;
+    }
+
+    if (ply == 0 && ai->root_count > 0) {
+        count = ai->root_count;
+        memcpy(actions, ai->root_actions, (size_t)count * sizeof(AiAction));
+    } else {
+        count = ply_actions(ai, g, side, ply, board, actions);
+    }
+    if (tt_move.type != AI_ACT_NONE) {
+        for (i = 0; i < count; i++) {
+            if (same_action(&actions[i], &tt_move)) {
+                AiAction tmp = actions[0];
+                actions[0] = actions[i];
+                actions[i] = tmp;
+                break;
+            }
+        }
+    }
+
+    best_move.type = AI_ACT_NONE;
+    for (i = 0; i < count; i++) {
+        AiAction *a = &actions[i];
+        unsigned long long child = board;
+        Pos old = g->players[side];
+        int score;
+
+        if (!ai_apply_action(g, side, a, NULL, 0)) continue;
+        if (a->type == AI_ACT_MOVE) {
+            child ^= pawn_key(side, old) ^ pawn_key(side, a->target);
+        } else {
+            child ^= wall_key(a->row, a->col, a->dir);
+        }
+
+        score = -next_node(ai, g, other, depth - 1, ply + 1, -beta, -alpha, child);
+
+        if (a->type == AI_ACT_MOVE) {
+            game_set_player_pos(g, side, old.row, old.col);
+        } else {
+            game_remove_wall(g, side, a->row, a->col, a->dir);
+        }
+        if (ai->aborted) return 0;
+
+        if (score > best) {
+            best = score;
+            best_move = *a;
+            if (ply == 0) ai->root_best = *a;
+        }
+        if (score > alpha) alpha = score;
+        if (alpha >= beta) break;
+    }
+
+    if (best_move.type == AI_ACT_NONE) return ai_evaluate(ai, g, side);
+
+    entry->key = key;
+    entry->move = best_move;
+    entry->score = score_to_table(best, ply);
+    entry->depth = depth;
+    if (best <= alpha_orig) {
+        entry->flag = TT_UPPER;
+    } else if (best >= beta) {
+        entry->flag = TT_LOWER;
+    } else {
+        entry->flag = TT_EXACT;
+    }
+    return best;
+}
+
+/* Magic outcomes that leave the same position are searched once, with
+ * their weights added: a player with no walls loses none, clearing an
+ * empty board changes nothing, and so on. */
+typedef struct {
+    MagicOutcome outcome;
+    int weight;
+    int clears;
+} MagicGroup;
+
+static int has_walls(const Game *g) {
+    size_t words = ((size_t)g->size * (size_t)g->size + 63) / 64;
+    size_t i;
+    for (i = 0; i < words; i++) {
+        if (g->h_wall_at[i] | g->v_wall_at[i]) return 1;
+    }
+    return 0;
+}
+
+static int magic_groups(const Game *g, MagicGroup *out) {
+    MagicOutcome all[MAGIC_OUTCOMES];
+    int after[MAGIC_OUTCOMES][2 * PLAYER_COUNT];
+    int walls = has_walls(g);
+    int total = game_magic_outcomes(all);
+    int count = 0;
+    int i;
+    int j;
+    int p;
+
+    for (i = 0; i < total; i++) {
+        int walls_left[PLAYER_COUNT];
+        int blocked_turns[PLAYER_COUNT];
+        int clears = all[i].effect == MAGIC_CLEAR_WALLS && walls;
+        for (p = 0; p < PLAYER_COUNT; p++) {
+            walls_left[p] = g->walls_left[p];
+            blocked_turns[p] = g->blocked_turns[p];
+        }
+        game_magic_counters(&all[i], walls_left, blocked_turns);
+        for (j = 0; j < count; j++) {
+            if (out[j].clears != clears) continue;
+            for (p = 0; p < PLAYER_COUNT; p++) {
+                if (after[j][p] != walls_left[p] || after[j][PLAYER_COUNT + p] != blocked_turns[p]) break;
+            }
+            if (p == PLAYER_COUNT) break;
+        }
+        if (j < count) {
+            out[j].weight += all[i].weight;
+            continue;
+        }
+        out[count].outcome = all[i];
+        out[count].weight = all[i].weight;
+        out[count].clears = clears;
+        for (p = 0; p < PLAYER_COUNT; p++) {
+            after[count][p] = walls_left[p];
+            after[count][PLAYER_COUNT + p] = blocked_turns[p];
+        }
+        count++;
+    }
+    return count;
+}
+
+/* Only the first action: the table move if there is one, else the first
+ * generated. Its value is a lower bound for the side to move. The first
+ * generated action is always the best pawn step, whatever the counters,
+ * so outcomes on the same board share it through first. */
+static int probe(Ai *ai, Game *g, int side, int depth, int ply, int beta, unsigned long long board, AiAction *first) {
+    AiAction actions[AI_MAX_ACTIONS];
+    AiEntry *entry;
+    AiAction *a = NULL;
+    unsigned long long key;
+    unsigned long long child = board;
+    Pos old = g->players[side];
+    int score;
+
+    if (g->blocked_turns[side] > 0) {
+        g->blocked_turns[side]--;
+        score = -next_node(ai, g, 1 - side, depth - 1, ply + 1, -beta, AI_WIN, board);
+        g->blocked_turns[side]++;
+        return score;
+    }
+    key = node_key(ai, g, side, board);
+    entry = &ai->table[key & ai->table_mask];
+    if (entry->key == key && entry->move.type != AI_ACT_NONE) {
+        a = &entry->move;
+    } else if (first && first->type != AI_ACT_NONE) {
+        a = first;
+    } else if (generate_actions(ai, g, side, actions, 1) > 0) {
+        a = &actions[0];
+        if (first) *first = actions[0];
+    }
+    if (!a || !ai_apply_action(g, side, a, NULL, 0)) return -AI_WIN;
+    if (a->type == AI_ACT_MOVE) {
+        child ^= pawn_key(side, old) ^ pawn_key(side, a->target);
+    } else {
+        child ^= wall_key(a->row, a->col, a->dir);
+    }
+    score = -next_node(ai, g, 1 - side, depth - 1, ply + 1, -beta, AI_WIN, child);
+    if (a->type == AI_ACT_MOVE) {
+        game_set_player_pos(g, side, old.row, old.col);
+    } else {
+        game_remove_wall(g, side, a->row, a->col, a->dir);
+    }
+    return score;
+}
+
+/* Searches the position after one magic outcome, on a copy when it
+ * clears the walls. Counters are simply put back afterwards. */
+static int outcome_value(Ai *ai, Game *g, int side, int depth, int ply, int alpha, int beta, unsigned long long board,
+                         const MagicGroup *m, int probing, AiAction *first) {
+    int walls[PLAYER_COUNT];
+    int blocked[PLAYER_COUNT];
+    int score;
+
+    if (m->clears) {
+        Game *copy = ply < ai->chance_cap ? &ai->chance[ply].board : NULL;
+        if (!copy || !game_copy(copy, g)) return ai_evaluate(ai, g, side);
+        game_apply_magic_outcome(copy, &m->outcome, NULL, 0);
+        board = board_key(copy);
+        return probing ? probe(ai, copy, side, depth, ply, beta, board, NULL)
+                       : search(ai, copy, side, depth, ply, alpha, beta, board);
+    }
+    memcpy(walls, g->walls_left, sizeof(walls));
+    memcpy(blocked, g->blocked_turns, sizeof(blocked));
+    if (m->outcome.effect != MAGIC_CLEAR_WALLS) game_apply_magic_outcome(g, &m->outcome, NULL, 0);
+    score = probing ? probe(ai, g, side, depth, ply, beta, board, first) : search(ai, g, side, depth, ply, alpha, beta, board);
+    memcpy(g->walls_left, walls, sizeof(walls));
+    memcpy(g->blocked_turns, blocked, sizeof(blocked));
+    return score;
+}
+
+/* Evaluation at the horizon below a chance node. Most outcomes only move
+ * the counters, so the board terms are looked up by board key and shared
+ * by every outcome that reaches the same pawns and walls. */
+static int leaf_value(Ai *ai, const Game *g, int side, unsigned long long board) {
+    unsigned long long key = board ^ mix64((7ULL << 60) ^ (unsigned long long)side);
+    AiLeaf *leaf = &ai->leaves[key & (((size_t)1 << AI_LEAF_BITS) - 1)];
+    int f[AI_EVAL_TERMS];
+    int score = 0;
+    int i;
+
+    if (leaf->key != key) {
+        eval_features(ai, g, side, f, ai->cfg.weights[AI_TERM_MOBILITY] != 0);
+        leaf->key = key;
+        leaf->path = f[AI_TERM_PATH];
+        leaf->mobility = f[AI_TERM_MOBILITY];
+    }
+    f[AI_TERM_PATH] = leaf->path;
+    f[AI_TERM_WALLS] = g->walls_left[side] - g->walls_left[1 - side];
+    f[AI_TERM_MOBILITY] = leaf->mobility;
+    f[AI_TERM_BLOCKED] = g->blocked_turns[1 - side] - g->blocked_turns[side];
+    f[AI_TERM_TEMPO] = 1;
+    for (i = 0; i < AI_EVAL_TERMS; i++) score += ai->cfg.weights[i] * f[i];
+    return score;
+}
+
+static long div_floor(long a, long b) {
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+static long div_ceil(long a, long b) {
+    return -div_floor(-a, b);
+}
+
+/* Chance node for the magic box before side moves: the weighted mean of
+ * the outcomes, with values known to lie in [-AI_WIN, AI_WIN]. Star2
+ * first probes one action per outcome for lower bounds and stops if they
+ * already reach beta. Star1 then searches each outcome with the narrowest
+ * window that can still change the result, and stops as soon as the
+ * bounds on the mean leave (alpha, beta). */
+static int chance(Ai *ai, Game *g, int side, int depth, int ply, int alpha, int beta, unsigned long long board) {
+    MagicGroup groups[MAGIC_OUTCOMES];
+    AiAction first;
+    int lo[MAGIC_OUTCOMES];
+    int hi[MAGIC_OUTCOMES];
+    long lo_sum = -(long)AI_WIN * MAGIC_WEIGHT_TOTAL;
+    long hi_sum = (long)AI_WIN * MAGIC_WEIGHT_TOTAL;
+    long low = (long)alpha * MAGIC_WEIGHT_TOTAL;
+    long high = (long)beta * MAGIC_WEIGHT_TOTAL;
+    AiEntry *entry;
+    unsigned long long key;
+    int count;
+    int winner;
+    int value;
+    int flag;
+    int i;
+
+    winner = game_check_winner(g);
+    if (winner >= 0) return winner == side ? AI_WIN - ply : -(AI_WIN - ply);
+    if (depth <= 0) return leaf_value(ai, g, side, board);
+    if (should_stop(ai)) return 0;
+
+    key = node_key(ai, g, side, board) ^ mix64(6ULL << 60);
+    entry = &ai->table[key & ai->table_mask];
+    if (entry->key == key && entry->depth >= depth) {
+        int score = score_from_table(entry->score, ply);
+        if (entry->flag == TT_EXACT || (entry->flag == TT_LOWER && score >= beta) ||
+            (entry->flag == TT_UPPER && score <= alpha)) {
+            return score;
+        }
+    }
+
+    count = magic_groups(g, groups);
+    first.type = AI_ACT_NONE;
+    for (i = 0; i < count; i++) {
+        lo[i] = -AI_WIN;
+        hi[i] = AI_WIN;
+    }
+
+    flag = TT_EXACT;
+    for (i = 0; i < count && flag == TT_EXACT; i++) {
+        long w = groups[i].weight;
+        long need = div_ceil(high - (lo_sum - w * lo[i]), w);
+        int v;
+        if (need > AI_WIN) need = AI_WIN;
+        if (need < -AI_WIN) need = -AI_WIN;
+        v = outcome_value(ai, g, side, depth, ply, -AI_WIN, (int)need, board, &groups[i], 1, &first);
+        if (ai->aborted) return 0;
+        if (v > lo[i]) {
+            lo_sum += w * (v - lo[i]);
+            lo[i] = v;
+        }
+        if (lo_sum >= high) flag = TT_LOWER;
+    }
+
+    for (i = 0; i < count && flag == TT_EXACT; i++) {
+        long w = groups[i].weight;
+        long a = div_floor(low - (hi_sum - w * hi[i]), w);
+        long b = div_ceil(high - (lo_sum - w * lo[i]), w);
+        int v;
+        if (a < -AI_WIN) a = -AI_WIN;
+        if (b > AI_WIN) b = AI_WIN;
+        v = outcome_value(ai, g, side, depth, ply, (int)a, (int)b, board, &groups[i], 0, NULL);
+        if (ai->aborted) return 0;
+        if (v <= a) {
+            if (v < hi[i]) hi_sum -= w * (hi[i] - v), hi[i] = v;
+        } else if (v >= b) {
+            if (v > lo[i]) lo_sum += w * (v - lo[i]), lo[i] = v;
+        } else {
+            lo_sum += w * (v - lo[i]);
+            hi_sum -= w * (hi[i] - v);
+            lo[i] = v;
+            hi[i] = v;
+        }
+        if (lo_sum >= high) flag = TT_LOWER;
+        else if (hi_sum <= low) flag = TT_UPPER;
+    }
+
+    value = flag == TT_UPPER ? (int)div_ceil(hi_sum, MAGIC_WEIGHT_TOTAL) : (int)div_floor(lo_sum, MAGIC_WEIGHT_TOTAL);
+    entry->key = key;
+    entry->move.type = AI_ACT_NONE;
+    entry->score = score_to_table(value, ply);
+    entry->depth = depth;
+    entry->flag = flag;
+    return value;
+}
+
+static int next_node(Ai *ai, Game *g, int side, int depth, int ply, int alpha, int beta, unsigned long long board) {
+    if (ai->cfg.magic) return chance(ai, g, side, depth, ply, alpha, beta, board);
+    return search(ai, g, side, depth, ply, alpha, beta, board);
+}
+
+int ai_search(Ai *ai, const Game *g, AiAction *best, int *score) {
+    Game *work = &ai->work;
+    unsigned long long board;
+    int side;
+    int depth;
+    int found = 0;
+
+    if (!ai || !g || !best || !ai->table) return 0;
+    if (!ensure_scratch(ai, g->size)) return 0;
+    if (!game_copy(work, g)) return 0;
+    if (ai->cfg.magic && !ensure_chance(ai, ai->cfg.depth + 1)) return 0;
+
+    side = g->current_player;
+    board = board_key(work);
+    ai->nodes = 0;
+    ai->aborted = 0;
+    ai->deadline_ms = thread_now_ms() + ai->cfg.time_limit_ms;
+    best->type = AI_ACT_NONE;
+
+    /* Without magic in the search, once both players are out of walls the
+     * race table is exact for it and the move needs no search. */
+    if (race_is_pure(work, ai->cfg.magic) && race_prepare(&ai->race, work)) {
+        Pos target;
+        int plies;
+        int value;
+        RaceResult r = race_solve(&ai->race, work, &plies, &target);
+        if (r != RACE_UNKNOWN && target.row >= 0) {
+            best->type = AI_ACT_MOVE;
+            best->target = target;
+            best->row = 0;
+            best->col = 0;
+            best->dir = DIR_H;
+            value = r == RACE_WIN ? AI_WIN - plies : (r == RACE_LOSS ? -(AI_WIN - plies) : 0);
+            if (score) *score = value;
+            if (ai->on_depth) ai->on_depth(ai->on_depth_ctx, plies, best, value);
+            return 1;
+        }
+    }
+    ai->root_count = root_actions(ai, work, side, ai->root_actions, AI_MAX_ACTIONS);
+
+    for (depth = 1; depth <= ai->cfg.depth; depth++) {
+        int value;
+        ai->root_best.type = AI_ACT_NONE;
+        value = search(ai, work, side, depth, 0, -AI_INF, AI_INF, board);
+        if (ai->aborted) {
+            if (!found && ai->root_best.type != AI_ACT_NONE) {
+                *best = ai->root_best;
+                found = 1;
+            }
+            break;
+        }
+        if (ai->root_best.type == AI_ACT_NONE) break;
+        *best = ai->root_best;
+        if (score) *score = value;
+        found = 1;
+        if (ai->on_depth) ai->on_depth(ai->on_depth_ctx, depth, best, value);
+        if (value > AI_WIN_BOUND || value < -AI_WIN_BOUND) break;
+    }
+    return found;
+}
+
+/* The position is the one before the magic box. Its chance node searches
+ * every outcome group at ply 0 with the full window, so each position the
+ * draw can leave gets an exact root entry, the one ai_search starts from
+ * once the box is opened. */
+int ai_ponder(Ai *ai, const Game *g) {
+    Game *work = &ai->work;
+    unsigned long long board;
+    int side;
+    int depth;
+    int found = 0;
+
+    if (!ai || !g || !ai->table) return 0;
+    if (!ai->cfg.magic) {
+        AiAction best;
+        return ai_search(ai, g, &best, NULL);
+    }
+    if (!ensure_scratch(ai, g->size)) return 0;
+    if (!game_copy(work, g)) return 0;
+    if (!ensure_chance(ai, ai->cfg.depth + 1)) return 0;
+
+    side = g->current_player;
+    board = board_key(work);
+    ai->nodes = 0;
+    ai->aborted = 0;
+    ai->deadline_ms = thread_now_ms() + ai->cfg.time_limit_ms;
+    ai->root_count = 0;
+
+    for (depth = 1; depth <= ai->cfg.depth; depth++) {
+        int value = chance(ai, work, side, depth, 0, -AI_INF, AI_INF, board);
+        if (ai->aborted) break;
+        found = 1;
+        if (value > AI_WIN_BOUND || value < -AI_WIN_BOUND) break;
+    }
+    return found;
+}
+
+int ai_take_turn(Ai *ai, Game *g, char *msg, size_t msg_cap) {
+    AiAction a;
+    char err[64];
+    int player;
+
+    if (!g) return 0;
+    player = g->current_player;
+    if (!ai_search(ai, g, &a, NULL) || !ai_apply_action(g, player, &a, err, sizeof(err))) {
+        return game_try_ai_turn(g, msg, msg_cap);
+    }
+
+    if (a.type == AI_ACT_MOVE) {
+        snprintf(msg, msg_cap, "Computer moved to (%d, %d).", a.target.row, a.target.col);
+    } else {
+        snprintf(msg, msg_cap, "Computer placed wall at (%d, %d) %c.", a.row, a.col, a.dir == DIR_H ? 'H' : 'V');
+    }
+    return 1;
+}
@@ -0,0 +1,98 @@
+#ifndef SIMPLE_AI_H
+#define SIMPLE_AI_H
+
+#include "game.h"
+#include "impact.h"
+#include "race.h"
+
+#define AI_MAX_ACTIONS 96
+#define AI_WEIGHTS_FILE "weights.txt"
+#define AI_WIN 100000
+#define AI_WIN_BOUND (AI_WIN - 1000)
+
+/* Evaluation terms, each from the point of view of the side to move. */
+typedef enum {
+    AI_TERM_PATH = 0,
+    AI_TERM_WALLS,
+    AI_TERM_MOBILITY,
+    AI_TERM_BLOCKED,
+    AI_TERM_TEMPO,
+    AI_EVAL_TERMS
+} AiEvalTerm;
+
+typedef enum {
+    AI_ACT_NONE = 0,
+    AI_ACT_MOVE,
+    AI_ACT_WALL
+} AiActionType;
+
+typedef struct {
+    AiActionType type;
+    Pos target;
+    int row;
+    int col;
+    WallDir dir;
+} AiAction;
+
+typedef struct {
+    int depth;
+    long node_limit;
+    int time_limit_ms;
+    int max_walls;
+    int table_bits;
+    int magic;
+    int weights[AI_EVAL_TERMS];
+} AiConfig;
+
+typedef struct AiEntry AiEntry;
+typedef struct AiLeaf AiLeaf;
+typedef struct AiPly AiPly;
+
+/* Called by ai_search after each completed iteration. */
+typedef void (*AiDepthFn)(void *ctx, int depth, const AiAction *best, int score);
+
+typedef struct {
+    AiConfig cfg;
+    AiEntry *table;
+    size_t table_mask;
+    Game work;
+    int *dist;
+    int *queue;
+    int scratch_cells;
+    long nodes;
+    double deadline_ms;
+    int aborted;
+    AiAction root_best;
+    ImpactScratch impact;
+    AiAction root_actions[AI_MAX_ACTIONS];
+    int root_count;
+    RaceTable race;
+    AiPly *chance;
+    int chance_cap;
+    AiLeaf *leaves;
+    AiDepthFn on_depth;
+    void *on_depth_ctx;
+    volatile long stop;
+} Ai;
+
+void ai_default_config(AiConfig *cfg);
+int ai_init(Ai *ai, const AiConfig *cfg);
+void ai_free(Ai *ai);
+void ai_clear_table(Ai *ai);
+
+int ai_list_actions(Ai *ai, const Game *g, int player, AiAction *out, int max_out);
+int ai_apply_action(Game *g, int player, const AiAction *a, char *err, size_t err_cap);
+int ai_load_weights(AiConfig *cfg, const char *path);
+int ai_save_weights(const int *weights, const char *path);
+const char *ai_term_name(int term);
+
+int ai_path_length(Ai *ai, const Game *g, int player);
+int ai_eval_features(Ai *ai, const Game *g, int player, int *features);
+int ai_evaluate(Ai *ai, const Game *g, int player);
+int ai_search(Ai *ai, const Game *g, AiAction *best, int *score);
+/* Searches ahead of a turn that starts with the magic box: with magic on,
+ * every outcome's position; otherwise as ai_search. */
+int ai_ponder(Ai *ai, const Game *g);
+int ai_take_turn(Ai *ai, Game *g, char *msg, size_t msg_cap);
+
+#endif
@@ -0,0 +1,112 @@
+#include "autosave.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int write_snapshot(Autosave *a, const Game *g) {
+    size_t len = save_image_size(g);
+    if (len > a->image_cap) {
+        unsigned char *image = (unsigned char *)realloc(a->image, len);
+        if (!image) return 0;
+        a->image = image;
+        a->image_cap = len;
+    }
+    if (!save_encode(g, a->image, a->image_cap)) return 0;
+    return save_write_file(a->path, a->image, len, NULL, 0);
+}
+
+static void autosave_run(void *arg) {
+    Autosave *a = (Autosave *)arg;
+
+    thread_mutex_lock(&a->lock);
+    for (;;) {
+        int slot;
+        int ok;
+        while (a->pending < 0 && !a->quit) thread_cond_wait(&a->wake, &a->lock);
+        if (a->pending < 0) break;
+
+        slot = a->pending;
+        a->pending = -1;
+        a->writing = slot;
+        thread_mutex_unlock(&a->lock);
+
+        ok = write_snapshot(a, &a->slots[slot]);
+
+        thread_mutex_lock(&a->lock);
+        a->writing = -1;
+        if (ok) a->written++;
+        else a->failed++;
+    }
+    thread_mutex_unlock(&a->lock);
+}
+
+void autosave_init(Autosave *a) {
+    if (!a) return;
+    memset(a, 0, sizeof(*a));
+    game_init(&a->slots[0]);
+    game_init(&a->slots[1]);
+    a->pending = -1;
+    a->writing = -1;
+}
+
+int autosave_start(Autosave *a, const char *path, int every) {
+    if (!a || !path || !path[0] || every < 1) return 0;
+    if (strlen(path) >= sizeof(a->path)) return 0;
+    snprintf(a->path, sizeof(a->path), "%s", path);
+    a->every = every;
+    a->turns = 0;
+    a->quit = 0;
+    thread_mutex_init(&a->lock);
+    thread_cond_init(&a->wake);
+    if (!thread_start(&a->thread, autosave_run, a)) {
+        thread_cond_destroy(&a->wake);
+        thread_mutex_destroy(&a->lock);
+        return 0;
+    }
+    a->running = 1;
+    return 1;
+}
+
+/* Called once per finished turn on the game thread. Only copies memory:
+ * the lock is held just long enough to pick or publish a slot. */
+void autosave_turn(Autosave *a, const Game *g) {
+    int slot;
+    if (!a || !a->running || !g) return;
+    if (++a->turns % a->every != 0) return;
+
+    thread_mutex_lock(&a->lock);
+    slot = a->writing == 0 ? 1 : 0;
+    if (a->pending == slot) a->pending = -1;
+    thread_mutex_unlock(&a->lock);
+
+    if (!game_copy(&a->slots[slot], g)) return;
+
+    thread_mutex_lock(&a->lock);
+    a->pending = slot;
+    thread_cond_signal(&a->wake);
+    thread_mutex_unlock(&a->lock);
+}
+
+/* Writes out any snapshot still waiting, then stops the writer. */
+void autosave_stop(Autosave *a) {
+    if (!a) return;
+    if (a->running) {
+        thread_mutex_lock(&a->lock);
+        a->quit = 1;
+        thread_cond_signal(&a->wake);
+        thread_mutex_unlock(&a->lock);
+        thread_join(&a->thread);
+        thread_cond_destroy(&a->wake);
+        thread_mutex_destroy(&a->lock);
+        a->running = 0;
+        if (a->failed > 0) {
+            printf("Autosave: %ld snapshot(s) could not be written to %s.\n", a->failed, a->path);
+        }
+    }
+    game_free(&a->slots[0]);
+    game_free(&a->slots[1]);
+    free(a->image);
+    a->image = NULL;
+    a->image_cap = 0;
+}
@@ -0,0 +1,36 @@
+#ifndef SIMPLE_AUTOSAVE_H
+#define SIMPLE_AUTOSAVE_H
+
+#include "game.h"
+#include "save.h"
+#include "thread.h"
+
+#define AUTOSAVE_DEFAULT_FILE "autosave.dat"
+
+/* Two snapshot slots: the game thread copies into whichever one the
+ * writer thread is not writing, so a slow disk never holds up a turn.
+ * A newer snapshot replaces one the writer has not picked up yet. */
+typedef struct {
+    char path[SAVE_PATH_MAX];
+    int every;
+    long turns;
+    Game slots[2];
+    int pending;
+    int writing;
+    int quit;
+    long written;
+    long failed;
+    unsigned char *image;
+    size_t image_cap;
+    ThreadMutex lock;
+    ThreadCond wake;
+    Thread thread;
+    int running;
+} Autosave;
+
+void autosave_init(Autosave *a);
+int autosave_start(Autosave *a, const char *path, int every);
+void autosave_turn(Autosave *a, const Game *g);
+void autosave_stop(Autosave *a);
+
+#endif
@@ -0,0 +1,635 @@
+#include "batch.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "thread.h"
+
+static const int step_dr[4] = {-1, 1, 0, 0};
+static const int step_dc[4] = {0, 0, -1, 1};
+
+void batch_init(GameBatch *b) {
+    if (!b) return;
+    memset(b, 0, sizeof(*b));
+}
+
+void batch_free(GameBatch *b) {
+    int p;
+    if (!b) return;
+    for (p = 0; p < PLAYER_COUNT; p++) {
+        free(b->row[p]);
+        free(b->col[p]);
+        free(b->walls_left[p]);
+        free(b->blocked[p]);
+        free(b->goal[p]);
+    }
+    free(b->side);
+    free(b->block_right);
+    free(b->block_down);
+    free(b->h_wall_at);
+    free(b->v_wall_at);
+    free(b->reach);
+    free(b->next);
+    free(b->open_right);
+    free(b->open_down);
+    free(b->inner);
+    free(b->upper);
+    free(b->placed);
+    free(b->path_ok);
+    batch_init(b);
+}
+
+static void set_bit(uint64_t *bits, int index) {
+    bits[index >> 6] |= (uint64_t)1 << (index & 63);
+}
+
+static int bit_at(const uint64_t *bits, int index) {
+    return (int)((bits[index >> 6] >> (index & 63)) & 1u);
+}
+
+static void build_masks(GameBatch *b) {
+    int n = b->size;
+    int r;
+    int c;
+    memset(b->inner, 0, b->words * sizeof(uint64_t));
+    memset(b->upper, 0, b->words * sizeof(uint64_t));
+    memset(b->goal[0], 0, b->words * sizeof(uint64_t));
+    memset(b->goal[1], 0, b->words * sizeof(uint64_t));
+    for (r = 0; r < n; r++) {
+        for (c = 0; c < n; c++) {
+            if (c < n - 1) set_bit(b->inner, r * n + c);
+            if (r < n - 1) set_bit(b->upper, r * n + c);
+        }
+    }
+    /* Player 1 aims for the top row and player 2 for the bottom row. */
+    for (c = 0; c < n; c++) {
+        set_bit(b->goal[0], c);
+        set_bit(b->goal[1], (n - 1) * n + c);
+    }
+}
+
+static int reserve(GameBatch *b, int size, int count) {
+    size_t words = ((size_t)size * (size_t)size + 63) / 64;
+    size_t pad = (size_t)size / 64 + 2;
+    size_t padded = words + 2 * pad;
+    size_t cap = (size_t)count;
+    int ok = 1;
+    int p;
+
+    if (size == b->size && count <= b->capacity) return 1;
+    batch_free(b);
+    for (p = 0; p < PLAYER_COUNT; p++) {
+        b->row[p] = (int *)malloc(cap * sizeof(int));
+        b->col[p] = (int *)malloc(cap * sizeof(int));
+        b->walls_left[p] = (int *)malloc(cap * sizeof(int));
+        b->blocked[p] = (int *)malloc(cap * sizeof(int));
+        b->goal[p] = (uint64_t *)malloc(words * sizeof(uint64_t));
+        if (!b->row[p] || !b->col[p] || !b->walls_left[p] || !b->blocked[p] || !b->goal[p]) ok = 0;
+    }
+    b->side = (int *)malloc(cap * sizeof(int));
+    b->block_right = (uint64_t *)malloc(cap * words * sizeof(uint64_t));
+    b->block_down = (uint64_t *)malloc(cap * words * sizeof(uint64_t));
+    b->h_wall_at = (uint64_t *)malloc(cap * words * sizeof(uint64_t));
+    b->v_wall_at = (uint64_t *)malloc(cap * words * sizeof(uint64_t));
+    b->reach = (uint64_t *)calloc(padded, sizeof(uint64_t));
+    b->next = (uint64_t *)calloc(padded, sizeof(uint64_t));
+    b->open_right = (uint64_t *)calloc(padded, sizeof(uint64_t));
+    b->open_down = (uint64_t *)calloc(padded, sizeof(uint64_t));
+    b->inner = (uint64_t *)malloc(words * sizeof(uint64_t));
+    b->upper = (uint64_t *)malloc(words * sizeof(uint64_t));
+    b->placed = (unsigned char *)malloc(cap);
+    b->path_ok = (unsigned char *)malloc(cap);
+    if (!ok || !b->side || !b->block_right || !b->block_down || !b->h_wall_at || !b->v_wall_at || !b->reach ||
+        !b->next || !b->open_right || !b->open_down || !b->inner || !b->upper || !b->placed || !b->path_ok) {
+        batch_free(b);
+        return 0;
+    }
+    b->size = size;
+    b->capacity = count;
+    b->words = words;
+    b->pad = pad;
+    build_masks(b);
+    return 1;
+}
+
+/* Every game at the starting position, as game_start sets it up. */
+int batch_reset(GameBatch *b, int size, int count, int walls) {
+    size_t bytes;
+    int i;
+    if (!b || size < MIN_SIZE || size > MAX_SIZE || count <= 0) return 0;
+    if (!reserve(b, size, count)) return 0;
+    b->count = count;
+    for (i = 0; i < count; i++) {
+        b->row[0][i] = size - 1;
+        b->col[0][i] = size / 2;
+        b->row[1][i] = 0;
+        b->col[1][i] = (size - 1) / 2;
+        b->walls_left[0][i] = walls;
+        b->walls_left[1][i] = walls;
+        b->blocked[0][i] = 0;
+        b->blocked[1][i] = 0;
+        b->side[i] = 0;
+    }
+    bytes = (size_t)count * b->words * sizeof(uint64_t);
+    memset(b->block_right, 0, bytes);
+    memset(b->block_down, 0, bytes);
+    memset(b->h_wall_at, 0, bytes);
+    memset(b->v_wall_at, 0, bytes);
+    return 1;
+}
+
+int batch_load(GameBatch *b, int i, const Game *g) {
+    size_t at;
+    size_t bytes;
+    int p;
+    if (!b || !g || i < 0 || i >= b->count || g->size != b->size) return 0;
+    for (p = 0; p < PLAYER_COUNT; p++) {
+        b->row[p][i] = g->players[p].row;
+        b->col[p][i] = g->players[p].col;
+        b->walls_left[p][i] = g->walls_left[p];
+        b->blocked[p][i] = g->blocked_turns[p];
+    }
+    b->side[i] = g->current_player;
+    at = (size_t)i * b->words;
+    bytes = b->words * sizeof(uint64_t);
+    memcpy(b->block_right + at, g->block_right, bytes);
+    memcpy(b->block_down + at, g->block_down, bytes);
+    memcpy(b->h_wall_at + at, g->h_wall_at, bytes);
+    memcpy(b->v_wall_at + at, g->v_wall_at, bytes);
+    return 1;
+}
+
+int batch_store(const GameBatch *b, int i, Game *g) {
+    const uint64_t *h;
+    const uint64_t *v;
+    Pos pawns[PLAYER_COUNT];
+    int n;
+    int r;
+    int c;
+    int p;
+
+    if (!b || !g || i < 0 || i >= b->count || !game_clear(g, b->size)) return 0;
+    n = b->size;
+    for (p = 0; p < PLAYER_COUNT; p++) {
+        pawns[p].row = b->row[p][i];
+        pawns[p].col = b->col[p][i];
+    }
+    if (!game_set_pawns(g, pawns)) return 0;
+    for (p = 0; p < PLAYER_COUNT; p++) {
+        g->walls_left[p] = b->walls_left[p][i];
+        g->blocked_turns[p] = b->blocked[p][i];
+    }
+    g->current_player = b->side[i];
+    h = b->h_wall_at + (size_t)i * b->words;
+    v = b->v_wall_at + (size_t)i * b->words;
+    for (r = 0; r < n - 1; r++) {
+        for (c = 0; c < n - 1; c++) {
+            if (bit_at(h, r * n + c)) game_add_wall_from_map(g, r, c, DIR_H);
+            if (bit_at(v, r * n + c)) game_add_wall_from_map(g, r, c, DIR_V);
+        }
+    }
+    return 1;
+}
+
+/* 1 when the step from (r,c) in direction d stays on the board and no
+ * wall is in the way. Written without early returns so the callers'
+ * loops over games stay straight-line code. */
+static int edge_open(const uint64_t *right, const uint64_t *down, int n, int r, int c, int d) {
+    int nr = r + step_dr[d];
+    int nc = c + step_dc[d];
+    int inside = (nr >= 0) & (nr < n) & (nc >= 0) & (nc < n);
+    int owner = (d & 1) ? r * n + c : nr * n + nc;
+    const uint64_t *bits = d < 2 ? down : right;
+    owner = inside ? owner : 0;
+    return inside & !bit_at(bits, owner);
+}
+
+/* Direction from the pawn to an adjacent opponent, and the legal slots. */
+static unsigned slot_mask(const GameBatch *b, int i, int *toward_out) {
+    int n = b->size;
+    int p = b->side[i];
+    int q = 1 - p;
+    const uint64_t *right = b->block_right + (size_t)i * b->words;
+    const uint64_t *down = b->block_down + (size_t)i * b->words;
+    int r = b->row[p][i];
+    int c = b->col[p][i];
+    int orow = b->row[q][i];
+    int ocol = b->col[q][i];
+    int odr = orow - r;
+    int odc = ocol - c;
+    int near = odr * odr + odc * odc == 1;
+    int toward = odr != 0 ? (odr > 0) : 2 + (odc > 0);
+    int side0 = toward < 2 ? 2 : 0;
+    int adj = near & edge_open(right, down, n, r, c, toward);
+    int jump = adj & edge_open(right, down, n, orow, ocol, toward);
+    unsigned mask = 0;
+    int d;
+
+    for (d = 0; d < 4; d++) {
+        int onto_opp = (r + step_dr[d] == orow) & (c + step_dc[d] == ocol);
+        mask |= (unsigned)(edge_open(right, down, n, r, c, d) & !onto_opp) << d;
+    }
+    mask |= (unsigned)jump << 4;
+    mask |= (unsigned)(adj & !jump & edge_open(right, down, n, orow, ocol, side0)) << 5;
+    mask |= (unsigned)(adj & !jump & edge_open(right, down, n, orow, ocol, side0 + 1)) << 6;
+    if (toward_out) *toward_out = toward;
+    return mask;
+}
+
+static Pos slot_target(const GameBatch *b, int i, int slot, int toward) {
+    int p = b->side[i];
+    int q = 1 - p;
+    Pos t;
+    int d;
+    if (slot < 4) {
+        t.row = b->row[p][i] + step_dr[slot];
+        t.col = b->col[p][i] + step_dc[slot];
+        return t;
+    }
+    d = slot == 4 ? toward : (toward < 2 ? 2 : 0) + (slot - 5);
+    t.row = b->row[q][i] + step_dr[d];
+    t.col = b->col[q][i] + step_dc[d];
+    return t;
+}
+
+Pos batch_slot_target(const GameBatch *b, int i, int slot) {
+    int toward;
+    slot_mask(b, i, &toward);
+    return slot_target(b, i, slot, toward);
+}
+
+/* Bit s of slots[i] is set when slot s is a legal move for the side to
+ * move in game i. */
+void batch_list_moves(const GameBatch *b, unsigned char *slots) {
+    int i;
+    for (i = 0; i < b->count; i++) slots[i] = (unsigned char)slot_mask(b, i, NULL);
+}
+
+void batch_can_move(const GameBatch *b, const Pos *target, unsigned char *ok) {
+    int i;
+    for (i = 0; i < b->count; i++) {
+        int toward;
+        unsigned mask = slot_mask(b, i, &toward);
+        int hit = 0;
+        int s;
+        for (s = 0; s < BATCH_SLOTS; s++) {
+            Pos t = slot_target(b, i, s, toward);
+            hit |= (int)((mask >> s) & 1u) & (t.row == target[i].row) & (t.col == target[i].col);
+        }
+        ok[i] = (unsigned char)hit;
+    }
+}
+
+/* Same order as game_check_winner: player 1 is tested first. */
+void batch_check_winner(const GameBatch *b, int *winner) {
+    const int *top = b->row[0];
+    const int *bottom = b->row[1];
+    int last = b->size - 1;
+    int i;
+    for (i = 0; i < b->count; i++) {
+        int w0 = top[i] == 0;
+        int w1 = bottom[i] == last;
+        winner[i] = w0 ? 0 : (w1 ? 1 : -1);
+    }
+}
+
+/* Flood from the pawn one step in every direction per pass, 64 cells per
+ * word, until the goal row is reached or nothing new is reached. */
+static int flood(GameBatch *b, int i, int p) {
+    int n = b->size;
+    int W = (int)b->words;
+    int q = n >> 6;
+    int s = n & 63;
+    const uint64_t *oright = b->open_right + b->pad;
+    const uint64_t *odown = b->open_down + b->pad;
+    const uint64_t *goal = b->goal[p];
+    uint64_t *reach = b->reach + b->pad;
+    uint64_t *next = b->next + b->pad;
+    int start = b->row[p][i] * n + b->col[p][i];
+    int w;
+
+    memset(reach, 0, (size_t)W * sizeof(uint64_t));
+    set_bit(reach, start);
+    for (;;) {
+        uint64_t changed = 0;
+        uint64_t hit = 0;
+        uint64_t *tmp;
+        for (w = 0; w < W; w++) {
+            uint64_t x = reach[w];
+            uint64_t down_lo = reach[w - q] & odown[w - q];
+            uint64_t down_hi = reach[w - q - 1] & odown[w - q - 1];
+            uint64_t up_lo = reach[w + q];
+            uint64_t up_hi = reach[w + q + 1];
+            x |= ((reach[w] & oright[w]) << 1) | ((reach[w - 1] & oright[w - 1]) >> 63);
+            x |= ((reach[w] >> 1) | (reach[w + 1] << 63)) & oright[w];
+            x |= (down_lo << s) | (s ? down_hi >> (64 - s) : 0);
+            x |= ((up_lo >> s) | (s ? up_hi << (64 - s) : 0)) & odown[w];
+            next[w] = x;
+            changed |= x ^ reach[w];
+            hit |= x & goal[w];
+        }
+        tmp = reach;
+        reach = next;
+        next = tmp;
+        if (hit) return 1;
+        if (!changed) return 0;
+    }
+}
+
+/* ok[i] is 1 when both pawns of game i can still reach their goal rows.
+ * With active set, only games with active[i] are checked; the rest get 1. */
+void batch_paths_open(GameBatch *b, const unsigned char *active, unsigned char *ok) {
+    size_t W = b->words;
+    int i;
+    for (i = 0; i < b->count; i++) {
+        const uint64_t *right = b->block_right + (size_t)i * W;
+        const uint64_t *down = b->block_down + (size_t)i * W;
+        uint64_t *oright = b->open_right + b->pad;
+        uint64_t *odown = b->open_down + b->pad;
+        size_t w;
+        if (active && !active[i]) {
+            ok[i] = 1;
+            continue;
+        }
+        for (w = 0; w < W; w++) {
+            oright[w] = ~right[w] & b->inner[w];
+            odown[w] = ~down[w] & b->upper[w];
+        }
+        ok[i] = (unsigned char)(flood(b, i, 0) && flood(b, i, 1));
+    }
+}
+
+static int can_place_wall(const GameBatch *b, int i, int row, int col, WallDir dir) {
+    int n = b->size;
+    size_t at = (size_t)i * b->words;
+    int cell = row * n + col;
+    if (row < 0 || col < 0 || row >= n - 1 || col >= n - 1) return 0;
+    if (dir == DIR_H) {
+        return !bit_at(b->v_wall_at + at, cell) && !bit_at(b->block_down + at, cell) &&
+               !bit_at(b->block_down + at, cell + 1);
+    }
+    return !bit_at(b->h_wall_at + at, cell) && !bit_at(b->block_right + at, cell) &&
+           !bit_at(b->block_right + at, cell + n);
+}
+
+static void put_wall(GameBatch *b, int i, int row, int col, WallDir dir, int value) {
+    int n = b->size;
+    size_t at = (size_t)i * b->words;
+    int cell = row * n + col;
+    uint64_t *edge = dir == DIR_H ? b->block_down + at : b->block_right + at;
+    uint64_t *anchor = dir == DIR_H ? b->h_wall_at + at : b->v_wall_at + at;
+    int other = dir == DIR_H ? cell + 1 : cell + n;
+    uint64_t m0 = (uint64_t)1 << (cell & 63);
+    uint64_t m1 = (uint64_t)1 << (other & 63);
+    if (value) {
+        edge[cell >> 6] |= m0;
+        edge[other >> 6] |= m1;
+        anchor[cell >> 6] |= m0;
+    } else {
+        edge[cell >> 6] &= ~m0;
+        edge[other >> 6] &= ~m1;
+        anchor[cell >> 6] &= ~m0;
+    }
+}
+
+/* 1 when grid corner (vr, vc) is on the border or is the end or middle
+ * of a wall; corners run from 0 to size in both directions. */
+static int corner_touched(const GameBatch *b, int i, int vr, int vc) {
+    int n = b->size;
+    size_t at = (size_t)i * b->words;
+    const uint64_t *right = b->block_right + at;
+    const uint64_t *down = b->block_down + at;
+    if (vr == 0 || vc == 0 || vr == n || vc == n) return 1;
+    return bit_at(down, (vr - 1) * n + vc) | bit_at(down, (vr - 1) * n + vc - 1) | bit_at(right, vr * n + vc - 1) |
+           bit_at(right, (vr - 1) * n + vc - 1);
+}
+
+/* A new wall can only close off a region if it joins two points that
+ * are already connected through walls and the border, so it must touch
+ * them at two of its three corners. Otherwise no path check is needed. */
+static int may_enclose(const GameBatch *b, int i, int row, int col, WallDir dir) {
+    int touched;
+    if (dir == DIR_H) {
+        touched = corner_touched(b, i, row + 1, col) + corner_touched(b, i, row + 1, col + 1) +
+                  corner_touched(b, i, row + 1, col + 2);
+    } else {
+        touched = corner_touched(b, i, row, col + 1) + corner_touched(b, i, row + 1, col + 1) +
+                  corner_touched(b, i, row + 2, col + 1);
+    }
+    return touched >= 2;
+}
+
+/* One turn for every game: a blocked side loses its turn, otherwise a[i]
+ * is played for the side to move. ok[i] is 1 when the turn passed. Walls
+ * that might close off a region are checked together in one path pass at
+ * the end and taken back if they do. */
+void batch_apply(GameBatch *b, const BatchAction *a, unsigned char *ok) {
+    int i;
+    int walls = 0;
+
+    for (i = 0; i < b->count; i++) {
+        int p = b->side[i];
+        b->placed[i] = 0;
+        ok[i] = 0;
+        if (b->blocked[p][i] > 0) {
+            b->blocked[p][i]--;
+            b->side[i] = 1 - p;
+            ok[i] = 1;
+        } else if (a[i].type == BATCH_MOVE) {
+            int toward;
+            unsigned mask = slot_mask(b, i, &toward);
+            if (a[i].slot >= 0 && a[i].slot < BATCH_SLOTS && ((mask >> a[i].slot) & 1u)) {
+                Pos t = slot_target(b, i, a[i].slot, toward);
+                b->row[p][i] = t.row;
+                b->col[p][i] = t.col;
+                b->side[i] = 1 - p;
+                ok[i] = 1;
+            }
+        } else if (a[i].type == BATCH_WALL) {
+            if (b->walls_left[p][i] > 0 && can_place_wall(b, i, a[i].row, a[i].col, a[i].dir)) {
+                int check = may_enclose(b, i, a[i].row, a[i].col, a[i].dir);
+                put_wall(b, i, a[i].row, a[i].col, a[i].dir, 1);
+                if (check) {
+                    b->placed[i] = 1;
+                    walls++;
+                } else {
+                    b->walls_left[p][i]--;
+                    b->side[i] = 1 - p;
+                    ok[i] = 1;
+                }
+            }
+        }
+    }
+    if (walls == 0) return;
+
+    batch_paths_open(b, b->placed, b->path_ok);
+    for (i = 0; i < b->count; i++) {
+        int p = b->side[i];
+        if (!b->placed[i]) continue;
+        if (!b->path_ok[i]) {
+            put_wall(b, i, a[i].row, a[i].col, a[i].dir, 0);
+            continue;
+        }
+        b->walls_left[p][i]--;
+        b->side[i] = 1 - p;
+        ok[i] = 1;
+    }
+}
+
+static uint64_t bench_rand(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+typedef struct {
+    BatchActionType type;
+    Pos target;
+    int row;
+    int col;
+    WallDir dir;
+} BenchStep;
+
+/* Random playouts in a batch, then the same actions one Game at a time.
+ * Both must accept the same actions and end in the same positions. */
+static int bench_size(FILE *out, int size, int count, int steps) {
+    GameBatch b;
+    Game *games = NULL;
+    Game check;
+    BatchAction *actions = NULL;
+    BenchStep *log = NULL;
+    unsigned char *slots = NULL;
+    unsigned char *ok = NULL;
+    unsigned char *oks = NULL;
+    int *winner = NULL;
+    uint64_t rng = 0x9E3779B97F4A7C15ULL ^ (uint64_t)size;
+    double batch_ms = 0.0;
+    double single_ms = 0.0;
+    double t0;
+    long played = 0;
+    long mismatches = 0;
+    int result = 0;
+    int step;
+    int i;
+
+    batch_init(&b);
+    game_init(&check);
+    games = (Game *)calloc((size_t)count, sizeof(Game));
+    actions = (BatchAction *)malloc((size_t)count * sizeof(BatchAction));
+    log = (BenchStep *)malloc((size_t)count * (size_t)steps * sizeof(BenchStep));
+    slots = (unsigned char *)malloc((size_t)count);
+    ok = (unsigned char *)malloc((size_t)count);
+    oks = (unsigned char *)malloc((size_t)count * (size_t)steps);
+    winner = (int *)malloc((size_t)count * sizeof(int));
+    if (!games || !actions || !log || !slots || !ok || !oks || !winner || !batch_reset(&b, size, count, size + 1)) {
+        goto done;
+    }
+
+    for (step = 0; step < steps; step++) {
+        t0 = thread_now_ms();
+        batch_check_winner(&b, winner);
+        batch_list_moves(&b, slots);
+        batch_ms += thread_now_ms() - t0;
+
+        for (i = 0; i < count; i++) {
+            BatchAction *a = &actions[i];
+            BenchStep *e = &log[(size_t)step * count + i];
+            int legal = 0;
+            int s;
+            memset(a, 0, sizeof(*a));
+            for (s = 0; s < BATCH_SLOTS; s++) legal += (slots[i] >> s) & 1;
+            if (winner[i] >= 0) {
+                a->type = BATCH_NONE;
+            } else if (b.walls_left[b.side[i]][i] > 0 && bench_rand(&rng) % 3 == 0) {
+                a->type = BATCH_WALL;
+                a->row = (int)(bench_rand(&rng) % (uint64_t)(size - 1));
+                a->col = (int)(bench_rand(&rng) % (uint64_t)(size - 1));
+                a->dir = (bench_rand(&rng) & 1) ? DIR_V : DIR_H;
+            } else if (legal > 0) {
+                int k = (int)(bench_rand(&rng) % (uint64_t)legal);
+                for (s = 0; s < BATCH_SLOTS; s++) {
+                    if (((slots[i] >> s) & 1) && k-- == 0) break;
+                }
+                a->type = BATCH_MOVE;
+                a->slot = s;
+            }
+            e->type = a->type;
+            e->row = a->row;
+            e->col = a->col;
+            e->dir = a->dir;
+            if (a->type == BATCH_MOVE) e->target = batch_slot_target(&b, i, a->slot);
+        }
+
+        t0 = thread_now_ms();
+        batch_apply(&b, actions, ok);
+        batch_ms += thread_now_ms() - t0;
+        memcpy(oks + (size_t)step * count, ok, (size_t)count);
+    }
+
+    for (i = 0; i < count; i++) {
+        game_init(&games[i]);
+        if (!game_start(&games[i], size, size + 1, MODE_PVP, "A", "B")) goto done;
+    }
+    t0 = thread_now_ms();
+    for (step = 0; step < steps; step++) {
+        for (i = 0; i < count; i++) {
+            Game *g = &games[i];
+            const BenchStep *e = &log[(size_t)step * count + i];
+            Pos moves[16];
+            int side = g->current_player;
+            int done_ok = 0;
+            if (game_check_winner(g) >= 0) continue;
+            game_list_moves(g, side, moves, 16);
+            if (e->type == BATCH_MOVE) done_ok = game_move_player(g, side, e->target, NULL, 0);
+            else if (e->type == BATCH_WALL) done_ok = game_place_wall(g, side, e->row, e->col, e->dir, NULL, 0);
+            if (done_ok) g->current_player = game_next_player(side);
+            if (done_ok != oks[(size_t)step * count + i]) mismatches++;
+            played += done_ok;
+        }
+    }
+    single_ms = thread_now_ms() - t0;
+
+    for (i = 0; i < count; i++) {
+        Game *g = &games[i];
+        size_t bytes = ((size_t)size * size + 63) / 64 * sizeof(uint64_t);
+        if (!batch_store(&b, i, &check)) goto done;
+        if (memcmp(check.players, g->players, sizeof(g->players)) != 0 ||
+            memcmp(check.walls_left, g->walls_left, sizeof(g->walls_left)) != 0 ||
+            check.current_player != g->current_player || memcmp(check.h_wall_at, g->h_wall_at, bytes) != 0 ||
+            memcmp(check.v_wall_at, g->v_wall_at, bytes) != 0) {
+            mismatches++;
+        }
+    }
+
+    fprintf(out, "%3dx%-3d %6d games x %d turns: %8ld actions, batch %8.1f ms, one game at a time %8.1f ms (%.2fx), %ld mismatch(es)\n",
+            size, size, count, steps, played, batch_ms, single_ms, batch_ms > 0.0 ? single_ms / batch_ms : 0.0,
+            mismatches);
+    fflush(out);
+    result = mismatches == 0;
+
+done:
+    if (games) {
+        for (i = 0; i < count; i++) game_free(&games[i]);
+    }
+    free(games);
+    free(actions);
+    free(log);
+    free(slots);
+    free(ok);
+    free(oks);
+    free(winner);
+    game_free(&check);
+    batch_free(&b);
+    return result;
+}
+
+int batch_benchmark(FILE *out) {
+    int ok = 1;
+    if (!bench_size(out, 9, 4096, 120)) ok = 0;
+    if (!bench_size(out, 17, 2048, 200)) ok = 0;
+    if (!bench_size(out, 33, 512, 300)) ok = 0;
+    return ok;
+}
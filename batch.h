@@ -0,0 +1,78 @@
+#ifndef SIMPLE_BATCH_H
+#define SIMPLE_BATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "game.h"
+
+/* Move slots, in game_list_moves order: steps up, down, left, right, the
+ * jump over an adjacent opponent, then the two side steps around it. */
+#define BATCH_SLOTS 7
+
+typedef enum {
+    BATCH_NONE = 0,
+    BATCH_MOVE,
+    BATCH_WALL
+} BatchActionType;
+
+typedef struct {
+    BatchActionType type;
+    int slot;
+    int row;
+    int col;
+    WallDir dir;
+} BatchAction;
+
+/* N games of one board size in struct-of-arrays form. Per-game fields
+ * are arrays indexed by game; the wall bitsets hold `words` words per
+ * game back to back, in the same layout as Game. The batch has no magic
+ * and no names: it is for rollouts and self-play, not the game loop. */
+typedef struct {
+    int size;
+    int count;
+    int capacity;
+    size_t words;
+
+    int *row[PLAYER_COUNT];
+    int *col[PLAYER_COUNT];
+    int *walls_left[PLAYER_COUNT];
+    int *blocked[PLAYER_COUNT];
+    int *side;
+
+    uint64_t *block_right;
+    uint64_t *block_down;
+    uint64_t *h_wall_at;
+    uint64_t *v_wall_at;
+
+    /* Path check: a bit-parallel flood over one game at a time, in
+     * buffers padded with zero words so the shifts need no edge cases. */
+    size_t pad;
+    uint64_t *reach;
+    uint64_t *next;
+    uint64_t *open_right;
+    uint64_t *open_down;
+    uint64_t *inner;
+    uint64_t *upper;
+    uint64_t *goal[PLAYER_COUNT];
+    unsigned char *placed;
+    unsigned char *path_ok;
+} GameBatch;
+
+void batch_init(GameBatch *b);
+void batch_free(GameBatch *b);
+int batch_reset(GameBatch *b, int size, int count, int walls);
+int batch_load(GameBatch *b, int i, const Game *g);
+int batch_store(const GameBatch *b, int i, Game *g);
+
+void batch_can_move(const GameBatch *b, const Pos *target, unsigned char *ok);
+void batch_list_moves(const GameBatch *b, unsigned char *slots);
+Pos batch_slot_target(const GameBatch *b, int i, int slot);
+void batch_check_winner(const GameBatch *b, int *winner);
+void batch_paths_open(GameBatch *b, const unsigned char *active, unsigned char *ok);
+void batch_apply(GameBatch *b, const BatchAction *a, unsigned char *ok);
+
+int batch_benchmark(FILE *out);
+
+#endif
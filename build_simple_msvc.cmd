@@ -12,6 +12,10 @@ if errorlevel 1 (
 
 cl /nologo /W4 /D_CRT_SECURE_NO_WARNINGS /std:c11 ^
  "%ROOT%\main.c" "%ROOT%\game.c" "%ROOT%\io.c" "%ROOT%\save.c" ^
+ "%ROOT%\ai.c" "%ROOT%\ponder.c" "%ROOT%\thread.c" "%ROOT%\parpath.c" ^
+ "%ROOT%\workload.c" "%ROOT%\autosave.c" "%ROOT%\trainset.c" ^
+ "%ROOT%\tune.c" "%ROOT%\spectate.c" "%ROOT%\match.c" "%ROOT%\impact.c" ^
+ "%ROOT%\notation.c" "%ROOT%\suite.c" "%ROOT%\batch.c" "%ROOT%\race.c" "%ROOT%\pns.c" "%ROOT%\live.c" ^
  /Fe:"%ROOT%\simple_main.exe"
 
 if errorlevel 1 exit /b 1
@@ -1,5 +1,7 @@
 #include "game.h"
 
+#include "parpath.h"
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -15,30 +17,247 @@ static void copy_text(char *dst, size_t cap, const char *src) {
     dst[cap - 1] = '\0';
 }
 
+static int rng_seeded = 0;
+
 void game_seed_rng(void) {
-    static int seeded = 0;
-    if (!seeded) {
+    if (!rng_seeded) {
         srand((unsigned int)time(NULL));
-        seeded = 1;
+        rng_seeded = 1;
     }
 }
 
-void game_clear(Game *g, int size) {
+void game_seed_rng_with(unsigned int seed) {
+    srand(seed);
+    rng_seeded = 1;
+}
+
+void game_set_seed(Game *g, uint64_t seed) {
+    if (!g) return;
+    g->rng = seed;
+}
+
+/* splitmix64; the top 31 bits, like rand() with a large RAND_MAX. */
+unsigned int game_random(Game *g) {
+    uint64_t z;
+    g->rng += 0x9E3779B97F4A7C15ULL;
+    z = g->rng;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    return (unsigned int)(z >> 33);
+}
+
+static size_t bit_words(int cells) {
+    return ((size_t)cells + 63) / 64;
+}
+
+static int bit_get(const uint64_t *bits, int index) {
+    return (int)((bits[index >> 6] >> (index & 63)) & 1u);
+}
+
+static void bit_put(uint64_t *bits, int index, int value) {
+    uint64_t mask = (uint64_t)1 << (index & 63);
+    if (value) {
+        bits[index >> 6] |= mask;
+    } else {
+        bits[index >> 6] &= ~mask;
+    }
+}
+
+void game_init(Game *g) {
     if (!g) return;
     memset(g, 0, sizeof(*g));
+}
+
+static void release_board(Game *g) {
+    int i;
+    free(g->block_right);
+    free(g->block_down);
+    free(g->h_wall_at);
+    free(g->v_wall_at);
+    free(g->mark);
+    free(g->queue);
+    free(g->visit_bits);
+    free(g->trail);
+    for (i = 0; i < PLAYER_COUNT; i++) {
+        free(g->cert_path[i]);
+        free(g->cert_bits[i]);
+    }
+}
+
+void game_free(Game *g) {
+    if (!g) return;
+    release_board(g);
+    game_init(g);
+}
+
+#define BOARD_BITSETS (5 + PLAYER_COUNT)
+
+static int reserve_board(Game *g, int size) {
+    int cells = size * size;
+    size_t words = bit_words(cells);
+    uint64_t *bits[BOARD_BITSETS];
+    int *paths[PLAYER_COUNT];
+    unsigned char *mark;
+    unsigned char *trail;
+    int *queue;
+    int ok = 1;
+    int i;
+
+    if (cells <= g->capacity) return 1;
+
+    for (i = 0; i < BOARD_BITSETS; i++) {
+        bits[i] = (uint64_t *)calloc(words, sizeof(uint64_t));
+        if (!bits[i]) ok = 0;
+    }
+    for (i = 0; i < PLAYER_COUNT; i++) {
+        paths[i] = (int *)malloc((size_t)cells * sizeof(int));
+        if (!paths[i]) ok = 0;
+    }
+    mark = (unsigned char *)malloc((size_t)cells);
+    trail = (unsigned char *)calloc((size_t)cells, 1);
+    queue = (int *)malloc((size_t)cells * sizeof(int));
+    if (!ok || !mark || !trail || !queue) {
+        for (i = 0; i < BOARD_BITSETS; i++) free(bits[i]);
+        for (i = 0; i < PLAYER_COUNT; i++) free(paths[i]);
+        free(mark);
+        free(trail);
+        free(queue);
+        return 0;
+    }
+
+    release_board(g);
+    g->block_right = bits[0];
+    g->block_down = bits[1];
+    g->h_wall_at = bits[2];
+    g->v_wall_at = bits[3];
+    g->visit_bits = bits[4];
+    for (i = 0; i < PLAYER_COUNT; i++) {
+        g->cert_bits[i] = bits[5 + i];
+        g->cert_path[i] = paths[i];
+        g->cert_len[i] = 0;
+    }
+    g->mark = mark;
+    g->trail = trail;
+    g->queue = queue;
+    g->capacity = cells;
+    return 1;
+}
+
+static void cert_push(Game *g, int player, int cell) {
+    g->cert_path[player][g->cert_len[player]++] = cell;
+    bit_put(g->cert_bits[player], cell, 1);
+}
+
+static void cert_truncate(Game *g, int player, int len) {
+    int i;
+    for (i = len; i < g->cert_len[player]; i++) {
+        bit_put(g->cert_bits[player], g->cert_path[player][i], 0);
+    }
+    g->cert_len[player] = len;
+}
+
+static void cert_drop(Game *g, int player) {
+    cert_truncate(g, player, 0);
+}
+
+/* Scans from the pawn end, where pawn moves look things up. */
+static int cert_index(const Game *g, int player, int cell) {
+    int i;
+    if (!bit_get(g->cert_bits[player], cell)) return -1;
+    for (i = g->cert_len[player] - 1; i >= 0; i--) {
+        if (g->cert_path[player][i] == cell) return i;
+    }
+    return -1;
+}
+
+/* Keeps the path ending at the pawn after it steps onto `cell`: walking
+ * along the path shortens it, a step off it through an open edge extends
+ * it, anything else forgets it. */
+static void cert_step(Game *g, int player, int cell) {
+    int n = g->size;
+    int len = g->cert_len[player];
+    int at;
+    int tail;
+
+    if (len == 0) return;
+    at = cert_index(g, player, cell);
+    if (at >= 0) {
+        cert_truncate(g, player, at + 1);
+        return;
+    }
+    tail = g->cert_path[player][len - 1];
+    if (game_is_blocked(g, tail / n, tail % n, cell / n, cell % n)) {
+        cert_drop(g, player);
+        return;
+    }
+    cert_push(g, player, cell);
+}
+
+static void clear_all_walls(Game *g) {
+    size_t bytes = bit_words(g->size * g->size) * sizeof(uint64_t);
+    memset(g->block_right, 0, bytes);
+    memset(g->block_down, 0, bytes);
+    memset(g->h_wall_at, 0, bytes);
+    memset(g->v_wall_at, 0, bytes);
+}
+
+int game_clear(Game *g, int size) {
+    int i;
+    if (!g) return 0;
+    if (size < MIN_SIZE || size > MAX_SIZE) return 0;
+    if (!reserve_board(g, size)) return 0;
+
     g->size = size;
+    for (i = 0; i < PLAYER_COUNT; i++) {
+        g->players[i].row = 0;
+        g->players[i].col = 0;
+        g->walls_left[i] = 0;
+        g->blocked_turns[i] = 0;
+    }
     g->mode = MODE_PVP;
     g->current_player = 0;
+    g->rng = ((uint64_t)rand() << 32) ^ (uint64_t)rand();
+    for (i = 0; i < PLAYER_COUNT; i++) cert_drop(g, i);
+    clear_all_walls(g);
     copy_text(g->player_name[0], NAME_SIZE, "Player1");
     copy_text(g->player_name[1], NAME_SIZE, "Player2");
+    return 1;
+}
+
+int game_copy(Game *dst, const Game *src) {
+    size_t bytes;
+    int i;
+    int p;
+    if (!dst || !src || dst == src) return 0;
+    if (!reserve_board(dst, src->size)) return 0;
+
+    bytes = bit_words(src->size * src->size) * sizeof(uint64_t);
+    dst->size = src->size;
+    memcpy(dst->players, src->players, sizeof(dst->players));
+    memcpy(dst->walls_left, src->walls_left, sizeof(dst->walls_left));
+    memcpy(dst->blocked_turns, src->blocked_turns, sizeof(dst->blocked_turns));
+    dst->current_player = src->current_player;
+    dst->mode = src->mode;
+    dst->rng = src->rng;
+    memcpy(dst->player_name, src->player_name, sizeof(dst->player_name));
+    memcpy(dst->block_right, src->block_right, bytes);
+    memcpy(dst->block_down, src->block_down, bytes);
+    memcpy(dst->h_wall_at, src->h_wall_at, bytes);
+    memcpy(dst->v_wall_at, src->v_wall_at, bytes);
+    for (p = 0; p < PLAYER_COUNT; p++) {
+        cert_drop(dst, p);
+        for (i = 0; i < src->cert_len[p]; i++) cert_push(dst, p, src->cert_path[p][i]);
+    }
+    return 1;
 }
 
-void game_start(Game *g, int size, int walls_per_player, GameMode mode, const char *name1, const char *name2) {
+int game_start(Game *g, int size, int walls_per_player, GameMode mode, const char *name1, const char *name2) {
     int center_top;
     int center_bottom;
-    if (!g) return;
+    if (!g) return 0;
 
-    game_clear(g, size);
+    if (!game_clear(g, size)) return 0;
     g->mode = mode;
     g->walls_left[0] = walls_per_player;
     g->walls_left[1] = walls_per_player;
@@ -51,6 +270,7 @@ void game_start(Game *g, int size, int walls_per_player, GameMode mode, const ch
     g->players[0].col = center_bottom;
     g->players[1].row = 0;
     g->players[1].col = center_top;
+    return 1;
 }
 
 int game_set_player_pos(Game *g, int player, int row, int col) {
@@ -59,11 +279,31 @@ int game_set_player_pos(Game *g, int player, int row, int col) {
     if (!game_in_range(g, row, col)) return 0;
     if (player == 0 && g->players[1].row == row && g->players[1].col == col) return 0;
     if (player == 1 && g->players[0].row == row && g->players[0].col == col) return 0;
+    cert_step(g, player, row * g->size + col);
     g->players[player].row = row;
     g->players[player].col = col;
     return 1;
 }
 
+/* Places every pawn at once, for loaders that start from game_clear with
+ * all pawns on (0,0). Known paths are forgotten. */
+int game_set_pawns(Game *g, const Pos *pawns) {
+    int i;
+    int j;
+    if (!g || !pawns) return 0;
+    for (i = 0; i < PLAYER_COUNT; i++) {
+        if (!game_in_range(g, pawns[i].row, pawns[i].col)) return 0;
+        for (j = 0; j < i; j++) {
+            if (pawns[j].row == pawns[i].row && pawns[j].col == pawns[i].col) return 0;
+        }
+    }
+    for (i = 0; i < PLAYER_COUNT; i++) {
+        g->players[i] = pawns[i];
+        cert_drop(g, i);
+    }
+    return 1;
+}
+
 int game_in_range(const Game *g, int row, int col) {
     return g && row >= 0 && col >= 0 && row < g->size && col < g->size;
 }
@@ -71,19 +311,35 @@ int game_in_range(const Game *g, int row, int col) {
 int game_is_blocked(const Game *g, int r1, int c1, int r2, int c2) {
     if (!game_in_range(g, r1, c1) || !game_in_range(g, r2, c2)) return 1;
     if (r1 == r2) {
-        if (c2 == c1 + 1) return g->block_right[r1][c1] != 0;
-        if (c2 == c1 - 1) return g->block_right[r1][c2] != 0;
+        if (c2 == c1 + 1) return bit_get(g->block_right, r1 * g->size + c1);
+        if (c2 == c1 - 1) return bit_get(g->block_right, r1 * g->size + c2);
     }
     if (c1 == c2) {
-        if (r2 == r1 + 1) return g->block_down[r1][c1] != 0;
-        if (r2 == r1 - 1) return g->block_down[r2][c1] != 0;
+        if (r2 == r1 + 1) return bit_get(g->block_down, r1 * g->size + c1);
+        if (r2 == r1 - 1) return bit_get(g->block_down, r2 * g->size + c1);
     }
     return 1;
 }
 
-static int goal_row_for_player(const Game *g, int player) {
-    if (!g) return -1;
-    return (player == 0) ? 0 : (g->size - 1);
+enum {
+    SIDE_TOP = 0,
+    SIDE_BOTTOM = 1,
+    SIDE_RIGHT = 2,
+    SIDE_LEFT = 3
+};
+
+static int goal_side_for_player(int player) {
+    static const int sides[4] = {SIDE_TOP, SIDE_BOTTOM, SIDE_RIGHT, SIDE_LEFT};
+    return sides[player % 4];
+}
+
+static int cell_side_mask(const Game *g, int row, int col) {
+    int mask = 0;
+    if (row == 0) mask |= 1 << SIDE_TOP;
+    if (row == g->size - 1) mask |= 1 << SIDE_BOTTOM;
+    if (col == g->size - 1) mask |= 1 << SIDE_RIGHT;
+    if (col == 0) mask |= 1 << SIDE_LEFT;
+    return mask;
 }
 
 static int is_cell_occupied(const Game *g, int row, int col, int ignore_player) {
@@ -95,72 +351,326 @@ static int is_cell_occupied(const Game *g, int row, int col, int ignore_player)
     return 0;
 }
 
-static void set_wall(Game *g, int row, int col, WallDir dir, unsigned char value) {
+static void set_wall(Game *g, int row, int col, WallDir dir, int value) {
+    int at = row * g->size + col;
     if (dir == DIR_H) {
-        g->block_down[row][col] = value;
-        g->block_down[row][col + 1] = value;
-        g->h_wall_at[row][col] = value;
+        bit_put(g->block_down, at, value);
+        bit_put(g->block_down, at + 1, value);
+        bit_put(g->h_wall_at, at, value);
     } else {
-        g->block_right[row][col] = value;
-        g->block_right[row + 1][col] = value;
-        g->v_wall_at[row][col] = value;
+        bit_put(g->block_right, at, value);
+        bit_put(g->block_right, at + g->size, value);
+        bit_put(g->v_wall_at, at, value);
     }
 }
 
 int game_can_place_wall(const Game *g, int row, int col, WallDir dir) {
+    int at;
     if (!g) return 0;
     if (row < 0 || col < 0 || row >= g->size - 1 || col >= g->size - 1) return 0;
 
+    at = row * g->size + col;
     if (dir == DIR_H) {
-        if (g->v_wall_at[row][col]) return 0;
-        if (g->block_down[row][col] || g->block_down[row][col + 1]) return 0;
+        if (bit_get(g->v_wall_at, at)) return 0;
+        if (bit_get(g->block_down, at) || bit_get(g->block_down, at + 1)) return 0;
         return 1;
     }
 
-    if (g->h_wall_at[row][col]) return 0;
-    if (g->block_right[row][col] || g->block_right[row + 1][col]) return 0;
+    if (bit_get(g->h_wall_at, at)) return 0;
+    if (bit_get(g->block_right, at) || bit_get(g->block_right, at + g->size)) return 0;
     return 1;
 }
 
-int game_add_wall_from_map(Game *g, int row, int col, WallDir dir) {
-    if (!game_can_place_wall(g, row, col, dir)) return 0;
-    set_wall(g, row, col, dir, 1);
+/* Direction order matches the step tables: up, down, left, right. */
+static int edge_open(const Game *g, int cell, int row, int col, int dir) {
+    int n = g->size;
+    if (dir == 0) return row > 0 && !bit_get(g->block_down, cell - n);
+    if (dir == 1) return row < n - 1 && !bit_get(g->block_down, cell);
+    if (dir == 2) return col > 0 && !bit_get(g->block_right, cell - 1);
+    return col < n - 1 && !bit_get(g->block_right, cell);
+}
+
+#define MARK_PAWN 0x80
+#define MARK_LABEL 0x7F
+
+static int players_settled(const Game *g, const int *sides, int label) {
+    int q;
+    for (q = 0; q < PLAYER_COUNT; q++) {
+        int m = g->mark[g->players[q].row * g->size + g->players[q].col] & MARK_LABEL;
+        if (m == 0) return 0;
+        if (m == label && !(sides[label] & (1 << goal_side_for_player(q)))) return 0;
+    }
     return 1;
 }
 
-static int has_path_to_goal(const Game *g, int player) {
-    int visited[MAX_SIZE][MAX_SIZE] = {0};
-    Pos queue[MAX_SIZE * MAX_SIZE];
+/* Each pawn's goal cell from the goal sides its region reached first. */
+static void region_goals(const Game *g, int side_cell[][4], int *goal_cells) {
+    int q;
+    for (q = 0; goal_cells && q < PLAYER_COUNT; q++) {
+        int m = g->mark[g->players[q].row * g->size + g->players[q].col] & MARK_LABEL;
+        goal_cells[q] = side_cell[m][goal_side_for_player(q)];
+    }
+}
+
+/* One flood per connected region instead of one BFS per player: a region
+ * settles every pawn inside it by the goal sides it touches, so the cost
+ * does not grow with PLAYER_COUNT. The flood stops early once every pawn
+ * is either settled by it or by an earlier, completed flood. With
+ * goal_cells it also leaves the flood tree in trail, as
+ * parpath_all_players_have_path does. */
+static int serial_paths_open(Game *g, int *goal_cells) {
+    unsigned char *mark = g->mark;
+    unsigned char *trail = goal_cells ? g->trail : NULL;
+    int *queue = g->queue;
+    int sides[PLAYER_COUNT + 1];
+    int side_cell[PLAYER_COUNT + 1][4];
+    int n = g->size;
+    const int step[4] = {-n, n, -1, 1};
+    int p;
+
+    memset(mark, 0, (size_t)n * (size_t)n);
+    for (p = 0; p < PLAYER_COUNT; p++) {
+        Pos start = g->players[p];
+        if (!game_in_range(g, start.row, start.col)) return 0;
+        mark[start.row * n + start.col] |= MARK_PAWN;
+    }
+
+    for (p = 0; p < PLAYER_COUNT; p++) {
+        Pos start = g->players[p];
+        int label = p + 1;
+        int head = 0;
+        int tail = 0;
+        int q;
+
+        if (mark[start.row * n + start.col] & MARK_LABEL) continue;
+        sides[label] = 0;
+        mark[start.row * n + start.col] |= (unsigned char)label;
+        if (trail) trail[start.row * n + start.col] = 5;
+        queue[tail++] = start.row * n + start.col;
+
+        while (head < tail) {
+            int cell = queue[head++];
+            int cr = cell / n;
+            int cc = cell % n;
+            int reached = sides[label] | cell_side_mask(g, cr, cc);
+            int i;
+
+            if (reached != sides[label] || (mark[cell] & MARK_PAWN)) {
+                for (i = 0; i < 4; i++) {
+                    if (((reached & ~sides[label]) >> i) & 1) side_cell[label][i] = cell;
+                }
+                sides[label] = reached;
+                if (players_settled(g, sides, label)) {
+                    region_goals(g, side_cell, goal_cells);
+                    return 1;
+                }
+            }
+
+            for (i = 0; i < 4; i++) {
+                int next = cell + step[i];
+                if (!edge_open(g, cell, cr, cc, i)) continue;
+                if (mark[next] & MARK_LABEL) continue;
+                mark[next] |= (unsigned char)label;
+                if (trail) trail[next] = (unsigned char)(i + 1);
+                queue[tail++] = next;
+            }
+        }
+
+        for (q = 0; q < PLAYER_COUNT; q++) {
+            int m = mark[g->players[q].row * n + g->players[q].col] & MARK_LABEL;
+            if (m == label && !(sides[label] & (1 << goal_side_for_player(q)))) return 0;
+        }
+    }
+    region_goals(g, side_cell, goal_cells);
+    return 1;
+}
+
+/* Index k of the path edge path[k]-path[k + 1] joining cells a and b,
+ * or -1 when the path does not use that edge. */
+static int cert_edge(const Game *g, int player, int a, int b) {
+    int i;
+    if (!bit_get(g->cert_bits[player], a) || !bit_get(g->cert_bits[player], b)) return -1;
+    i = cert_index(g, player, a);
+    if (i > 0 && g->cert_path[player][i - 1] == b) return i - 1;
+    if (i + 1 < g->cert_len[player] && g->cert_path[player][i + 1] == b) return i;
+    return -1;
+}
+
+/* Keeps the first `keep` cells of the path (the goal end, still intact)
+ * and reconnects the pawn to them: a BFS from the pawn stops at the first
+ * kept cell or goal cell it meets. keep 0 finds a whole new path.
+ * Returns 0, with the path forgotten, when the goal is out of reach. */
+static int cert_repair(Game *g, int player, int keep) {
+    unsigned char *trail = g->trail;
+    int *queue = g->queue;
+    const uint64_t *bits = g->cert_bits[player];
+    int n = g->size;
+    const int step[4] = {-n, n, -1, 1};
+    Pos pawn = g->players[player];
+    int start;
     int head = 0;
     int tail = 0;
-    int goal = goal_row_for_player(g, player);
-    Pos start = g->players[player];
-    const int dr[4] = {-1, 1, 0, 0};
-    const int dc[4] = {0, 0, -1, 1};
+    int hit = -1;
+    int cell;
     int i;
 
-    if (!game_in_range(g, start.row, start.col)) return 0;
-
-    visited[start.row][start.col] = 1;
+    cert_truncate(g, player, keep);
+    if (!game_in_range(g, pawn.row, pawn.col)) return 0;
+    start = pawn.row * n + pawn.col;
+    trail[start] = 5;
     queue[tail++] = start;
 
     while (head < tail) {
-        Pos cur = queue[head++];
-        if (cur.row == goal) return 1;
-
+        int cr;
+        int cc;
+        cell = queue[head++];
+        cr = cell / n;
+        cc = cell % n;
+        if (bit_get(bits, cell) || game_is_goal(g, player, cr, cc)) {
+            hit = cell;
+            break;
+        }
         for (i = 0; i < 4; i++) {
-            int nr = cur.row + dr[i];
-            int nc = cur.col + dc[i];
-            if (!game_in_range(g, nr, nc)) continue;
-            if (visited[nr][nc]) continue;
-            if (game_is_blocked(g, cur.row, cur.col, nr, nc)) continue;
-            visited[nr][nc] = 1;
-            queue[tail].row = nr;
-            queue[tail].col = nc;
-            tail++;
+            int next = cell + step[i];
+            if (!edge_open(g, cell, cr, cc, i)) continue;
+            if (trail[next]) continue;
+            trail[next] = (unsigned char)(i + 1);
+            queue[tail++] = next;
         }
     }
-    return 0;
+
+    if (hit >= 0) {
+        if (bit_get(bits, hit)) {
+            cert_truncate(g, player, cert_index(g, player, hit) + 1);
+        } else {
+            cert_drop(g, player);
+            cert_push(g, player, hit);
+        }
+        for (cell = hit; cell != start;) {
+            cell -= step[trail[cell] - 1];
+            cert_push(g, player, cell);
+        }
+    } else {
+        cert_drop(g, player);
+    }
+    for (i = 0; i < tail; i++) trail[queue[i]] = 0;
+    return hit >= 0;
+}
+
+/* Cells on both sides of the two edges a wall blocks, as pairs. */
+static void wall_edge_cells(const Game *g, int row, int col, WallDir dir, int cells[4]) {
+    int n = g->size;
+    int at = row * n + col;
+    int across = dir == DIR_H ? n : 1;
+    int along = dir == DIR_H ? 1 : n;
+    cells[0] = at;
+    cells[1] = at + across;
+    cells[2] = at + along;
+    cells[3] = at + along + across;
+}
+
+/* Rebuilds the path from the player's pawn to goal along the flood tree
+ * in trail: up from the pawn to the root, then from goal up to the first
+ * cell of that chain, so the path has no repeated cell. Marks the pawn's
+ * chain with the top bit of trail while it works. */
+static void cert_from_tree(Game *g, int player, int goal) {
+    unsigned char *trail = g->trail;
+    int *chain = g->queue;
+    int n = g->size;
+    const int step[4] = {-n, n, -1, 1};
+    int len = 0;
+    int cell = g->players[player].row * n + g->players[player].col;
+    int i;
+
+    for (;;) {
+        int dir = trail[cell] & 0x7F;
+        trail[cell] |= 0x80;
+        chain[len++] = cell;
+        if (dir == 5) break;
+        cell -= step[dir - 1];
+    }
+    cert_drop(g, player);
+    for (cell = goal; !(trail[cell] & 0x80); cell -= step[(trail[cell] & 0x7F) - 1]) cert_push(g, player, cell);
+    for (i = 0; chain[i] != cell; i++) {
+    }
+    for (; i >= 0; i--) cert_push(g, player, chain[i]);
+    for (i = 0; i < len; i++) trail[chain[i]] &= 0x7F;
+}
+
+static int paths_open(Game *g, int threads, int *goal_cells) {
+    if (threads <= 0) threads = parpath_auto_threads(g);
+    if (threads > 1) return parpath_all_players_have_path(g, threads, goal_cells);
+    return serial_paths_open(g, goal_cells);
+}
+
+/* Called with the wall already set. Only players whose path crosses one
+ * of the blocked edges need a search, and that search only has to reach
+ * the part of the path between the goal and the first cut. When a player
+ * has no path to keep, or every player needs a search, one flood for all
+ * of them is cheaper (and threaded on large boards); the cut paths are
+ * then rebuilt from its tree. */
+static int certs_survive_wall(Game *g, int row, int col, WallDir dir) {
+    int cells[4];
+    int keep[PLAYER_COUNT];
+    int goal[PLAYER_COUNT];
+    int need = 0;
+    int full = 0;
+    int ok;
+    int p;
+
+    wall_edge_cells(g, row, col, dir, cells);
+    for (p = 0; p < PLAYER_COUNT; p++) {
+        int len = g->cert_len[p];
+        int e;
+        keep[p] = len;
+        for (e = 0; e < 4; e += 2) {
+            int k = cert_edge(g, p, cells[e], cells[e + 1]);
+            if (k >= 0 && k + 1 < keep[p]) keep[p] = k + 1;
+        }
+        if (len > 0 && keep[p] == len) continue;
+        need++;
+        if (keep[p] == 0) full = 1;
+    }
+    if (need == 0) return 1;
+
+    if (!full && need < PLAYER_COUNT) {
+        for (p = 0; p < PLAYER_COUNT; p++) {
+            if (g->cert_len[p] > 0 && keep[p] == g->cert_len[p]) continue;
+            if (!cert_repair(g, p, keep[p])) return 0;
+        }
+        return 1;
+    }
+
+    ok = paths_open(g, 0, goal);
+    if (ok) {
+        for (p = 0; p < PLAYER_COUNT; p++) {
+            if (g->cert_len[p] > 0 && keep[p] == g->cert_len[p]) continue;
+            cert_from_tree(g, p, goal[p]);
+        }
+    }
+    memset(g->trail, 0, (size_t)g->size * (size_t)g->size);
+    return ok;
+}
+
+int game_add_wall_from_map(Game *g, int row, int col, WallDir dir) {
+    int cells[4];
+    int p;
+    if (!game_can_place_wall(g, row, col, dir)) return 0;
+    set_wall(g, row, col, dir, 1);
+
+    /* Map walls skip the path check; forget any path they cut. */
+    wall_edge_cells(g, row, col, dir, cells);
+    for (p = 0; p < PLAYER_COUNT; p++) {
+        if (cert_edge(g, p, cells[0], cells[1]) >= 0 || cert_edge(g, p, cells[2], cells[3]) >= 0) {
+            cert_drop(g, p);
+        }
+    }
+    return 1;
+}
+
+int game_paths_open(Game *g, int threads) {
+    if (!g) return 0;
+    return paths_open(g, threads, NULL);
 }
 
 int game_place_wall(Game *g, int player, int row, int col, WallDir dir, char *err, size_t err_cap) {
@@ -177,7 +687,7 @@ int game_place_wall(Game *g, int player, int row, int col, WallDir dir, char *er
     }
 
     set_wall(g, row, col, dir, 1);
-    if (!has_path_to_goal(g, 0) || !has_path_to_goal(g, 1)) {
+    if (!certs_survive_wall(g, row, col, dir)) {
         set_wall(g, row, col, dir, 0);
         if (err) snprintf(err, err_cap, "Wall blocks all paths.");
         return 0;
@@ -187,6 +697,21 @@ int game_place_wall(Game *g, int player, int row, int col, WallDir dir, char *er
     return 1;
 }
 
+int game_remove_wall(Game *g, int player, int row, int col, WallDir dir) {
+    if (!g) return 0;
+    if (player < 0 || player >= PLAYER_COUNT) return 0;
+    if (!game_wall_at(g, row, col, dir)) return 0;
+    set_wall(g, row, col, dir, 0);
+    g->walls_left[player]++;
+    return 1;
+}
+
+int game_wall_at(const Game *g, int row, int col, WallDir dir) {
+    if (!g) return 0;
+    if (row < 0 || col < 0 || row >= g->size - 1 || col >= g->size - 1) return 0;
+    return bit_get(dir == DIR_H ? g->h_wall_at : g->v_wall_at, row * g->size + col);
+}
+
 int game_can_move(const Game *g, int player, Pos target) {
     Pos cur;
     Pos opp;
@@ -304,14 +829,36 @@ int game_move_player(Game *g, int player, Pos target, char *err, size_t err_cap)
         if (err) snprintf(err, err_cap, "Invalid move.");
         return 0;
     }
+    if (abs(target.row - g->players[player].row) + abs(target.col - g->players[player].col) != 1) {
+        Pos opp = g->players[1 - player];
+        cert_step(g, player, opp.row * g->size + opp.col);
+    }
+    cert_step(g, player, target.row * g->size + target.col);
     g->players[player] = target;
     return 1;
 }
 
+int game_is_goal(const Game *g, int player, int row, int col) {
+    if (!game_in_range(g, row, col)) return 0;
+    if (player < 0 || player >= PLAYER_COUNT) return 0;
+    return (cell_side_mask(g, row, col) >> goal_side_for_player(player)) & 1;
+}
+
+int game_goal_side(int player) {
+    return goal_side_for_player(player);
+}
+
+int game_cell_sides(const Game *g, int row, int col) {
+    if (!game_in_range(g, row, col)) return 0;
+    return cell_side_mask(g, row, col);
+}
+
 int game_check_winner(const Game *g) {
+    int i;
     if (!g) return -1;
-    if (g->players[0].row == 0) return 0;
-    if (g->players[1].row == g->size - 1) return 1;
+    for (i = 0; i < PLAYER_COUNT; i++) {
+        if (game_is_goal(g, i, g->players[i].row, g->players[i].col)) return i;
+    }
     return -1;
 }
 
@@ -319,54 +866,111 @@ int game_next_player(int current_player) {
     return (current_player + 1) % PLAYER_COUNT;
 }
 
-static void clear_all_walls(Game *g) {
-    memset(g->block_right, 0, sizeof(g->block_right));
-    memset(g->block_down, 0, sizeof(g->block_down));
-    memset(g->h_wall_at, 0, sizeof(g->h_wall_at));
-    memset(g->v_wall_at, 0, sizeof(g->v_wall_at));
+/* Draws in the same order as always (target, effect, then the amount for
+ * effects that have one), so recorded sessions replay unchanged. */
+void game_apply_magic(Game *g, char *msg, size_t msg_cap) {
+    MagicOutcome m;
+    unsigned int r;
+    if (!g) return;
+
+    m.target = (int)(game_random(g) % PLAYER_COUNT);
+    m.effect = (MagicEffect)(game_random(g) % MAGIC_EFFECTS);
+    m.amount = 0;
+    m.weight = 0;
+    if (m.effect != MAGIC_CLEAR_WALLS) {
+        r = game_random(g) % 2;
+        if (m.effect == MAGIC_LOSE_WALLS || m.effect == MAGIC_GAIN_WALLS) {
+            m.amount = r ? 2 : 3;
+        } else {
+            m.amount = (int)r + 1;
+        }
+    }
+    game_apply_magic_outcome(g, &m, msg, msg_cap);
 }
 
-void game_apply_magic(Game *g, char *msg, size_t msg_cap) {
+/* Every outcome game_apply_magic can draw, with its weight. */
+int game_magic_outcomes(MagicOutcome *out) {
+    int count = 0;
+    int e;
+    int t;
+    int a;
+    if (!out) return 0;
+
+    out[count].effect = MAGIC_CLEAR_WALLS;
+    out[count].target = 0;
+    out[count].amount = 0;
+    out[count].weight = MAGIC_WEIGHT_TOTAL / MAGIC_EFFECTS;
+    count++;
+    for (e = MAGIC_LOSE_WALLS; e < MAGIC_EFFECTS; e++) {
+        for (t = 0; t < PLAYER_COUNT; t++) {
+            for (a = 0; a < 2; a++) {
+                out[count].effect = (MagicEffect)e;
+                out[count].target = t;
+                if (e == MAGIC_LOSE_WALLS || e == MAGIC_GAIN_WALLS) {
+                    out[count].amount = a ? 2 : 3;
+                } else {
+                    out[count].amount = a + 1;
+                }
+                out[count].weight = 1;
+                count++;
+            }
+        }
+    }
+    return count;
+}
+
+int game_magic_counters(const MagicOutcome *m, int *walls_left, int *blocked_turns) {
     int target;
     int other;
-    int effect;
     int amount;
-    if (!g) return;
+    if (!m || !walls_left || !blocked_turns) return 0;
 
-    target = rand() % PLAYER_COUNT;
+    target = m->target;
     other = 1 - target;
-    effect = rand() % 5;
+    amount = m->amount;
+    if (m->effect == MAGIC_CLEAR_WALLS) return 0;
+    if (m->effect == MAGIC_LOSE_WALLS) {
+        walls_left[target] -= amount;
+        if (walls_left[target] < 0) walls_left[target] = 0;
+        return amount;
+    }
+    if (m->effect == MAGIC_BLOCK) {
+        blocked_turns[target] += amount;
+        return amount;
+    }
+    if (m->effect == MAGIC_GAIN_WALLS) {
+        walls_left[target] += amount;
+        return amount;
+    }
+    if (walls_left[other] < amount) amount = walls_left[other];
+    walls_left[other] -= amount;
+    walls_left[target] += amount;
+    return amount;
+}
 
-    if (effect == 0) {
+void game_apply_magic_outcome(Game *g, const MagicOutcome *m, char *msg, size_t msg_cap) {
+    int target;
+    int amount;
+    if (!g || !m) return;
+
+    target = m->target;
+    if (m->effect == MAGIC_CLEAR_WALLS) {
         clear_all_walls(g);
-        snprintf(msg, msg_cap, "Magic: all walls removed.");
+        if (msg) snprintf(msg, msg_cap, "Magic: all walls removed.");
         return;
     }
-    if (effect == 1) {
-        amount = (rand() % 2) ? 2 : 3;
-        g->walls_left[target] -= amount;
-        if (g->walls_left[target] < 0) g->walls_left[target] = 0;
+    amount = game_magic_counters(m, g->walls_left, g->blocked_turns);
+    if (!msg) return;
+    if (m->effect == MAGIC_LOSE_WALLS) {
         snprintf(msg, msg_cap, "Magic: %s lost %d walls.", g->player_name[target], amount);
-        return;
-    }
-    if (effect == 2) {
-        amount = (rand() % 2) + 1;
-        g->blocked_turns[target] += amount;
+    } else if (m->effect == MAGIC_BLOCK) {
         snprintf(msg, msg_cap, "Magic: %s blocked for %d turn(s).", g->player_name[target], amount);
-        return;
-    }
-    if (effect == 3) {
-        amount = (rand() % 2) ? 2 : 3;
-        g->walls_left[target] += amount;
+    } else if (m->effect == MAGIC_GAIN_WALLS) {
         snprintf(msg, msg_cap, "Magic: %s gained %d walls.", g->player_name[target], amount);
-        return;
+    } else {
+        snprintf(msg, msg_cap, "Magic: %s stole %d wall(s) from %s.", g->player_name[target], amount,
+                 g->player_name[1 - target]);
     }
-
-    amount = (rand() % 2) + 1;
-    if (g->walls_left[other] < amount) amount = g->walls_left[other];
-    g->walls_left[other] -= amount;
-    g->walls_left[target] += amount;
-    snprintf(msg, msg_cap, "Magic: %s stole %d wall(s) from %s.", g->player_name[target], amount, g->player_name[other]);
 }
 
 int game_try_ai_turn(Game *g, char *msg, size_t msg_cap) {
@@ -384,11 +988,11 @@ int game_try_ai_turn(Game *g, char *msg, size_t msg_cap) {
         return 0;
     }
 
-    if (g->walls_left[player] > 0 && (rand() % 100) < 35) {
+    if (g->walls_left[player] > 0 && (game_random(g) % 100) < 35) {
         for (i = 0; i < 250; i++) {
-            int row = rand() % (g->size - 1);
-            int col = rand() % (g->size - 1);
-            WallDir dir = (rand() % 2) ? DIR_H : DIR_V;
+            int row = game_random(g) % (g->size - 1);
+            int col = game_random(g) % (g->size - 1);
+            WallDir dir = (game_random(g) % 2) ? DIR_H : DIR_V;
             if (game_place_wall(g, player, row, col, dir, err, sizeof(err))) {
                 snprintf(msg, msg_cap, "Computer placed wall at (%d, %d) %c.", row, col, dir == DIR_H ? 'H' : 'V');
                 return 1;
@@ -397,16 +1001,16 @@ int game_try_ai_turn(Game *g, char *msg, size_t msg_cap) {
     }
 
     if (move_count > 0) {
-        Pos choice = moves[rand() % move_count];
+        Pos choice = moves[game_random(g) % move_count];
         game_move_player(g, player, choice, err, sizeof(err));
         snprintf(msg, msg_cap, "Computer moved to (%d, %d).", choice.row, choice.col);
         return 1;
     }
 
     for (i = 0; i < 250; i++) {
-        int row = rand() % (g->size - 1);
-        int col = rand() % (g->size - 1);
-        WallDir dir = (rand() % 2) ? DIR_H : DIR_V;
+        int row = game_random(g) % (g->size - 1);
+        int col = game_random(g) % (g->size - 1);
+        WallDir dir = (game_random(g) % 2) ? DIR_H : DIR_V;
         if (game_place_wall(g, player, row, col, dir, err, sizeof(err))) {
             snprintf(msg, msg_cap, "Computer placed wall at (%d, %d) %c.", row, col, dir == DIR_H ? 'H' : 'V');
             return 1;
@@ -2,8 +2,10 @@
 #define SIMPLE_GAME_H
 
 #include <stddef.h>
+#include <stdint.h>
 
-#define MAX_SIZE 50
+#define MIN_SIZE 2
+#define MAX_SIZE 2048
 #define PLAYER_COUNT 2
 #define NAME_SIZE 32
 
@@ -22,39 +24,101 @@ typedef struct {
     int col;
 } Pos;
 
+#define MAGIC_OUTCOMES 17
+#define MAGIC_WEIGHT_TOTAL 20
+
+typedef enum {
+    MAGIC_CLEAR_WALLS = 0,
+    MAGIC_LOSE_WALLS,
+    MAGIC_BLOCK,
+    MAGIC_GAIN_WALLS,
+    MAGIC_STEAL_WALLS,
+    MAGIC_EFFECTS
+} MagicEffect;
+
+/* One result of the magic box. weight is its chance in units of
+ * 1/MAGIC_WEIGHT_TOTAL: the target is even odds, each effect 1 in 5 and
+ * each amount even odds, and clearing the walls ignores both. */
+typedef struct {
+    MagicEffect effect;
+    int target;
+    int amount;
+    int weight;
+} MagicOutcome;
+
 typedef struct {
     int size;
     Pos players[PLAYER_COUNT];
     int walls_left[PLAYER_COUNT];
-    unsigned char block_right[MAX_SIZE][MAX_SIZE];
-    unsigned char block_down[MAX_SIZE][MAX_SIZE];
-    unsigned char h_wall_at[MAX_SIZE][MAX_SIZE];
-    unsigned char v_wall_at[MAX_SIZE][MAX_SIZE];
     int blocked_turns[PLAYER_COUNT];
     int current_player;
     GameMode mode;
     char player_name[PLAYER_COUNT][NAME_SIZE];
+
+    /* Per-game random stream for magic and the fallback AI, so games on
+     * different threads do not share rand(). */
+    uint64_t rng;
+
+    /* One bit per cell, index row * size + col; sized to the board. */
+    int capacity;
+    uint64_t *block_right;
+    uint64_t *block_down;
+    uint64_t *h_wall_at;
+    uint64_t *v_wall_at;
+
+    /* Path-check scratch, allocated with the board and reused. */
+    unsigned char *mark;
+    int *queue;
+    uint64_t *visit_bits;
+    unsigned char *trail;
+
+    /* Last known path from each pawn to its goal, goal cell first and pawn
+     * cell last, plus a bitmap of its cells. A wall that cuts neither of
+     * its two edges out of every path cannot disconnect anyone.
+     * cert_len 0 means no path is known. */
+    int *cert_path[PLAYER_COUNT];
+    uint64_t *cert_bits[PLAYER_COUNT];
+    int cert_len[PLAYER_COUNT];
 } Game;
 
 void game_seed_rng(void);
-void game_clear(Game *g, int size);
-void game_start(Game *g, int size, int walls_per_player, GameMode mode, const char *name1, const char *name2);
+void game_seed_rng_with(unsigned int seed);
+void game_set_seed(Game *g, uint64_t seed);
+unsigned int game_random(Game *g);
+void game_init(Game *g);
+void game_free(Game *g);
+int game_clear(Game *g, int size);
+int game_copy(Game *dst, const Game *src);
+int game_start(Game *g, int size, int walls_per_player, GameMode mode, const char *name1, const char *name2);
 int game_set_player_pos(Game *g, int player, int row, int col);
+int game_set_pawns(Game *g, const Pos *pawns);
 
 int game_in_range(const Game *g, int row, int col);
 int game_is_blocked(const Game *g, int r1, int c1, int r2, int c2);
 int game_can_place_wall(const Game *g, int row, int col, WallDir dir);
 int game_add_wall_from_map(Game *g, int row, int col, WallDir dir);
 int game_place_wall(Game *g, int player, int row, int col, WallDir dir, char *err, size_t err_cap);
+int game_remove_wall(Game *g, int player, int row, int col, WallDir dir);
+int game_wall_at(const Game *g, int row, int col, WallDir dir);
 
 int game_can_move(const Game *g, int player, Pos target);
 int game_list_moves(const Game *g, int player, Pos *out, int max_out);
 int game_move_player(Game *g, int player, Pos target, char *err, size_t err_cap);
 
+int game_is_goal(const Game *g, int player, int row, int col);
+int game_goal_side(int player);
+int game_cell_sides(const Game *g, int row, int col);
+int game_paths_open(Game *g, int threads);
 int game_check_winner(const Game *g);
 int game_next_player(int current_player);
 
 int game_try_ai_turn(Game *g, char *msg, size_t msg_cap);
 void game_apply_magic(Game *g, char *msg, size_t msg_cap);
+int game_magic_outcomes(MagicOutcome *out);
+void game_apply_magic_outcome(Game *g, const MagicOutcome *m, char *msg, size_t msg_cap);
+/* Applies an outcome to the wall and blocked-turn counters alone, so they
+ * can be copies; clearing walls leaves them unchanged. Returns the amount
+ * applied, which for a steal is capped by the other side's walls. */
+int game_magic_counters(const MagicOutcome *m, int *walls_left, int *blocked_turns);
 
 #endif
@@ -0,0 +1,439 @@
+#include "impact.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "thread.h"
+
+#define IMPACT_MOD 4294967291ULL
+
+static const int step_dr[4] = {-1, 1, 0, 0};
+static const int step_dc[4] = {0, 0, -1, 1};
+
+void impact_init(ImpactScratch *s) {
+    if (!s) return;
+    memset(s, 0, sizeof(*s));
+}
+
+static void release_fields(ImpactScratch *s) {
+    int p;
+    for (p = 0; p < PLAYER_COUNT; p++) {
+        free(s->from[p]);
+        free(s->to[p]);
+        free(s->ways_from[p]);
+        free(s->ways_to[p]);
+        free(s->order[p]);
+        s->from[p] = NULL;
+        s->to[p] = NULL;
+        s->ways_from[p] = NULL;
+        s->ways_to[p] = NULL;
+        s->order[p] = NULL;
+    }
+    free(s->queue);
+    free(s->mark);
+    s->queue = NULL;
+    s->mark = NULL;
+    s->cells = 0;
+}
+
+void impact_free(ImpactScratch *s) {
+    if (!s) return;
+    release_fields(s);
+    free(s->list);
+    impact_init(s);
+}
+
+static int reserve(ImpactScratch *s, int size) {
+    size_t cells = (size_t)size * (size_t)size;
+    int walls = 2 * (size - 1) * (size - 1);
+    int ok = 1;
+    int p;
+
+    if ((int)cells > s->cells) {
+        release_fields(s);
+        for (p = 0; p < PLAYER_COUNT; p++) {
+            s->from[p] = (int *)malloc(cells * sizeof(int));
+            s->to[p] = (int *)malloc(cells * sizeof(int));
+            s->ways_from[p] = (uint32_t *)malloc(cells * sizeof(uint32_t));
+            s->ways_to[p] = (uint32_t *)malloc(cells * sizeof(uint32_t));
+            s->order[p] = (int *)malloc(cells * sizeof(int));
+            if (!s->from[p] || !s->to[p] || !s->ways_from[p] || !s->ways_to[p] || !s->order[p]) ok = 0;
+        }
+        s->queue = (int *)malloc(cells * sizeof(int));
+        s->mark = (int *)calloc(cells, sizeof(int));
+        if (!ok || !s->queue || !s->mark) {
+            release_fields(s);
+            return 0;
+        }
+        s->cells = (int)cells;
+        s->stamp = 0;
+    }
+    if (walls > s->list_cap) {
+        WallImpact *list = (WallImpact *)realloc(s->list, (size_t)walls * sizeof(WallImpact));
+        if (!list) return 0;
+        s->list = list;
+        s->list_cap = walls;
+    }
+    return 1;
+}
+
+static int on_path(const ImpactScratch *s, int p, int cell) {
+    int f = s->from[p][cell];
+    int t = s->to[p][cell];
+    return f >= 0 && t >= 0 && f + t == s->length[p];
+}
+
+static void build_fields(ImpactScratch *s, const Game *g, int p) {
+    int n = g->size;
+    int *from = s->from[p];
+    int *to = s->to[p];
+    int *order = s->order[p];
+    uint32_t *wf = s->ways_from[p];
+    uint32_t *wt = s->ways_to[p];
+    int start = g->players[p].row * n + g->players[p].col;
+    int head = 0;
+    int tail = 0;
+    int r;
+    int c;
+    int i;
+    int k;
+
+    for (i = 0; i < n * n; i++) {
+        from[i] = -1;
+        to[i] = -1;
+    }
+
+    for (r = 0; r < n; r++) {
+        for (c = 0; c < n; c++) {
+            if (!game_is_goal(g, p, r, c)) continue;
+            to[r * n + c] = 0;
+            s->queue[tail++] = r * n + c;
+        }
+    }
+    while (head < tail) {
+        int u = s->queue[head++];
+        for (i = 0; i < 4; i++) {
+            int nr = u / n + step_dr[i];
+            int nc = u % n + step_dc[i];
+            if (game_is_blocked(g, u / n, u % n, nr, nc) || to[nr * n + nc] >= 0) continue;
+            to[nr * n + nc] = to[u] + 1;
+            s->queue[tail++] = nr * n + nc;
+        }
+    }
+
+    head = 0;
+    tail = 0;
+    from[start] = 0;
+    order[tail++] = start;
+    while (head < tail) {
+        int u = order[head++];
+        for (i = 0; i < 4; i++) {
+            int nr = u / n + step_dr[i];
+            int nc = u % n + step_dc[i];
+            if (game_is_blocked(g, u / n, u % n, nr, nc) || from[nr * n + nc] >= 0) continue;
+            from[nr * n + nc] = from[u] + 1;
+            order[tail++] = nr * n + nc;
+        }
+    }
+    s->order_len[p] = tail;
+    s->length[p] = to[start];
+    if (s->length[p] < 0) return;
+
+    /* Shortest-path counts along the DAG, forward then backward in BFS
+     * order. Counts overflow quickly, so they are kept mod a prime: a
+     * false "every path is cut" only costs one extra search. */
+    for (k = 0; k < tail; k++) {
+        wf[order[k]] = 0;
+        wt[order[k]] = 0;
+    }
+    wf[start] = 1;
+    for (k = 0; k < tail; k++) {
+        int u = order[k];
+        if (!on_path(s, p, u)) continue;
+        for (i = 0; i < 4; i++) {
+            int nr = u / n + step_dr[i];
+            int nc = u % n + step_dc[i];
+            int v = nr * n + nc;
+            if (game_is_blocked(g, u / n, u % n, nr, nc) || from[v] != from[u] + 1 || !on_path(s, p, v)) continue;
+            wf[v] = (uint32_t)(((uint64_t)wf[v] + wf[u]) % IMPACT_MOD);
+        }
+    }
+    for (k = tail - 1; k >= 0; k--) {
+        int u = order[k];
+        if (!on_path(s, p, u)) continue;
+        if (to[u] == 0) {
+            wt[u] = 1;
+            continue;
+        }
+        for (i = 0; i < 4; i++) {
+            int nr = u / n + step_dr[i];
+            int nc = u % n + step_dc[i];
+            int v = nr * n + nc;
+            if (game_is_blocked(g, u / n, u % n, nr, nc) || from[v] != from[u] + 1 || !on_path(s, p, v)) continue;
+            wt[u] = (uint32_t)(((uint64_t)wt[u] + wt[v]) % IMPACT_MOD);
+        }
+    }
+}
+
+/* Shortest paths through edge a-b, mod the prime; -1 if it is on none. */
+static long long edge_paths(const ImpactScratch *s, int p, int a, int b) {
+    int fa;
+    int fb;
+    if (!on_path(s, p, a) || !on_path(s, p, b)) return -1;
+    fa = s->from[p][a];
+    fb = s->from[p][b];
+    if (fb == fa + 1) return (long long)((uint64_t)s->ways_from[p][a] * s->ways_to[p][b] % IMPACT_MOD);
+    if (fa == fb + 1) return (long long)((uint64_t)s->ways_from[p][b] * s->ways_to[p][a] % IMPACT_MOD);
+    return -1;
+}
+
+/* Whether the wall might cut every shortest path of player p. Getting
+ * from one edge of a wall to the other takes at least two steps, so when
+ * their depths differ by less than two no path uses both and the counts
+ * add up to the total exactly when every path is cut. Otherwise a path
+ * may go around another wall and use both; those are searched. */
+static int cuts_all(const ImpactScratch *s, int p, const int *cells) {
+    long long e1 = edge_paths(s, p, cells[0], cells[1]);
+    long long e2 = edge_paths(s, p, cells[2], cells[3]);
+    uint32_t total;
+    if (e1 < 0 && e2 < 0) return 0;
+    if (e1 >= 0 && e2 >= 0) {
+        int d1 = s->from[p][cells[0]] < s->from[p][cells[1]] ? s->from[p][cells[0]] : s->from[p][cells[1]];
+        int d2 = s->from[p][cells[2]] < s->from[p][cells[3]] ? s->from[p][cells[2]] : s->from[p][cells[3]];
+        if (d1 - d2 >= 2 || d2 - d1 >= 2) return 1;
+    }
+    total = s->ways_to[p][s->order[p][0]];
+    return (uint64_t)((e1 > 0 ? e1 : 0) + (e2 > 0 ? e2 : 0)) % IMPACT_MOD == total;
+}
+
+static int crosses(const int *cells, int u, int v) {
+    if ((u == cells[0] && v == cells[1]) || (u == cells[1] && v == cells[0])) return 1;
+    return (u == cells[2] && v == cells[3]) || (u == cells[3] && v == cells[2]);
+}
+
+/* Path length of player p with one extra wall; -1 when it seals p in. */
+static int length_with_wall(ImpactScratch *s, const Game *g, int p, const int *cells) {
+    int n = g->size;
+    int start = g->players[p].row * n + g->players[p].col;
+    int head = 0;
+    int tail = 0;
+    int level = 0;
+
+    if (++s->stamp == INT_MAX) {
+        memset(s->mark, 0, (size_t)s->cells * sizeof(int));
+        s->stamp = 1;
+    }
+    s->mark[start] = s->stamp;
+    s->queue[tail++] = start;
+    while (head < tail) {
+        int end = tail;
+        for (; head < end; head++) {
+            int u = s->queue[head];
+            int i;
+            if (game_is_goal(g, p, u / n, u % n)) return level;
+            for (i = 0; i < 4; i++) {
+                int nr = u / n + step_dr[i];
+                int nc = u % n + step_dc[i];
+                int v = nr * n + nc;
+                if (game_is_blocked(g, u / n, u % n, nr, nc) || s->mark[v] == s->stamp) continue;
+                if (cells && crosses(cells, u, v)) continue;
+                s->mark[v] = s->stamp;
+                s->queue[tail++] = v;
+            }
+        }
+        level++;
+    }
+    return -1;
+}
+
+static int compare_impact(const void *a, const void *b) {
+    const WallImpact *x = (const WallImpact *)a;
+    const WallImpact *y = (const WallImpact *)b;
+    if (x->gain != y->gain) return y->gain - x->gain;
+    if (x->row != y->row) return x->row - y->row;
+    if (x->col != y->col) return x->col - y->col;
+    return (int)x->dir - (int)y->dir;
+}
+
+static void wall_cells(int n, int row, int col, WallDir dir, int *cells) {
+    int at = row * n + col;
+    int across = dir == DIR_H ? n : 1;
+    int along = dir == DIR_H ? 1 : n;
+    cells[0] = at;
+    cells[1] = at + across;
+    cells[2] = at + along;
+    cells[3] = at + along + across;
+}
+
+/* Fills s->list with every legal wall, best gain for `player` first. */
+int impact_scan(ImpactScratch *s, const Game *g, int player) {
+    int n;
+    int d;
+    int r;
+    int c;
+    int p;
+
+    if (!s || !g || player < 0 || player >= PLAYER_COUNT) return 0;
+    n = g->size;
+    if (!reserve(s, n)) return 0;
+    for (p = 0; p < PLAYER_COUNT; p++) build_fields(s, g, p);
+
+    s->count = 0;
+    s->searched = 0;
+    for (d = 0; d < 2; d++) {
+        WallDir dir = d == 0 ? DIR_H : DIR_V;
+        for (r = 0; r < n - 1; r++) {
+            for (c = 0; c < n - 1; c++) {
+                WallImpact *w = &s->list[s->count];
+                int cells[4];
+                int legal = 1;
+
+                if (!game_can_place_wall(g, r, c, dir)) continue;
+                wall_cells(n, r, c, dir, cells);
+                for (p = 0; p < PLAYER_COUNT && legal; p++) {
+                    w->delta[p] = 0;
+                    if (s->length[p] < 0 || !cuts_all(s, p, cells)) continue;
+                    s->searched++;
+                    w->delta[p] = length_with_wall(s, g, p, cells);
+                    if (w->delta[p] < 0) legal = 0;
+                    else w->delta[p] -= s->length[p];
+                }
+                if (!legal) continue;
+                w->row = r;
+                w->col = c;
+                w->dir = dir;
+                w->gain = w->delta[1 - player] - w->delta[player];
+                s->count++;
+            }
+        }
+    }
+    qsort(s->list, (size_t)s->count, sizeof(WallImpact), compare_impact);
+    return 1;
+}
+
+int impact_hint(FILE *out, const Game *g, int player, int top) {
+    ImpactScratch s;
+    int shown = 0;
+    int i;
+
+    impact_init(&s);
+    if (!impact_scan(&s, g, player)) {
+        fprintf(out, "Hint is not available.\n");
+        impact_free(&s);
+        return 0;
+    }
+    fprintf(out, "Shortest path: you %d, opponent %d.\n", s.length[player], s.length[1 - player]);
+    if (g->walls_left[player] <= 0) {
+        fprintf(out, "You have no walls left.\n");
+    } else {
+        for (i = 0; i < s.count && shown < top; i++) {
+            const WallImpact *w = &s.list[i];
+            if (w->gain <= 0) break;
+            fprintf(out, "  wall %d %d %c: opponent +%d, you +%d\n", w->row, w->col, w->dir == DIR_H ? 'H' : 'V',
+                    w->delta[1 - player], w->delta[player]);
+            shown++;
+        }
+        if (shown == 0) fprintf(out, "No wall lengthens the opponent's path more than yours right now.\n");
+    }
+    impact_free(&s);
+    return 1;
+}
+
+static void scatter_walls(Game *g) {
+    int n = g->size;
+    int tries = n * n / 5;
+    int i;
+    for (i = 0; i < tries; i++) {
+        int r = (int)(game_random(g) % (unsigned int)(n - 1));
+        int c = (int)(game_random(g) % (unsigned int)(n - 1));
+        WallDir dir = (game_random(g) & 1) ? DIR_V : DIR_H;
+        g->walls_left[0] = 1;
+        game_place_wall(g, 0, r, c, dir, NULL, 0);
+    }
+}
+
+/* Compares the batch scan with placing and measuring every wall in turn,
+ * and checks that both give the same answer. */
+static int bench_size(FILE *out, int size) {
+    ImpactScratch s;
+    Game g;
+    Game work;
+    int *index = NULL;
+    int base[PLAYER_COUNT];
+    int legal = 0;
+    int mismatches = 0;
+    double t0;
+    double scan_ms;
+    double probe_ms;
+    int d;
+    int r;
+    int c;
+    int p;
+    int i;
+
+    impact_init(&s);
+    game_init(&g);
+    game_init(&work);
+    if (!game_start(&g, size, 0, MODE_PVP, "A", "B")) return 0;
+    game_set_seed(&g, (uint64_t)size * 7919u);
+    scatter_walls(&g);
+
+    t0 = thread_now_ms();
+    if (!impact_scan(&s, &g, 0)) return 0;
+    scan_ms = thread_now_ms() - t0;
+
+    index = (int *)malloc(sizeof(int) * 2 * (size_t)(size - 1) * (size_t)(size - 1));
+    if (!index || !game_copy(&work, &g)) {
+        free(index);
+        return 0;
+    }
+    for (i = 0; i < 2 * (size - 1) * (size - 1); i++) index[i] = -1;
+    for (i = 0; i < s.count; i++) {
+        const WallImpact *w = &s.list[i];
+        index[(w->dir == DIR_V) * (size - 1) * (size - 1) + w->row * (size - 1) + w->col] = i;
+    }
+
+    t0 = thread_now_ms();
+    for (p = 0; p < PLAYER_COUNT; p++) base[p] = length_with_wall(&s, &work, p, NULL);
+    for (d = 0; d < 2; d++) {
+        WallDir dir = d == 0 ? DIR_H : DIR_V;
+        for (r = 0; r < size - 1; r++) {
+            for (c = 0; c < size - 1; c++) {
+                int at = index[d * (size - 1) * (size - 1) + r * (size - 1) + c];
+                if (!game_can_place_wall(&work, r, c, dir)) continue;
+                work.walls_left[0] = 1;
+                if (!game_place_wall(&work, 0, r, c, dir, NULL, 0)) {
+                    if (at >= 0) mismatches++;
+                    continue;
+                }
+                legal++;
+                for (p = 0; p < PLAYER_COUNT; p++) {
+                    int delta = length_with_wall(&s, &work, p, NULL) - base[p];
+                    if (at < 0 || s.list[at].delta[p] != delta) mismatches++;
+                }
+                game_remove_wall(&work, 0, r, c, dir);
+            }
+        }
+    }
+    probe_ms = thread_now_ms() - t0;
+
+    fprintf(out, "%4dx%-4d %7d legal walls, %5d searched: batch %9.2f ms, one by one %10.2f ms (%6.1fx), %d mismatch(es)\n",
+            size, size, legal, s.searched, scan_ms, probe_ms, scan_ms > 0.0 ? probe_ms / scan_ms : 0.0, mismatches);
+    fflush(out);
+    free(index);
+    game_free(&work);
+    game_free(&g);
+    impact_free(&s);
+    return mismatches == 0;
+}
+
+int impact_benchmark(FILE *out) {
+    static const int sizes[] = {9, 17, 33, 50, 100};
+    int ok = 1;
+    size_t i;
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        if (!bench_size(out, sizes[i])) ok = 0;
+    }
+    return ok;
+}
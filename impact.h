@@ -0,0 +1,49 @@
+#ifndef SIMPLE_IMPACT_H
+#define SIMPLE_IMPACT_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "game.h"
+
+#define IMPACT_HINT_COUNT 5
+
+/* How much one legal wall would lengthen each player's shortest path. */
+typedef struct {
+    int row;
+    int col;
+    WallDir dir;
+    int delta[PLAYER_COUNT];
+    int gain;
+} WallImpact;
+
+/* Per player: distances from the pawn and from the goal, and the number
+ * of shortest paths (mod a prime) from the pawn to each cell and from each
+ * cell to the goal. A wall changes a player's path length only if its
+ * edges carry every shortest path, and only those walls are searched. */
+typedef struct {
+    int cells;
+    int *from[PLAYER_COUNT];
+    int *to[PLAYER_COUNT];
+    uint32_t *ways_from[PLAYER_COUNT];
+    uint32_t *ways_to[PLAYER_COUNT];
+    int *order[PLAYER_COUNT];
+    int order_len[PLAYER_COUNT];
+    int length[PLAYER_COUNT];
+    int *queue;
+    int *mark;
+    int stamp;
+
+    WallImpact *list;
+    int count;
+    int list_cap;
+    int searched;
+} ImpactScratch;
+
+void impact_init(ImpactScratch *s);
+void impact_free(ImpactScratch *s);
+int impact_scan(ImpactScratch *s, const Game *g, int player);
+int impact_hint(FILE *out, const Game *g, int player, int top);
+int impact_benchmark(FILE *out);
+
+#endif
@@ -13,12 +13,25 @@ static void trim_newline(char *s) {
     }
 }
 
-int io_read_line(char *buf, int cap) {
+static IoLineReader line_reader = NULL;
+static void *line_reader_ctx = NULL;
+
+void io_set_line_reader(IoLineReader reader, void *ctx) {
+    line_reader = reader;
+    line_reader_ctx = ctx;
+}
+
+int io_read_stdin_line(char *buf, int cap) {
     if (!fgets(buf, cap, stdin)) return 0;
     trim_newline(buf);
     return 1;
 }
 
+int io_read_line(char *buf, int cap) {
+    if (line_reader) return line_reader(buf, cap, line_reader_ctx);
+    return io_read_stdin_line(buf, cap);
+}
+
 static int parse_int(const char *s, int *out) {
     char *end = NULL;
     long v = strtol(s, &end, 10);
@@ -71,6 +84,11 @@ int io_parse_action(const char *line, Action *a) {
         return 1;
     }
 
+    if (strcmp(line, "hint") == 0 || strcmp(line, "h") == 0) {
+        a->type = ACT_HINT;
+        return 1;
+    }
+
     if (sscanf(line, "move %d %d", &r, &c) == 2) {
         a->type = ACT_MOVE;
         a->target.row = r;
@@ -138,34 +156,67 @@ static char cell_char(const Game *g, int row, int col) {
     return '.';
 }
 
-void io_print_board(const Game *g) {
+void io_print_board_view(const Game *g, int top, int left, int rows, int cols) {
     int r;
     int c;
     int n = g->size;
+    int bottom;
+    int right;
+
+    if (top < 0) top = 0;
+    if (left < 0) left = 0;
+    bottom = top + rows;
+    right = left + cols;
+    if (bottom > n) bottom = n;
+    if (right > n) right = n;
 
     printf("    ");
-    for (c = 0; c < n; c++) printf("%2d  ", c);
+    for (c = left; c < right; c++) printf("%2d  ", c % 100);
     printf("\n");
 
-    for (r = 0; r < n; r++) {
-        printf("%2d  ", r);
-        for (c = 0; c < n; c++) {
+    for (r = top; r < bottom; r++) {
+        printf("%2d  ", r % 100);
+        for (c = left; c < right; c++) {
             printf(" %c ", cell_char(g, r, c));
-            if (c != n - 1) printf(g->block_right[r][c] ? "|" : " ");
+            if (c != right - 1) printf(game_is_blocked(g, r, c, r, c + 1) ? "|" : " ");
         }
         printf("\n");
 
-        if (r != n - 1) {
+        if (r != bottom - 1) {
             printf("    ");
-            for (c = 0; c < n; c++) {
-                printf(g->block_down[r][c] ? "---" : "   ");
-                if (c != n - 1) printf(" ");
+            for (c = left; c < right; c++) {
+                printf(game_is_blocked(g, r, c, r + 1, c) ? "---" : "   ");
+                if (c != right - 1) printf(" ");
             }
             printf("\n");
         }
     }
 }
 
+void io_print_board(const Game *g) {
+    int n = g->size;
+    Pos focus;
+    int top;
+    int left;
+
+    if (n <= IO_VIEW_SIZE) {
+        io_print_board_view(g, 0, 0, n, n);
+        return;
+    }
+
+    focus = g->players[g->current_player];
+    top = focus.row - IO_VIEW_SIZE / 2;
+    left = focus.col - IO_VIEW_SIZE / 2;
+    if (top > n - IO_VIEW_SIZE) top = n - IO_VIEW_SIZE;
+    if (left > n - IO_VIEW_SIZE) left = n - IO_VIEW_SIZE;
+    if (top < 0) top = 0;
+    if (left < 0) left = 0;
+
+    printf("Board %dx%d, showing rows %d-%d and columns %d-%d (labels are mod 100).\n",
+           n, n, top, top + IO_VIEW_SIZE - 1, left, left + IO_VIEW_SIZE - 1);
+    io_print_board_view(g, top, left, IO_VIEW_SIZE, IO_VIEW_SIZE);
+}
+
 void io_print_status(const Game *g) {
     printf("P1 (%s): walls=%d blocked=%d\n", g->player_name[0], g->walls_left[0], g->blocked_turns[0]);
     printf("P2 (%s): walls=%d blocked=%d\n", g->player_name[1], g->walls_left[1], g->blocked_turns[1]);
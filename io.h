@@ -4,6 +4,7 @@
 #include "game.h"
 
 #define LINE_MAX_LEN 256
+#define IO_VIEW_SIZE 50
 
 typedef enum {
     ACT_INVALID = 0,
@@ -11,6 +12,7 @@ typedef enum {
     ACT_WALL,
     ACT_SAVE,
     ACT_LOAD,
+    ACT_HINT,
     ACT_QUIT
 } ActionType;
 
@@ -23,12 +25,19 @@ typedef struct {
     char filename[128];
 } Action;
 
+/* Replaces stdin as the source of every line the game reads; NULL
+ * restores stdin. Used to record and replay sessions. */
+typedef int (*IoLineReader)(char *buf, int cap, void *ctx);
+
+void io_set_line_reader(IoLineReader reader, void *ctx);
+int io_read_stdin_line(char *buf, int cap);
 int io_read_line(char *buf, int cap);
 int io_read_int(const char *prompt, int min, int max);
 void io_read_string(const char *prompt, char *out, int cap);
 
 int io_parse_action(const char *line, Action *a);
 void io_print_board(const Game *g);
+void io_print_board_view(const Game *g, int top, int left, int rows, int cols);
 void io_print_status(const Game *g);
 
 #endif
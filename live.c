@@ -0,0 +1,304 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "live.h"
+
+#include <string.h>
+
+#include "thread.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define LIVE_READ_TRIES 1000
+
+static void set_err(char *err, size_t cap, const char *msg) {
+    if (err && cap) {
+        snprintf(err, cap, "%s", msg);
+    }
+}
+
+void live_init(Live *l) {
+    if (!l) return;
+    memset(l, 0, sizeof(*l));
+#ifndef _WIN32
+    l->fd = -1;
+#endif
+}
+
+/* POSIX names start with a slash; Windows names live in the session's
+ * Local namespace. */
+static int full_name(char *out, size_t cap, const char *name) {
+    int n;
+    if (!name || !*name) name = LIVE_DEFAULT_NAME;
+#ifdef _WIN32
+    n = snprintf(out, cap, "Local\\%s", name);
+#else
+    n = snprintf(out, cap, "/%s", name);
+#endif
+    return n > 0 && (size_t)n < cap;
+}
+
+static int map_segment(Live *l, const char *name, int create, char *err, size_t err_cap) {
+    char path[LIVE_NAME_MAX + 8];
+    size_t bytes = sizeof(LiveState);
+
+    if (!full_name(path, sizeof(path), name)) {
+        set_err(err, err_cap, "Live state name is too long.");
+        return 0;
+    }
+#ifdef _WIN32
+    if (create) {
+        l->mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, (DWORD)bytes, path);
+    } else {
+        l->mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, path);
+    }
+    if (!l->mapping) {
+        set_err(err, err_cap, create ? "Cannot create the live state segment." : "No live state segment by that name.");
+        return 0;
+    }
+    l->state = (LiveState *)MapViewOfFile(l->mapping, create ? FILE_MAP_ALL_ACCESS : FILE_MAP_READ, 0, 0, bytes);
+    if (!l->state) {
+        CloseHandle(l->mapping);
+        l->mapping = NULL;
+        set_err(err, err_cap, "Cannot map the live state segment.");
+        return 0;
+    }
+#else
+    {
+        struct stat st;
+        void *base;
+        l->fd = create ? shm_open(path, O_CREAT | O_RDWR, 0644) : shm_open(path, O_RDONLY, 0);
+        if (l->fd < 0) {
+            set_err(err, err_cap, create ? "Cannot create the live state segment." : "No live state segment by that name.");
+            return 0;
+        }
+        if (create && ftruncate(l->fd, (off_t)bytes) != 0) {
+            set_err(err, err_cap, "Cannot size the live state segment.");
+            close(l->fd);
+            shm_unlink(path);
+            l->fd = -1;
+            return 0;
+        }
+        if (fstat(l->fd, &st) != 0 || (size_t)st.st_size < bytes) {
+            set_err(err, err_cap, "Live state segment is too small for this version.");
+            close(l->fd);
+            l->fd = -1;
+            return 0;
+        }
+        base = mmap(NULL, bytes, create ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, l->fd, 0);
+        if (base == MAP_FAILED) {
+            set_err(err, err_cap, "Cannot map the live state segment.");
+            close(l->fd);
+            if (create) shm_unlink(path);
+            l->fd = -1;
+            return 0;
+        }
+        l->state = (LiveState *)base;
+    }
+#endif
+    snprintf(l->name, sizeof(l->name), "%s", name && *name ? name : LIVE_DEFAULT_NAME);
+    l->owner = create;
+    return 1;
+}
+
+/* The header is filled in before magic is set, so a reader that sees
+ * the magic also sees a usable layout. */
+int live_create(Live *l, const char *name, char *err, size_t err_cap) {
+    LiveState *s;
+    if (!l) return 0;
+    live_init(l);
+    if (!map_segment(l, name, 1, err, err_cap)) return 0;
+    s = l->state;
+    s->magic = 0;
+    thread_fence();
+    s->version = LIVE_VERSION;
+    s->bytes = (uint32_t)sizeof(LiveState);
+    s->wall_words = (uint32_t)LIVE_WALL_WORDS;
+    s->seq = 0;
+    s->turn = 0;
+    s->published = 0;
+    s->size = 0;
+    s->winner = -1;
+    s->closed = 0;
+    thread_fence();
+    s->magic = LIVE_MAGIC;
+    return 1;
+}
+
+int live_open(Live *l, const char *name, char *err, size_t err_cap) {
+    const LiveState *s;
+    if (!l) return 0;
+    live_init(l);
+    if (!map_segment(l, name, 0, err, err_cap)) return 0;
+    s = l->state;
+    if (s->magic != LIVE_MAGIC || s->version != LIVE_VERSION || s->bytes != sizeof(LiveState) ||
+        s->wall_words != LIVE_WALL_WORDS) {
+        set_err(err, err_cap, "Live state segment has another layout version.");
+        live_close(l);
+        return 0;
+    }
+    return 1;
+}
+
+/* The owner marks the segment closed for readers still attached, then
+ * removes its name; the memory goes once the last reader unmaps it. */
+void live_close(Live *l) {
+    char path[LIVE_NAME_MAX + 8];
+    if (!l || !l->state) return;
+    if (l->owner) {
+        uint64_t seq = l->state->seq;
+        l->state->seq = seq + 1;
+        thread_fence();
+        l->state->closed = 1;
+        thread_fence();
+        l->state->seq = seq + 2;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(l->state);
+    CloseHandle(l->mapping);
+    (void)path;
+#else
+    munmap(l->state, sizeof(LiveState));
+    close(l->fd);
+    if (l->owner && full_name(path, sizeof(path), l->name)) shm_unlink(path);
+#endif
+    live_init(l);
+}
+
+void live_publish(Live *l, const Game *g, long turn) {
+    LiveState *s;
+    size_t words;
+    uint64_t seq;
+    int i;
+
+    if (!l || !l->state || !g) return;
+    s = l->state;
+    words = ((size_t)g->size * (size_t)g->size + 63) / 64;
+    seq = s->seq;
+    s->seq = seq + 1;
+    thread_fence();
+
+    s->turn = (uint64_t)turn;
+    s->published++;
+    s->size = g->size;
+    s->current_player = g->current_player;
+    s->winner = game_check_winner(g);
+    for (i = 0; i < PLAYER_COUNT; i++) {
+        s->row[i] = g->players[i].row;
+        s->col[i] = g->players[i].col;
+        s->walls_left[i] = g->walls_left[i];
+        s->blocked_turns[i] = g->blocked_turns[i];
+    }
+    memcpy(s->h_walls, g->h_wall_at, words * sizeof(uint64_t));
+    memcpy(s->v_walls, g->v_wall_at, words * sizeof(uint64_t));
+
+    thread_fence();
+    s->seq = seq + 2;
+}
+
+/* Copies the counters, and the walls when buffers of words entries are
+ * given. Gives up after LIVE_READ_TRIES torn reads; the writer holds seq
+ * odd only for a few copies, so that means it has stopped mid-write. */
+int live_snapshot(const Live *l, LiveSnapshot *out, uint64_t *h_walls, uint64_t *v_walls, size_t words) {
+    const LiveState *s;
+    int tries;
+    int i;
+
+    if (!l || !l->state || !out) return 0;
+    s = l->state;
+    for (tries = 0; tries < LIVE_READ_TRIES; tries++) {
+        uint64_t before = s->seq;
+        size_t used;
+        thread_fence();
+        if (before & 1) {
+            thread_yield();
+            continue;
+        }
+        out->seq = before;
+        out->turn = s->turn;
+        out->published = s->published;
+        out->size = s->size;
+        out->current_player = s->current_player;
+        out->winner = s->winner;
+        out->closed = s->closed;
+        for (i = 0; i < PLAYER_COUNT; i++) {
+            out->players[i].row = s->row[i];
+            out->players[i].col = s->col[i];
+            out->walls_left[i] = s->walls_left[i];
+            out->blocked_turns[i] = s->blocked_turns[i];
+        }
+        used = ((size_t)out->size * (size_t)out->size + 63) / 64;
+        if (used > LIVE_WALL_WORDS) used = LIVE_WALL_WORDS;
+        if (used > words) used = words;
+        if (h_walls) memcpy(h_walls, s->h_walls, used * sizeof(uint64_t));
+        if (v_walls) memcpy(v_walls, s->v_walls, used * sizeof(uint64_t));
+        thread_fence();
+        if (s->seq == before) return 1;
+    }
+    return 0;
+}
+
+static int count_bits(const uint64_t *bits, size_t words) {
+    int total = 0;
+    size_t i;
+    for (i = 0; i < words; i++) {
+        uint64_t w = bits[i];
+        while (w) {
+            w &= w - 1;
+            total++;
+        }
+    }
+    return total;
+}
+
+/* Polls the segment and prints a line each time the game publishes, until
+ * count lines (0 for no limit) or the game closes it. */
+int live_follow(FILE *out, const char *name, int interval_ms, long count) {
+    static uint64_t h_walls[LIVE_WALL_WORDS];
+    static uint64_t v_walls[LIVE_WALL_WORDS];
+    Live l;
+    LiveSnapshot snap;
+    char err[128];
+    uint64_t last = 0;
+    long shown = 0;
+
+    if (!live_open(&l, name, err, sizeof(err))) {
+        fprintf(out, "%s\n", err);
+        return 0;
+    }
+    if (interval_ms < 1) interval_ms = 1;
+    for (;;) {
+        if (!live_snapshot(&l, &snap, h_walls, v_walls, LIVE_WALL_WORDS)) {
+            fprintf(out, "Live state stayed busy; the game may have stopped mid-turn.\n");
+            break;
+        }
+        if (snap.published != last) {
+            size_t words = ((size_t)snap.size * (size_t)snap.size + 63) / 64;
+            last = snap.published;
+            fprintf(out, "turn %llu: %dx%d, player %d to move, P1 %d,%d P2 %d,%d, walls left %d/%d, %d on board",
+                    (unsigned long long)snap.turn, snap.size, snap.size, snap.current_player + 1, snap.players[0].row,
+                    snap.players[0].col, snap.players[1].row, snap.players[1].col, snap.walls_left[0],
+                    snap.walls_left[1], count_bits(h_walls, words) + count_bits(v_walls, words));
+            if (snap.blocked_turns[0] || snap.blocked_turns[1]) {
+                fprintf(out, ", blocked %d/%d", snap.blocked_turns[0], snap.blocked_turns[1]);
+            }
+            if (snap.winner >= 0) fprintf(out, ", player %d won", snap.winner + 1);
+            fprintf(out, "\n");
+            fflush(out);
+            if (count > 0 && ++shown >= count) break;
+        }
+        if (snap.closed) {
+            fprintf(out, "Game closed the live state.\n");
+            break;
+        }
+        thread_sleep_ms(interval_ms);
+    }
+    live_close(&l);
+    return 1;
+}
@@ -0,0 +1,82 @@
+#ifndef SIMPLE_LIVE_H
+#define SIMPLE_LIVE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "game.h"
+
+#define LIVE_DEFAULT_NAME "simple-live"
+#define LIVE_NAME_MAX 64
+#define LIVE_MAGIC 0x564C5153u
+#define LIVE_VERSION 1
+#define LIVE_WALL_WORDS (((size_t)MAX_SIZE * MAX_SIZE + 63) / 64)
+
+/* Shared-memory layout, fixed for a version. All fields are little-endian
+ * fixed-width integers at these offsets:
+ *
+ *    0 u32 magic, u32 version, u32 bytes (whole segment), u32 wall_words
+ *   16 u64 seq: odd while the game thread is writing
+ *   24 u64 turn, u64 published
+ *   40 i32 size, current_player, winner (-1 none), closed
+ *   56 i32 row[2], col[2], walls_left[2], blocked_turns[2]
+ *   88 u64 h_walls[wall_words], v_walls[wall_words]
+ *
+ * Wall bits use the game's anchor index row * size + col. A reader copies
+ * what it needs between two reads of seq and keeps the copy only if seq
+ * was even and unchanged, so the writer never waits for anyone. */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t bytes;
+    uint32_t wall_words;
+    volatile uint64_t seq;
+    uint64_t turn;
+    uint64_t published;
+    int32_t size;
+    int32_t current_player;
+    int32_t winner;
+    int32_t closed;
+    int32_t row[PLAYER_COUNT];
+    int32_t col[PLAYER_COUNT];
+    int32_t walls_left[PLAYER_COUNT];
+    int32_t blocked_turns[PLAYER_COUNT];
+    uint64_t h_walls[LIVE_WALL_WORDS];
+    uint64_t v_walls[LIVE_WALL_WORDS];
+} LiveState;
+
+/* A consistent copy of everything but the walls. */
+typedef struct {
+    uint64_t seq;
+    uint64_t turn;
+    uint64_t published;
+    int size;
+    int current_player;
+    int winner;
+    int closed;
+    Pos players[PLAYER_COUNT];
+    int walls_left[PLAYER_COUNT];
+    int blocked_turns[PLAYER_COUNT];
+} LiveSnapshot;
+
+typedef struct {
+    LiveState *state;
+    char name[LIVE_NAME_MAX];
+    int owner;
+#ifdef _WIN32
+    void *mapping;
+#else
+    int fd;
+#endif
+} Live;
+
+void live_init(Live *l);
+int live_create(Live *l, const char *name, char *err, size_t err_cap);
+int live_open(Live *l, const char *name, char *err, size_t err_cap);
+void live_close(Live *l);
+void live_publish(Live *l, const Game *g, long turn);
+int live_snapshot(const Live *l, LiveSnapshot *out, uint64_t *h_walls, uint64_t *v_walls, size_t words);
+int live_follow(FILE *out, const char *name, int interval_ms, long count);
+
+#endif
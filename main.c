@@ -1,9 +1,34 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
+#include "ai.h"
+#include "autosave.h"
+#include "batch.h"
 #include "game.h"
+#include "impact.h"
 #include "io.h"
+#include "live.h"
+#include "match.h"
+#include "notation.h"
+#include "parpath.h"
+#include "pns.h"
+#include "ponder.h"
+#include "race.h"
 #include "save.h"
+#include "spectate.h"
+#include "suite.h"
+#include "thread.h"
+#include "trainset.h"
+#include "tune.h"
+#include "workload.h"
+
+#ifdef _WIN32
+#define NULL_DEVICE "NUL"
+#else
+#define NULL_DEVICE "/dev/null"
+#endif
 
 static int parse_wall_dir_char(char ch, WallDir *dir) {
     if (ch == 'H' || ch == 'h') {
@@ -17,6 +42,34 @@ static int parse_wall_dir_char(char ch, WallDir *dir) {
     return 0;
 }
 
+/* A map file whose first line has a comma is a one-line position in
+ * notation form. Returns 1 when it loaded, -1 when it did not parse and 0
+ * for the multi-line format, with fp rewound. */
+static int load_position_line(Game *g, FILE *fp) {
+    char *text;
+    char err[128];
+    long len;
+    int ok;
+    int c;
+
+    while ((c = fgetc(fp)) != EOF && c != '\n' && c != ',') {
+    }
+    rewind(fp);
+    if (c != ',') return 0;
+    if (fseek(fp, 0, SEEK_END) != 0 || (len = ftell(fp)) < 0 || fseek(fp, 0, SEEK_SET) != 0) return 0;
+    text = (char *)malloc((size_t)len + 1);
+    if (!text) {
+        printf("Error: not enough memory for the position.\n");
+        return -1;
+    }
+    len = (long)fread(text, 1, (size_t)len, fp);
+    text[len] = '\0';
+    ok = notation_parse(g, text, NULL, err, sizeof(err));
+    if (!ok) printf("Error: %s\n", err);
+    free(text);
+    return ok ? 1 : -1;
+}
+
 static int load_map_from_file(Game *g, const char *filename) {
     FILE *fp;
     int n;
@@ -29,14 +82,23 @@ static int load_map_from_file(Game *g, const char *filename) {
         printf("Error: cannot open map file: %s\n", filename);
         return 0;
     }
+    k1 = load_position_line(g, fp);
+    if (k1 != 0) {
+        fclose(fp);
+        return k1 > 0;
+    }
 
-    if (fscanf(fp, "%d", &n) != 1 || n < 2 || n > MAX_SIZE) {
+    if (fscanf(fp, "%d", &n) != 1 || n < MIN_SIZE || n > MAX_SIZE) {
         printf("Error: invalid board size in map file.\n");
         fclose(fp);
         return 0;
     }
 
-    game_start(g, n, 0, MODE_PVP, "P1", "P2");
+    if (!game_start(g, n, 0, MODE_PVP, "P1", "P2")) {
+        printf("Error: not enough memory for a %dx%d board.\n", n, n);
+        fclose(fp);
+        return 0;
+    }
 
     {
         int r;
@@ -101,18 +163,21 @@ static void print_commands(void) {
     printf("  wall r c H|V  (or: r c H|V)\n");
     printf("  save [file]\n");
     printf("  load [file]\n");
+    printf("  hint\n");
     printf("  quit\n");
 }
 
-static void setup_new_game(Game *g) {
+static int setup_new_game(Game *g) {
     int mode;
     int size;
     int walls;
     char p1[NAME_SIZE];
     char p2[NAME_SIZE];
+    char prompt[64];
 
     mode = io_read_int("Mode (1=PvP, 2=PvC): ", 1, 2);
-    size = io_read_int("Board size (2-50): ", 2, MAX_SIZE);
+    snprintf(prompt, sizeof(prompt), "Board size (%d-%d): ", MIN_SIZE, MAX_SIZE);
+    size = io_read_int(prompt, MIN_SIZE, MAX_SIZE);
     walls = io_read_int("Walls per player: ", 0, 1000);
 
     io_read_string("Player1 name: ", p1, sizeof(p1));
@@ -125,7 +190,11 @@ static void setup_new_game(Game *g) {
         if (p2[0] == '\0') strcpy(p2, "Player2");
     }
 
-    game_start(g, size, walls, (GameMode)mode, p1, p2);
+    if (!game_start(g, size, walls, (GameMode)mode, p1, p2)) {
+        printf("Error: not enough memory for a %dx%d board.\n", size, size);
+        return 0;
+    }
+    return 1;
 }
 
 static int setup_game(Game *g) {
@@ -144,8 +213,7 @@ static int setup_game(Game *g) {
         printf("Starting new game.\n");
     }
 
-    setup_new_game(g);
-    return 1;
+    return setup_new_game(g);
 }
 
 static int run_human_turn(Game *g, int *loaded_game) {
@@ -185,6 +253,11 @@ static int run_human_turn(Game *g, int *loaded_game) {
             continue;
         }
 
+        if (act.type == ACT_HINT) {
+            impact_hint(stdout, g, g->current_player, IMPACT_HINT_COUNT);
+            continue;
+        }
+
         if (act.type == ACT_MOVE) {
             if (game_move_player(g, g->current_player, act.target, err, sizeof(err))) return 1;
             printf("%s\n", err);
@@ -199,7 +272,8 @@ static int run_human_turn(Game *g, int *loaded_game) {
     }
 }
 
-static int run_game_loop(Game *g) {
+static int run_game_loop(Game *g, Ai *ai, Ponder *ponder, Autosave *autosave, Spectate *spectate, Live *live) {
+    long turn = 0;
     for (;;) {
         int winner;
         char magic_msg[160];
@@ -210,6 +284,8 @@ static int run_game_loop(Game *g) {
 
         game_apply_magic(g, magic_msg, sizeof(magic_msg));
         printf("%s\n", magic_msg);
+        spectate_turn(spectate, g, magic_msg);
+        live_publish(live, g, turn);
 
         winner = game_check_winner(g);
         if (winner >= 0) {
@@ -222,42 +298,546 @@ static int run_game_loop(Game *g) {
             g->blocked_turns[g->current_player]--;
             printf("%s is blocked. Turn skipped.\n", g->player_name[g->current_player]);
             g->current_player = game_next_player(g->current_player);
+            turn++;
+            autosave_turn(autosave, g);
             continue;
         }
 
         if (g->mode == MODE_PVC && g->current_player == 1) {
             char ai_msg[128];
-            game_try_ai_turn(g, ai_msg, sizeof(ai_msg));
+            ai_take_turn(ai, g, ai_msg, sizeof(ai_msg));
             printf("%s\n", ai_msg);
+            spectate_turn(spectate, g, ai_msg);
         } else {
             int loaded = 0;
-            if (!run_human_turn(g, &loaded)) return 0;
+            int ok;
+            if (g->mode == MODE_PVC) ponder_start(ponder, ai, g);
+            ok = run_human_turn(g, &loaded);
+            ponder_stop(ponder);
+            if (!ok) return 0;
             if (loaded) continue;
+            spectate_turn(spectate, g, NULL);
         }
+        turn++;
 
         winner = game_check_winner(g);
         if (winner >= 0) {
+            live_publish(live, g, turn);
             io_print_board(g);
             printf("Winner: %s\n", g->player_name[winner]);
             return 0;
         }
 
         g->current_player = game_next_player(g->current_player);
+        autosave_turn(autosave, g);
+    }
+}
+
+/* Recorded and replayed sessions run the computer on its node limit only
+ * and without pondering, so a replay takes the same path as the original. */
+static int run_session(int repeatable, Autosave *autosave, Spectate *spectate, Live *live) {
+    Game game;
+    Ai ai;
+    AiConfig cfg;
+    Ponder ponder;
+    int result;
+
+    game_init(&game);
+    if (!setup_game(&game)) {
+        game_free(&game);
+        return 0;
+    }
+    ai_default_config(&cfg);
+    if (ai_load_weights(&cfg, AI_WEIGHTS_FILE)) printf("Loaded evaluation weights from %s\n", AI_WEIGHTS_FILE);
+    if (repeatable) cfg.time_limit_ms = 0;
+    cfg.magic = 1;
+    if (!ai_init(&ai, &cfg)) {
+        printf("Error: not enough memory for the computer player.\n");
+        game_free(&game);
+        return 1;
+    }
+    ponder_init(&ponder);
+    print_commands();
+    result = run_game_loop(&game, &ai, repeatable ? NULL : &ponder, autosave, spectate, live);
+    ponder_free(&ponder);
+    ai_free(&ai);
+    game_free(&game);
+    return result;
+}
+
+static int run_record(const char *path) {
+    WorkloadRecorder rec;
+    unsigned int seed = (unsigned int)time(NULL);
+    char err[128];
+    int result;
+
+    if (!workload_record_start(&rec, path, seed, err, sizeof(err))) {
+        printf("%s\n", err);
+        return 1;
+    }
+    game_seed_rng_with(seed);
+    printf("Recording session to %s (seed %u)\n", path, seed);
+    result = run_session(1, NULL, NULL, NULL);
+    workload_record_stop(&rec);
+    return result;
+}
+
+static int run_replay(int argc, char **argv) {
+    const char *path = argv[2];
+    const char *baseline_path = NULL;
+    const char *save_path = NULL;
+    double max_slowdown = WORKLOAD_DEFAULT_SLOWDOWN;
+    int runs = 1;
+    Workload w;
+    WorkloadReplay rp;
+    WorkloadStats stats;
+    WorkloadStats base;
+    double best_ms = 0.0;
+    double think_ms = 0.0;
+    char err[128];
+    int ok = 1;
+    int i;
+
+    for (i = 3; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--runs") == 0) runs = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--baseline") == 0) baseline_path = argv[i + 1];
+        else if (strcmp(argv[i], "--save-baseline") == 0) save_path = argv[i + 1];
+        else if (strcmp(argv[i], "--max-slowdown") == 0) max_slowdown = atof(argv[i + 1]);
+        else break;
+    }
+    if (i < argc || runs < 1) {
+        fprintf(stderr, "Usage: %s --replay file [--runs N] [--baseline file] [--save-baseline file] [--max-slowdown pct]\n", argv[0]);
+        return 1;
+    }
+
+    workload_init(&w);
+    if (!workload_load(&w, path, err, sizeof(err))) {
+        fprintf(stderr, "%s\n", err);
+        return 1;
+    }
+    for (i = 0; i < w.count; i++) think_ms += w.wait_ms[i];
+    if (!freopen(NULL_DEVICE, "w", stdout)) {
+        fprintf(stderr, "Error: cannot discard game output.\n");
+        workload_free(&w);
+        return 1;
+    }
+
+    workload_replay_init(&rp, &w);
+    for (i = 0; i < runs; i++) {
+        double start;
+        double elapsed;
+        game_seed_rng_with(w.seed);
+        workload_replay_start(&rp);
+        start = thread_now_ms();
+        run_session(1, NULL, NULL, NULL);
+        elapsed = thread_now_ms() - start;
+        workload_replay_stop(&rp);
+        if (i == 0 || elapsed < best_ms) best_ms = elapsed;
+    }
+    fflush(stdout);
+
+    workload_replay_stats(&rp, best_ms, &stats);
+    fprintf(stderr, "Replayed %s: %d input lines, %d run(s), recorded player time %.1f s\n",
+            path, w.count, runs, think_ms / 1000.0);
+    workload_print_stats(stderr, &stats);
+
+    if (save_path) {
+        if (workload_save_baseline(save_path, &stats, err, sizeof(err))) {
+            fprintf(stderr, "Baseline saved to %s\n", save_path);
+        } else {
+            fprintf(stderr, "%s\n", err);
+            ok = 0;
+        }
+    }
+    if (baseline_path) {
+        if (workload_load_baseline(baseline_path, &base, err, sizeof(err))) {
+            if (!workload_compare(stderr, &base, &stats, max_slowdown)) ok = 2;
+        } else {
+            fprintf(stderr, "%s\n", err);
+            ok = 0;
+        }
+    }
+
+    workload_replay_free(&rp);
+    workload_free(&w);
+    if (ok == 2) return 2;
+    return ok ? 0 : 1;
+}
+
+static int run_with_autosave(int every, const char *path) {
+    Autosave autosave;
+    int result;
+
+    autosave_init(&autosave);
+    if (!autosave_start(&autosave, path, every)) {
+        printf("Error: cannot start autosave (turns must be 1 or more).\n");
+        autosave_stop(&autosave);
+        return 1;
+    }
+    printf("Autosaving to %s every %d turn(s).\n", path, every);
+    result = run_session(0, &autosave, NULL, NULL);
+    autosave_stop(&autosave);
+    return result;
+}
+
+static void print_train_stats(const TrainStats *st) {
+    double secs = st->ms / 1000.0;
+    printf("games %ld, positions %lld, duplicates skipped %lld, %.1f MB in %.2f s", st->games, st->positions,
+           st->duplicates, (double)st->bytes / (1024.0 * 1024.0), secs);
+    if (secs > 0.0) printf(" (%.0f positions/s)", (double)st->positions / secs);
+    if (st->adjudicated > 0) printf(", %ld race(s) adjudicated", st->adjudicated);
+    printf("\n");
+}
+
+static int run_selfplay(int argc, char **argv) {
+    TrainConfig cfg;
+    TrainStats stats;
+    char err[128];
+    int i;
+
+    trainset_default_config(&cfg);
+    cfg.prefix = argv[2];
+    cfg.games = atol(argv[3]);
+    cfg.seed = (uint64_t)time(NULL);
+    for (i = 4; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--size") == 0) cfg.size = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--walls") == 0) cfg.walls = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--threads") == 0) cfg.threads = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--dedup-bits") == 0) cfg.dedup_bits = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--nodes") == 0) cfg.node_limit = atol(argv[i + 1]);
+        else if (strcmp(argv[i], "--depth") == 0) cfg.depth = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--random") == 0) cfg.random_pct = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--seed") == 0) cfg.seed = (uint64_t)strtoull(argv[i + 1], NULL, 10);
+        else if (strcmp(argv[i], "--magic") == 0) cfg.magic = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--adjudicate") == 0) cfg.adjudicate = atoi(argv[i + 1]);
+        else break;
+    }
+    if (i < argc) {
+        printf("Usage: %s --selfplay prefix games [--size N] [--walls N] [--threads N] [--dedup-bits N]"
+               " [--nodes N] [--depth N] [--random pct] [--seed N] [--magic 0|1] [--adjudicate 0|1]\n", argv[0]);
+        return 1;
+    }
+
+    printf("Self-play: %ld game(s) on %dx%d, %d thread(s), shards %s-NN.sqtd\n", cfg.games, cfg.size, cfg.size,
+           cfg.threads, cfg.prefix);
+    if (!trainset_selfplay(&cfg, &stats, err, sizeof(err))) {
+        printf("%s\n", err);
+        return 1;
+    }
+    print_train_stats(&stats);
+    return 0;
+}
+
+static int run_export_saves(int argc, char **argv) {
+    TrainStats stats;
+    char err[128];
+    if (!trainset_export_saves(argv[2], argv + 3, argc - 3, &stats, err, sizeof(err))) {
+        printf("%s\n", err);
+        return 1;
+    }
+    print_train_stats(&stats);
+    return 0;
+}
+
+static int run_tune(int argc, char **argv) {
+    TuneConfig cfg;
+    char err[128];
+    int i;
+
+    tune_default_config(&cfg);
+    cfg.out_path = argv[2];
+    for (i = 3; i + 1 < argc && strncmp(argv[i], "--", 2) == 0; i += 2) {
+        if (strcmp(argv[i], "--threads") == 0) cfg.threads = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--rounds") == 0) cfg.max_rounds = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--step") == 0) cfg.start_step = atoi(argv[i + 1]);
+        else break;
+    }
+    if (i >= argc || strncmp(argv[i], "--", 2) == 0) {
+        printf("Usage: %s --tune weights-file [--threads N] [--rounds N] [--step N] shards...\n", argv[0]);
+        return 1;
+    }
+
+    if (!tune_run(&cfg, argv + i, argc - i, stdout, err, sizeof(err))) {
+        printf("%s\n", err);
+        return 1;
     }
+    return 0;
+}
+
+static int run_match(int argc, char **argv) {
+    MatchConfig cfg;
+    MatchStats stats;
+    char err[128];
+    int i;
+
+    match_default_config(&cfg);
+    for (i = 2; i + 1 < argc; i += 2) {
+        const char *opt = argv[i];
+        const char *val = argv[i + 1];
+        int side = (strncmp(opt, "--a-", 4) == 0) ? 0 : (strncmp(opt, "--b-", 4) == 0 ? 1 : -1);
+        if (side >= 0 && strcmp(opt + 4, "weights") == 0) {
+            if (!ai_load_weights(&cfg.ai[side], val)) break;
+        } else if (side >= 0 && strcmp(opt + 4, "depth") == 0) {
+            cfg.ai[side].depth = atoi(val);
+        } else if (side >= 0 && strcmp(opt + 4, "nodes") == 0) {
+            cfg.ai[side].node_limit = atol(val);
+        } else if (side >= 0 && strcmp(opt + 4, "magic") == 0) {
+            cfg.ai[side].magic = atoi(val);
+        } else if (strcmp(opt, "--size") == 0) cfg.size = atoi(val);
+        else if (strcmp(opt, "--walls") == 0) cfg.walls = atoi(val);
+        else if (strcmp(opt, "--games") == 0) cfg.max_games = atol(val);
+        else if (strcmp(opt, "--threads") == 0) cfg.threads = atoi(val);
+        else if (strcmp(opt, "--openings") == 0) cfg.opening_plies = atoi(val);
+        else if (strcmp(opt, "--seed") == 0) cfg.seed = (uint64_t)strtoull(val, NULL, 10);
+        else if (strcmp(opt, "--elo0") == 0) cfg.elo0 = atof(val);
+        else if (strcmp(opt, "--elo1") == 0) cfg.elo1 = atof(val);
+        else if (strcmp(opt, "--alpha") == 0) cfg.alpha = atof(val);
+        else if (strcmp(opt, "--beta") == 0) cfg.beta = atof(val);
+        else break;
+    }
+    if (i < argc) {
+        printf("Usage: %s --match [--a-weights file] [--b-weights file] [--a-depth N] [--b-depth N] [--a-nodes N]"
+               " [--b-nodes N] [--a-magic 0|1] [--b-magic 0|1] [--size N] [--walls N] [--games max] [--threads N]"
+               " [--openings plies] [--seed N] [--elo0 E] [--elo1 E] [--alpha P] [--beta P]\n", argv[0]);
+        return 1;
+    }
+
+    printf("Match: A (depth %d, %ld nodes) vs B (depth %d, %ld nodes) on %dx%d, up to %ld games, %d thread(s)\n",
+           cfg.ai[0].depth, cfg.ai[0].node_limit, cfg.ai[1].depth, cfg.ai[1].node_limit, cfg.size, cfg.size,
+           cfg.max_games, cfg.threads);
+    if (!match_run(&cfg, &stats, stdout, err, sizeof(err))) {
+        printf("%s\n", err);
+        return 1;
+    }
+    match_print_stats(stdout, &cfg, &stats);
+    return stats.verdict == MATCH_H0 ? 2 : 0;
+}
+
+static int run_suite(int argc, char **argv) {
+    SuiteConfig cfg;
+    SuiteStats stats;
+    Suite suite;
+    char err[160];
+    int all = 0;
+    int i;
+
+    suite_default_config(&cfg);
+    for (i = 3; i < argc; i += 2) {
+        const char *opt = argv[i];
+        const char *val = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(opt, "--all") == 0) {
+            all = 1;
+            i--;
+            continue;
+        }
+        if (!val) break;
+        if (strcmp(opt, "--threads") == 0) cfg.threads = atoi(val);
+        else if (strcmp(opt, "--depth") == 0) cfg.ai.depth = atoi(val);
+        else if (strcmp(opt, "--nodes") == 0) cfg.ai.node_limit = atol(val);
+        else if (strcmp(opt, "--time") == 0) cfg.ai.time_limit_ms = atoi(val);
+        else if (strcmp(opt, "--weights") == 0) {
+            if (!ai_load_weights(&cfg.ai, val)) break;
+        } else break;
+    }
+    if (i < argc) {
+        printf("Usage: %s --suite file [--threads N] [--depth N] [--nodes N] [--time ms] [--weights file] [--all]\n",
+               argv[0]);
+        return 1;
+    }
+
+    if (!suite_load(&suite, argv[2], err, sizeof(err))) {
+        printf("%s\n", err);
+        return 1;
+    }
+    printf("Suite %s: %d position(s), depth %d, %ld nodes, %d ms per position\n", argv[2], suite.count, cfg.ai.depth,
+           cfg.ai.node_limit, cfg.ai.time_limit_ms);
+    if (!suite_run(&cfg, &suite, &stats, err, sizeof(err))) {
+        printf("%s\n", err);
+        suite_free(&suite);
+        return 1;
+    }
+    suite_print(stdout, &suite, &stats, all);
+    suite_free(&suite);
+    return stats.solved == stats.count ? 0 : 2;
+}
+
+static int run_notation(const char *path) {
+    Game game;
+    char err[128];
+    char *text;
+    size_t len;
+
+    game_init(&game);
+    if (!load_game(path, &game, err, sizeof(err))) {
+        printf("%s\n", err);
+        game_free(&game);
+        return 1;
+    }
+    len = notation_format(&game, NULL, 0);
+    text = (char *)malloc(len + 1);
+    if (!text) {
+        printf("Error: not enough memory for the position.\n");
+        game_free(&game);
+        return 1;
+    }
+    notation_format(&game, text, len + 1);
+    printf("%s\n", text);
+    free(text);
+    game_free(&game);
+    return 0;
+}
+
+/* Proves or disproves a forced win for the side to move in a save file or
+ * a map file. Exits 2 when the budget runs out first. */
+static int run_prove(int argc, char **argv) {
+    PnsConfig cfg;
+    PnsStats stats;
+    Game game;
+    char err[128];
+    int i;
+
+    pns_default_config(&cfg);
+    for (i = 3; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--nodes") == 0) cfg.node_limit = atol(argv[i + 1]);
+        else if (strcmp(argv[i], "--time") == 0) cfg.time_limit_ms = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--table-bits") == 0) cfg.table_bits = atoi(argv[i + 1]);
+        else break;
+    }
+    if (i < argc) {
+        printf("Usage: %s --prove file [--nodes N] [--time ms] [--table-bits N]\n", argv[0]);
+        return 1;
+    }
+
+    game_init(&game);
+    if (!load_game(argv[2], &game, err, sizeof(err)) && !load_map_from_file(&game, argv[2])) {
+        game_free(&game);
+        return 1;
+    }
+    io_print_board(&game);
+    if (!pns_prove(&cfg, &game, &stats, err, sizeof(err))) {
+        printf("%s\n", err);
+        game_free(&game);
+        return 1;
+    }
+    pns_print(stdout, &cfg, &stats);
+    game_free(&game);
+    return stats.result == PNS_UNKNOWN ? 2 : 0;
+}
+
+static int run_spectated(int port) {
+    Spectate spectate;
+    char err[128];
+    int result;
+
+    spectate_init(&spectate);
+    if (!spectate_start(&spectate, port, err, sizeof(err))) {
+        printf("%s\n", err);
+        return 1;
+    }
+    printf("Spectators can watch with --watch %d\n", port);
+    result = run_session(0, NULL, &spectate, NULL);
+    spectate_stop(&spectate);
+    return result;
+}
+
+static int run_live(const char *name) {
+    Live live;
+    char err[128];
+    int result;
+
+    if (!live_create(&live, name, err, sizeof(err))) {
+        printf("%s\n", err);
+        return 1;
+    }
+    printf("Publishing live state as %s; read it with --live-read %s\n", live.name, live.name);
+    result = run_session(0, NULL, NULL, &live);
+    live_close(&live);
+    return result;
+}
+
+static int run_watch(int port, const char *host) {
+    char err[128];
+    int ok = spectate_watch(host, port, err, sizeof(err));
+    printf("%s\n", err);
+    return ok ? 0 : 1;
 }
 
 int main(int argc, char **argv) {
     Game game;
+    int result;
 
     game_seed_rng();
 
+    if (argc >= 2 && strcmp(argv[1], "--bench-path") == 0) {
+        return parpath_benchmark(stdout) ? 0 : 1;
+    }
+    if (argc >= 2 && strcmp(argv[1], "--bench-batch") == 0) {
+        return batch_benchmark(stdout) ? 0 : 1;
+    }
+    if (argc >= 2 && strcmp(argv[1], "--bench-race") == 0) {
+        return race_benchmark(stdout) ? 0 : 1;
+    }
+    if (argc >= 2 && strcmp(argv[1], "--bench-walls") == 0) {
+        return impact_benchmark(stdout) ? 0 : 1;
+    }
+    if (argc >= 2 && strcmp(argv[1], "--bench-prove") == 0) {
+        return pns_benchmark(stdout) ? 0 : 1;
+    }
+    if (argc >= 3 && strcmp(argv[1], "--record") == 0) {
+        return run_record(argv[2]);
+    }
+    if (argc >= 3 && strcmp(argv[1], "--replay") == 0) {
+        return run_replay(argc, argv);
+    }
+    if (argc >= 4 && strcmp(argv[1], "--selfplay") == 0) {
+        return run_selfplay(argc, argv);
+    }
+    if (argc >= 4 && strcmp(argv[1], "--export-saves") == 0) {
+        return run_export_saves(argc, argv);
+    }
+    if (argc >= 3 && strcmp(argv[1], "--read-train") == 0) {
+        return trainset_summary(stdout, argv + 2, argc - 2) ? 0 : 1;
+    }
+    if (argc >= 4 && strcmp(argv[1], "--tune") == 0) {
+        return run_tune(argc, argv);
+    }
+    if (argc >= 3 && strcmp(argv[1], "--autosave") == 0) {
+        return run_with_autosave(atoi(argv[2]), argc >= 4 ? argv[3] : AUTOSAVE_DEFAULT_FILE);
+    }
+
+    if (argc >= 3 && strcmp(argv[1], "--suite") == 0) {
+        return run_suite(argc, argv);
+    }
+    if (argc >= 3 && strcmp(argv[1], "--notation") == 0) {
+        return run_notation(argv[2]);
+    }
+    if (argc >= 3 && strcmp(argv[1], "--prove") == 0) {
+        return run_prove(argc, argv);
+    }
+    if (argc >= 2 && strcmp(argv[1], "--match") == 0) {
+        return run_match(argc, argv);
+    }
+    if (argc >= 2 && strcmp(argv[1], "--spectate") == 0) {
+        return run_spectated(argc >= 3 ? atoi(argv[2]) : SPECTATE_DEFAULT_PORT);
+    }
+    if (argc >= 2 && strcmp(argv[1], "--live") == 0) {
+        return run_live(argc >= 3 ? argv[2] : LIVE_DEFAULT_NAME);
+    }
+    if (argc >= 2 && strcmp(argv[1], "--live-read") == 0) {
+        const char *name = argc >= 3 ? argv[2] : LIVE_DEFAULT_NAME;
+        return live_follow(stdout, name, argc >= 4 ? atoi(argv[3]) : 100, argc >= 5 ? atol(argv[4]) : 0) ? 0 : 1;
+    }
+    if (argc >= 2 && strcmp(argv[1], "--watch") == 0) {
+        return run_watch(argc >= 3 ? atoi(argv[2]) : SPECTATE_DEFAULT_PORT, argc >= 4 ? argv[3] : NULL);
+    }
+
     if (argc >= 2) {
-        if (!load_map_from_file(&game, argv[1])) return 1;
-        io_print_board(&game);
-        return 0;
+        game_init(&game);
+        result = load_map_from_file(&game, argv[1]) ? 0 : 1;
+        if (result == 0) io_print_board(&game);
+        game_free(&game);
+        return result;
     }
 
-    if (!setup_game(&game)) return 0;
-    print_commands();
-    return run_game_loop(&game);
+    return run_session(0, NULL, NULL, NULL);
 }
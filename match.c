@@ -0,0 +1,295 @@
+#include "match.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "thread.h"
+
+static void set_err(char *err, size_t cap, const char *msg) {
+    if (err && cap) {
+        snprintf(err, cap, "%s", msg);
+    }
+}
+
+void match_default_config(MatchConfig *cfg) {
+    int i;
+    if (!cfg) return;
+    memset(cfg, 0, sizeof(*cfg));
+    for (i = 0; i < 2; i++) {
+        ai_default_config(&cfg->ai[i]);
+        cfg->ai[i].depth = 3;
+        cfg->ai[i].node_limit = 5000;
+        cfg->ai[i].time_limit_ms = 0;
+        cfg->ai[i].table_bits = 16;
+    }
+    cfg->size = 9;
+    cfg->walls = 10;
+    cfg->max_games = 20000;
+    cfg->threads = thread_cpu_count();
+    cfg->opening_plies = 4;
+    cfg->seed = 1;
+    cfg->elo0 = 0.0;
+    cfg->elo1 = 10.0;
+    cfg->alpha = 0.05;
+    cfg->beta = 0.05;
+    cfg->report_every = 50;
+}
+
+static uint64_t mix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+static double elo_to_score(double elo) {
+    return 1.0 / (1.0 + pow(10.0, -elo / 400.0));
+}
+
+static double score_to_elo(double score) {
+    if (score <= 0.0) score = 1e-6;
+    if (score >= 1.0) score = 1.0 - 1e-6;
+    return -400.0 * log10(1.0 / score - 1.0);
+}
+
+/* Results are taken in pair order, whatever order the threads finish
+ * them in, so a given seed always stops at the same game. */
+typedef struct {
+    const MatchConfig *cfg;
+    FILE *progress;
+    volatile long next_pair;
+    volatile long stop;
+    long max_pairs;
+    signed char *result;
+    long accounted;
+    double sum;
+    double sum_sq;
+    MatchStats stats;
+    ThreadMutex lock;
+    double start;
+} MatchShared;
+
+typedef struct {
+    MatchShared *shared;
+    int ok;
+} MatchWorker;
+
+static int opening_action(Ai *ai, Game *g, AiAction *out) {
+    AiAction list[AI_MAX_ACTIONS];
+    int count = ai_list_actions(ai, g, g->current_player, list, AI_MAX_ACTIONS);
+    if (count <= 0) return 0;
+    *out = list[game_random(g) % (unsigned int)count];
+    return 1;
+}
+
+/* Same turn order as run_game_loop: magic, blocked turns, then an action.
+ * engines[p] plays player p. Returns the winner or -1 for a draw. */
+static int play_game(const MatchConfig *cfg, Ai **engines, Game *g, uint64_t seed) {
+    long max_ply = 4L * cfg->size * cfg->size;
+    long ply;
+    int actions = 0;
+    char msg[160];
+
+    if (!game_start(g, cfg->size, cfg->walls, MODE_PVP, "A", "B")) return -1;
+    game_set_seed(g, seed);
+    ai_clear_table(engines[0]);
+    ai_clear_table(engines[1]);
+
+    for (ply = 0; ply < max_ply; ply++) {
+        AiAction a;
+        int side = g->current_player;
+        int winner;
+        int ok;
+
+        game_apply_magic(g, msg, sizeof(msg));
+        winner = game_check_winner(g);
+        if (winner >= 0) return winner;
+
+        if (g->blocked_turns[side] > 0) {
+            g->blocked_turns[side]--;
+            g->current_player = game_next_player(side);
+            continue;
+        }
+
+        if (actions < cfg->opening_plies) ok = opening_action(engines[side], g, &a);
+        else ok = ai_search(engines[side], g, &a, NULL);
+        actions++;
+        if (!ok || !ai_apply_action(g, side, &a, NULL, 0)) {
+            if (!game_try_ai_turn(g, msg, sizeof(msg))) return -1;
+        }
+        winner = game_check_winner(g);
+        if (winner >= 0) return winner;
+        g->current_player = game_next_player(side);
+    }
+    return -1;
+}
+
+/* Normal approximation of the generalised SPRT on pair scores. Pairs
+ * rather than single games, because the two games of a pair share an
+ * opening and their results are correlated. */
+static void update_stats(MatchShared *sh) {
+    const MatchConfig *cfg = sh->cfg;
+    MatchStats *s = &sh->stats;
+    double n = (double)s->pairs;
+    double var;
+    double p0 = elo_to_score(cfg->elo0);
+    double p1 = elo_to_score(cfg->elo1);
+    double margin;
+
+    s->score = sh->sum / n;
+    var = sh->sum_sq / n - s->score * s->score;
+    if (var < 1e-4) var = 1e-4;
+    margin = 1.96 * sqrt(var / n);
+    s->elo = score_to_elo(s->score);
+    s->elo_low = score_to_elo(s->score - margin);
+    s->elo_high = score_to_elo(s->score + margin);
+    s->llr = n * (p1 - p0) * (2.0 * s->score - p0 - p1) / (2.0 * var);
+    if (s->pairs < MATCH_MIN_PAIRS) return;
+    if (s->llr >= s->upper) s->verdict = MATCH_H1;
+    else if (s->llr <= s->lower) s->verdict = MATCH_H0;
+}
+
+static void print_progress(FILE *out, const MatchStats *s) {
+    fprintf(out, "games %ld: +%ld -%ld =%ld, elo %+.1f [%+.1f, %+.1f], LLR %.2f [%.2f, %.2f]\n", s->games, s->wins,
+            s->losses, s->draws, s->elo, s->elo_low, s->elo_high, s->llr, s->lower, s->upper);
+    fflush(out);
+}
+
+static void account(MatchShared *sh) {
+    MatchStats *s = &sh->stats;
+    while (s->verdict == MATCH_UNDECIDED && sh->accounted < sh->max_pairs) {
+        signed char *r = &sh->result[2 * sh->accounted];
+        double x;
+        int k;
+        if (r[0] < 0 || r[1] < 0) break;
+        for (k = 0; k < 2; k++) {
+            if (r[k] == 2) s->wins++;
+            else if (r[k] == 0) s->losses++;
+            else s->draws++;
+        }
+        x = (r[0] + r[1]) / 4.0;
+        sh->sum += x;
+        sh->sum_sq += x * x;
+        s->games += 2;
+        s->pairs++;
+        sh->accounted++;
+        update_stats(sh);
+        if (sh->progress && sh->cfg->report_every > 0 && s->pairs % sh->cfg->report_every == 0) {
+            print_progress(sh->progress, s);
+        }
+    }
+    if (s->verdict != MATCH_UNDECIDED) thread_atomic_store(&sh->stop, 1);
+}
+
+static void match_worker_main(void *arg) {
+    MatchWorker *w = (MatchWorker *)arg;
+    MatchShared *sh = w->shared;
+    const MatchConfig *cfg = sh->cfg;
+    Ai engines[2];
+    Game g;
+    int i;
+
+    game_init(&g);
+    memset(engines, 0, sizeof(engines));
+    for (i = 0; i < 2; i++) {
+        if (!ai_init(&engines[i], &cfg->ai[i])) {
+            ai_free(&engines[0]);
+            ai_free(&engines[1]);
+            return;
+        }
+    }
+
+    while (!thread_atomic_load(&sh->stop)) {
+        long idx = thread_atomic_add(&sh->next_pair, 1) - 1;
+        uint64_t seed;
+        signed char points[2];
+        int k;
+
+        if (idx >= sh->max_pairs) break;
+        seed = mix64(cfg->seed ^ ((uint64_t)idx << 24));
+        for (k = 0; k < 2; k++) {
+            /* Game 0: A moves first. Game 1: same seed, B moves first. */
+            Ai *order[2];
+            int a_player = k;
+            int winner;
+            order[a_player] = &engines[0];
+            order[1 - a_player] = &engines[1];
+            winner = play_game(cfg, order, &g, seed);
+            points[k] = (signed char)(winner < 0 ? 1 : (winner == a_player ? 2 : 0));
+        }
+
+        thread_mutex_lock(&sh->lock);
+        sh->result[2 * idx] = points[0];
+        sh->result[2 * idx + 1] = points[1];
+        account(sh);
+        thread_mutex_unlock(&sh->lock);
+    }
+
+    ai_free(&engines[0]);
+    ai_free(&engines[1]);
+    game_free(&g);
+    w->ok = 1;
+}
+
+int match_run(const MatchConfig *cfg, MatchStats *stats, FILE *progress, char *err, size_t err_cap) {
+    MatchShared sh;
+    MatchWorker workers[MATCH_MAX_THREADS];
+    Thread threads[MATCH_MAX_THREADS];
+    int count;
+    int ok = 1;
+    int i;
+
+    if (!cfg || !stats) return 0;
+    if (cfg->size < MIN_SIZE || cfg->size > MAX_SIZE || cfg->max_games < 2 || cfg->alpha <= 0.0 ||
+        cfg->alpha >= 1.0 || cfg->beta <= 0.0 || cfg->beta >= 1.0 || cfg->elo1 <= cfg->elo0) {
+        set_err(err, err_cap, "Invalid match settings.");
+        return 0;
+    }
+
+    memset(&sh, 0, sizeof(sh));
+    sh.cfg = cfg;
+    sh.progress = progress;
+    sh.max_pairs = cfg->max_games / 2;
+    sh.result = (signed char *)malloc((size_t)sh.max_pairs * 2);
+    if (!sh.result) {
+        set_err(err, err_cap, "Not enough memory for the match.");
+        return 0;
+    }
+    memset(sh.result, -1, (size_t)sh.max_pairs * 2);
+    sh.stats.lower = log(cfg->beta / (1.0 - cfg->alpha));
+    sh.stats.upper = log((1.0 - cfg->beta) / cfg->alpha);
+    thread_mutex_init(&sh.lock);
+
+    count = cfg->threads < 1 ? 1 : cfg->threads;
+    if (count > MATCH_MAX_THREADS) count = MATCH_MAX_THREADS;
+    memset(workers, 0, sizeof(workers));
+    sh.start = thread_now_ms();
+    for (i = 0; i < count; i++) {
+        workers[i].shared = &sh;
+        if (!thread_start(&threads[i], match_worker_main, &workers[i])) match_worker_main(&workers[i]);
+    }
+    for (i = 0; i < count; i++) {
+        thread_join(&threads[i]);
+        if (!workers[i].ok) ok = 0;
+    }
+
+    *stats = sh.stats;
+    stats->ms = thread_now_ms() - sh.start;
+    thread_mutex_destroy(&sh.lock);
+    free(sh.result);
+    if (!ok) set_err(err, err_cap, "Not enough memory for the engines.");
+    return ok;
+}
+
+void match_print_stats(FILE *out, const MatchConfig *cfg, const MatchStats *s) {
+    print_progress(out, s);
+    if (s->verdict == MATCH_H1) {
+        fprintf(out, "H1 accepted: A - B >= %+.0f elo favoured over <= %+.0f", cfg->elo1, cfg->elo0);
+    } else if (s->verdict == MATCH_H0) {
+        fprintf(out, "H0 accepted: A - B <= %+.0f elo favoured over >= %+.0f", cfg->elo0, cfg->elo1);
+    } else {
+        fprintf(out, "No decision within %ld games", cfg->max_games);
+    }
+    fprintf(out, " (%ld of %ld games, %.1f s)\n", s->games, cfg->max_games, s->ms / 1000.0);
+}
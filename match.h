@@ -0,0 +1,58 @@
+#ifndef SIMPLE_MATCH_H
+#define SIMPLE_MATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "ai.h"
+
+#define MATCH_MAX_THREADS 64
+#define MATCH_MIN_PAIRS 10
+
+/* Engine A (ai[0]) against engine B (ai[1]). Games are played in pairs
+ * from the same seed with colours swapped; the SPRT tests
+ * H0: elo(A - B) <= elo0 against H1: elo(A - B) >= elo1. */
+typedef struct {
+    AiConfig ai[2];
+    int size;
+    int walls;
+    long max_games;
+    int threads;
+    int opening_plies;
+    uint64_t seed;
+    double elo0;
+    double elo1;
+    double alpha;
+    double beta;
+    int report_every;
+} MatchConfig;
+
+typedef enum {
+    MATCH_UNDECIDED = 0,
+    MATCH_H1 = 1,
+    MATCH_H0 = -1
+} MatchVerdict;
+
+typedef struct {
+    long games;
+    long pairs;
+    long wins;
+    long losses;
+    long draws;
+    double score;
+    double elo;
+    double elo_low;
+    double elo_high;
+    double llr;
+    double lower;
+    double upper;
+    MatchVerdict verdict;
+    double ms;
+} MatchStats;
+
+void match_default_config(MatchConfig *cfg);
+int match_run(const MatchConfig *cfg, MatchStats *stats, FILE *progress, char *err, size_t err_cap);
+void match_print_stats(FILE *out, const MatchConfig *cfg, const MatchStats *s);
+
+#endif
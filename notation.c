@@ -0,0 +1,189 @@
+#include "notation.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+static void set_err(char *err, size_t cap, const char *msg) {
+    if (err && cap) {
+        snprintf(err, cap, "%s", msg);
+    }
+}
+
+static const char *skip_space(const char *p) {
+    while (*p == ' ' || *p == '\t') p++;
+    return p;
+}
+
+static const char *read_int(const char *p, int *out) {
+    long v = 0;
+    const char *start = p;
+    while (*p >= '0' && *p <= '9') {
+        v = v * 10 + (*p - '0');
+        if (v > 1000000000L) return NULL;
+        p++;
+    }
+    if (p == start) return NULL;
+    *out = (int)v;
+    return p;
+}
+
+static const char *read_pair(const char *p, char sep, int *a, int *b) {
+    p = read_int(p, a);
+    if (!p || *p != sep) return NULL;
+    return read_int(p + 1, b);
+}
+
+static const char *read_wall(const char *p, int *row, int *col, WallDir *dir) {
+    p = read_pair(p, '.', row, col);
+    if (!p) return NULL;
+    if (*p == 'H' || *p == 'h') {
+        *dir = DIR_H;
+    } else if (*p == 'V' || *p == 'v') {
+        *dir = DIR_V;
+    } else {
+        return NULL;
+    }
+    return p + 1;
+}
+
+static int at_token_end(const char *p) {
+    return *p == '\0' || *p == ' ' || *p == '\t' || *p == ';' || *p == '\r' || *p == '\n';
+}
+
+int notation_parse(Game *g, const char *text, const char **end, char *err, size_t err_cap) {
+    const char *p = text;
+    Pos pawn[PLAYER_COUNT];
+    int walls[PLAYER_COUNT];
+    int size;
+    int side;
+    int i;
+
+    if (!g || !text) return 0;
+    p = read_int(skip_space(p), &size);
+    if (!p || size < MIN_SIZE || size > MAX_SIZE) {
+        set_err(err, err_cap, "Invalid board size.");
+        return 0;
+    }
+    for (i = 0; i < PLAYER_COUNT && p; i++) {
+        p = read_pair(skip_space(p), ',', &pawn[i].row, &pawn[i].col);
+        if (p && (pawn[i].row >= size || pawn[i].col >= size)) p = NULL;
+    }
+    if (!p || (pawn[0].row == pawn[1].row && pawn[0].col == pawn[1].col)) {
+        set_err(err, err_cap, "Invalid pawn squares.");
+        return 0;
+    }
+    p = read_pair(skip_space(p), ',', &walls[0], &walls[1]);
+    if (!p) {
+        set_err(err, err_cap, "Invalid walls-left counts.");
+        return 0;
+    }
+    p = read_int(skip_space(p), &side);
+    if (!p || side < 1 || side > PLAYER_COUNT) {
+        set_err(err, err_cap, "Invalid side to move.");
+        return 0;
+    }
+
+    if (!game_clear(g, size)) {
+        set_err(err, err_cap, "Not enough memory for the board.");
+        return 0;
+    }
+    if (!game_set_pawns(g, pawn)) {
+        set_err(err, err_cap, "Invalid pawn squares.");
+        return 0;
+    }
+    g->walls_left[0] = walls[0];
+    g->walls_left[1] = walls[1];
+    g->current_player = side - 1;
+
+    p = skip_space(p);
+    if (*p == '-') {
+        p++;
+    } else {
+        for (;;) {
+            int row;
+            int col;
+            WallDir dir;
+            p = read_wall(p, &row, &col, &dir);
+            if (!p || !game_add_wall_from_map(g, row, col, dir)) {
+                set_err(err, err_cap, "Invalid or overlapping wall.");
+                return 0;
+            }
+            if (*p != ',') break;
+            p++;
+        }
+    }
+    if (!at_token_end(p)) {
+        set_err(err, err_cap, "Unexpected text after the walls.");
+        return 0;
+    }
+    if (!game_paths_open(g, 0)) {
+        set_err(err, err_cap, "A pawn has no path to its goal.");
+        return 0;
+    }
+    if (end) *end = p;
+    return 1;
+}
+
+static void put(char *buf, size_t cap, size_t *len, const char *fmt, ...) {
+    va_list ap;
+    int n;
+    va_start(ap, fmt);
+    n = vsnprintf(*len < cap ? buf + *len : NULL, *len < cap ? cap - *len : 0, fmt, ap);
+    va_end(ap);
+    if (n > 0) *len += (size_t)n;
+}
+
+/* Returns the full length, like snprintf; the text is cut to fit cap. */
+size_t notation_format(const Game *g, char *buf, size_t cap) {
+    size_t len = 0;
+    int walls = 0;
+    int r;
+    int c;
+
+    if (cap) buf[0] = '\0';
+    if (!g) return 0;
+    put(buf, cap, &len, "%d %d,%d %d,%d %d,%d %d ", g->size, g->players[0].row, g->players[0].col, g->players[1].row,
+        g->players[1].col, g->walls_left[0], g->walls_left[1], g->current_player + 1);
+    for (r = 0; r < g->size - 1; r++) {
+        for (c = 0; c < g->size - 1; c++) {
+            if (game_wall_at(g, r, c, DIR_H)) put(buf, cap, &len, "%s%d.%dH", walls++ ? "," : "", r, c);
+            if (game_wall_at(g, r, c, DIR_V)) put(buf, cap, &len, "%s%d.%dV", walls++ ? "," : "", r, c);
+        }
+    }
+    if (walls == 0) put(buf, cap, &len, "-");
+    return len;
+}
+
+const char *notation_parse_action(const char *text, AiAction *a) {
+    const char *p;
+    int row;
+    int col;
+
+    if (!text || !a) return NULL;
+    memset(a, 0, sizeof(*a));
+    text = skip_space(text);
+    p = read_int(text, &row);
+    if (p && *p == ',') {
+        p = read_int(p + 1, &col);
+        if (!p || !at_token_end(p)) return NULL;
+        a->type = AI_ACT_MOVE;
+        a->target.row = row;
+        a->target.col = col;
+        return p;
+    }
+    p = read_wall(text, &a->row, &a->col, &a->dir);
+    if (!p || !at_token_end(p)) return NULL;
+    a->type = AI_ACT_WALL;
+    return p;
+}
+
+void notation_format_action(const AiAction *a, char *buf, size_t cap) {
+    if (!a || a->type == AI_ACT_NONE) {
+        snprintf(buf, cap, "none");
+    } else if (a->type == AI_ACT_MOVE) {
+        snprintf(buf, cap, "%d,%d", a->target.row, a->target.col);
+    } else {
+        snprintf(buf, cap, "%d.%d%c", a->row, a->col, a->dir == DIR_H ? 'H' : 'V');
+    }
+}
@@ -0,0 +1,21 @@
+#ifndef SIMPLE_NOTATION_H
+#define SIMPLE_NOTATION_H
+
+#include <stddef.h>
+
+#include "ai.h"
+#include "game.h"
+
+/* One-line position: size, pawns, walls left, side to move, walls.
+ *
+ *   9 8,4 0,4 10,10 1 2.3H,4.4V
+ *
+ * Pawns are row,col for player 1 then player 2, the side to move is 1 or
+ * 2, and walls are row.col plus H or V, comma separated, or "-" for none.
+ * Actions use the same tokens: "7,4" moves, "2.3H" places a wall. */
+int notation_parse(Game *g, const char *text, const char **end, char *err, size_t err_cap);
+size_t notation_format(const Game *g, char *buf, size_t cap);
+const char *notation_parse_action(const char *text, AiAction *a);
+void notation_format_action(const AiAction *a, char *buf, size_t cap);
+
+#endif
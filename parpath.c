@@ -0,0 +1,471 @@
+#include "parpath.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "thread.h"
+
+#define PARPATH_CHUNK 256
+#define PARPATH_LOCAL 512
+#define PARPATH_SPINS 2000
+
+typedef struct {
+    volatile long count;
+    volatile long gen;
+    long total;
+} SpinBarrier;
+
+/* State of one level-synchronous flood. Cells of level k sit in
+ * queue[level_begin, level_end); threads claim PARPATH_CHUNK-sized slices
+ * of it through `next` and append the next level through `tail`. A cell
+ * belongs to whoever sets its bit in visit_bits first. */
+typedef struct {
+    const Game *g;
+    volatile uint64_t *visited;
+    int *queue;
+    unsigned char *trail;
+    volatile long side_cell[4];
+    volatile long next;
+    volatile long tail;
+    long level_end;
+    volatile long sides;
+    volatile long pawns;
+    volatile long done;
+    volatile long finished;
+    volatile long exited;
+    long verified;
+    int result;
+    int pawn_cell[PLAYER_COUNT];
+    SpinBarrier barrier;
+} Flood;
+
+/* Helpers stay parked on `wake` between floods instead of being started
+ * and joined for each one. A flood is a job: the caller publishes it,
+ * bumps `job`, works as helper 0 and waits until the `active` helpers it
+ * asked for have left it. One flood runs at a time; a caller that finds
+ * the pool busy floods alone. */
+typedef struct {
+    ThreadMutex lock;
+    ThreadCond wake;
+    Thread workers[PARPATH_MAX_THREADS];
+    int ids[PARPATH_MAX_THREADS];
+    int started;
+    long job;
+    long seen[PARPATH_MAX_THREADS];
+    Flood *flood;
+    int active;
+    volatile long busy;
+} Pool;
+
+static Pool pool;
+static volatile long pool_ready;
+
+static void barrier_wait(SpinBarrier *b) {
+    long gen = thread_atomic_load(&b->gen);
+    int spins = 0;
+    if (thread_atomic_add(&b->count, 1) == b->total) {
+        thread_atomic_store(&b->count, 0);
+        thread_atomic_add(&b->gen, 1);
+        return;
+    }
+    while (thread_atomic_load(&b->gen) == gen) {
+        if (++spins > PARPATH_SPINS) thread_yield();
+    }
+}
+
+static void atomic_or_long(volatile long *p, long bits) {
+    long old = thread_atomic_load(p);
+    while ((old & bits) != bits && !thread_atomic_cas(p, old, old | bits)) {
+        old = thread_atomic_load(p);
+    }
+}
+
+static int edge_open(const Game *g, int cell, int row, int col, int dir) {
+    int n = g->size;
+    if (dir == 0) return row > 0 && !((g->block_down[(cell - n) >> 6] >> ((cell - n) & 63)) & 1u);
+    if (dir == 1) return row < n - 1 && !((g->block_down[cell >> 6] >> (cell & 63)) & 1u);
+    if (dir == 2) return col > 0 && !((g->block_right[(cell - 1) >> 6] >> ((cell - 1) & 63)) & 1u);
+    return col < n - 1 && !((g->block_right[cell >> 6] >> (cell & 63)) & 1u);
+}
+
+/* Every pawn is settled either by an earlier completed flood or by this
+ * one having reached its goal side. */
+static int flood_settled(Flood *f) {
+    long sides = thread_atomic_load(&f->sides);
+    long pawns = thread_atomic_load(&f->pawns);
+    int q;
+    for (q = 0; q < PLAYER_COUNT; q++) {
+        if (f->verified & (1L << q)) continue;
+        if (!(pawns & (1L << q))) return 0;
+        if (!(sides & (1L << game_goal_side(q)))) return 0;
+    }
+    return 1;
+}
+
+static void note_cell(Flood *f, int cell, int row, int col, long *local_sides) {
+    int n = f->g->size;
+    int q;
+    if (row == 0 || col == 0 || row == n - 1 || col == n - 1) {
+        long sides = game_cell_sides(f->g, row, col);
+        if ((*local_sides | sides) != *local_sides) {
+            int s;
+            for (s = 0; f->trail && s < 4; s++) {
+                if ((sides >> s) & 1) thread_atomic_cas(&f->side_cell[s], -1, cell);
+            }
+            *local_sides |= sides;
+            atomic_or_long(&f->sides, sides);
+            if (flood_settled(f)) thread_atomic_store(&f->done, 1);
+        }
+    }
+    for (q = 0; q < PLAYER_COUNT; q++) {
+        if (f->pawn_cell[q] != cell) continue;
+        atomic_or_long(&f->pawns, 1L << q);
+        if (flood_settled(f)) thread_atomic_store(&f->done, 1);
+    }
+}
+
+static void flush_local(Flood *f, const int *local, int count) {
+    long at;
+    if (count == 0) return;
+    at = thread_atomic_add(&f->tail, count) - count;
+    memcpy(f->queue + at, local, sizeof(int) * (size_t)count);
+}
+
+static void flood_run(Flood *f, int id) {
+    const Game *g = f->g;
+    int n = g->size;
+    const int step[4] = {-n, n, -1, 1};
+    int local[PARPATH_LOCAL];
+    long local_sides = 0;
+
+    for (;;) {
+        long end = f->level_end;
+        int count = 0;
+
+        while (!thread_atomic_load(&f->done)) {
+            long i = thread_atomic_add(&f->next, PARPATH_CHUNK) - PARPATH_CHUNK;
+            long stop = i + PARPATH_CHUNK;
+            if (i >= end) break;
+            if (stop > end) stop = end;
+
+            for (; i < stop; i++) {
+                int cell = f->queue[i];
+                int row = cell / n;
+                int col = cell % n;
+                int d;
+                for (d = 0; d < 4; d++) {
+                    int next;
+                    uint64_t bit;
+                    if (!edge_open(g, cell, row, col, d)) continue;
+                    next = cell + step[d];
+                    bit = (uint64_t)1 << (next & 63);
+                    if (f->visited[next >> 6] & bit) continue;
+                    if (thread_atomic_or64(&f->visited[next >> 6], bit) & bit) continue;
+                    if (f->trail) f->trail[next] = (unsigned char)(d + 1);
+                    note_cell(f, next, next / n, next % n, &local_sides);
+                    local[count++] = next;
+                    if (count == PARPATH_LOCAL) {
+                        flush_local(f, local, count);
+                        count = 0;
+                    }
+                }
+            }
+        }
+        flush_local(f, local, count);
+
+        /* Only the leader decides between the two barriers; `done` may
+         * already be set again by a thread racing into the next level. */
+        barrier_wait(&f->barrier);
+        if (id == 0) {
+            long tail = thread_atomic_load(&f->tail);
+            if (thread_atomic_load(&f->done)) {
+                f->result = 1;
+                thread_atomic_store(&f->finished, 1);
+            } else if (tail == end) {
+                thread_atomic_store(&f->finished, 1);
+            } else {
+                thread_atomic_store(&f->next, end);
+                f->level_end = tail;
+            }
+        }
+        barrier_wait(&f->barrier);
+        if (thread_atomic_load(&f->finished)) return;
+    }
+}
+
+static void pool_worker_main(void *arg) {
+    int id = *(int *)arg;
+    long seen;
+    thread_mutex_lock(&pool.lock);
+    seen = pool.seen[id];
+    thread_mutex_unlock(&pool.lock);
+
+    for (;;) {
+        Flood *f;
+        int active;
+        thread_mutex_lock(&pool.lock);
+        while (pool.job == seen) thread_cond_wait(&pool.wake, &pool.lock);
+        seen = pool.job;
+        f = pool.flood;
+        active = pool.active;
+        thread_mutex_unlock(&pool.lock);
+        if (id > active) continue;
+        flood_run(f, id);
+        thread_atomic_add(&f->exited, 1);
+    }
+}
+
+/* Set up once by whichever caller gets there first. */
+static void pool_open(void) {
+    if (thread_atomic_load(&pool_ready) == 2) return;
+    if (thread_atomic_cas(&pool_ready, 0, 1)) {
+        thread_mutex_init(&pool.lock);
+        thread_cond_init(&pool.wake);
+        thread_atomic_store(&pool_ready, 2);
+        return;
+    }
+    while (thread_atomic_load(&pool_ready) != 2) thread_yield();
+}
+
+/* Only the holder of `busy` grows the pool. Returns how many helpers
+ * besides the caller are available, at most want. */
+static int pool_grow(int want) {
+    while (pool.started < want) {
+        int id = pool.started + 1;
+        thread_mutex_lock(&pool.lock);
+        pool.ids[id] = id;
+        pool.seen[id] = pool.job;
+        thread_mutex_unlock(&pool.lock);
+        if (!thread_start(&pool.workers[id], pool_worker_main, &pool.ids[id])) break;
+        pool.started = id;
+    }
+    return pool.started < want ? pool.started : want;
+}
+
+int parpath_default_threads(void) {
+    int n = thread_cpu_count();
+    return n > PARPATH_MAX_THREADS ? PARPATH_MAX_THREADS : n;
+}
+
+#ifndef PARPATH_MIN_CELLS
+/* What the timed floods found so far: threads won on boards of won_cells
+ * and more, lost on boards of lost_cells and fewer. */
+static volatile long won_cells = 0x7FFFFFFFL;
+static volatile long lost_cells;
+
+static void atomic_min_long(volatile long *p, long value) {
+    long old = thread_atomic_load(p);
+    while (value < old && !thread_atomic_cas(p, old, value)) old = thread_atomic_load(p);
+}
+
+static void atomic_max_long(volatile long *p, long value) {
+    long old = thread_atomic_load(p);
+    while (value > old && !thread_atomic_cas(p, old, value)) old = thread_atomic_load(p);
+}
+
+/* Best of three floods on the board as it is, wall included. */
+static double best_flood_ms(Game *g, int threads) {
+    double best = 0.0;
+    int i;
+    for (i = 0; i < 3; i++) {
+        double start = thread_now_ms();
+        double ms;
+        if (threads > 1) {
+            parpath_all_players_have_path(g, threads, NULL);
+        } else {
+            game_paths_open(g, 1);
+        }
+        ms = thread_now_ms() - start;
+        if (i == 0 || ms < best) best = ms;
+    }
+    return best;
+}
+#endif
+
+int parpath_auto_threads(Game *g) {
+    long cells;
+    int threads = parpath_default_threads();
+    if (!g || threads <= 1) return 1;
+    cells = (long)g->size * g->size;
+#ifdef PARPATH_MIN_CELLS
+    return PARPATH_MIN_CELLS > 0 && cells >= PARPATH_MIN_CELLS ? threads : 1;
+#else
+    if (cells < PARPATH_FLOOR_CELLS) return 1;
+    if (cells >= thread_atomic_load(&won_cells)) return threads;
+    if (cells <= thread_atomic_load(&lost_cells)) return 1;
+
+    /* A tenth faster at least, as in the benchmark. */
+    if (best_flood_ms(g, threads) < best_flood_ms(g, 1) * 0.9) {
+        atomic_min_long(&won_cells, cells);
+        return threads;
+    }
+    atomic_max_long(&lost_cells, cells);
+    return 1;
+#endif
+}
+
+/* With goal_cells, the flood also leaves each cell's step from its parent
+ * in g->trail (5 at a flood's start) and, per player, a goal cell in the
+ * same flood tree as its pawn; the caller clears trail afterwards. */
+int parpath_all_players_have_path(Game *g, int threads, int *goal_cells) {
+    Flood f;
+    int helpers = 0;
+    int pooled = 0;
+    int n;
+    int p;
+
+    if (!g || !g->visit_bits) return 0;
+    if (threads < 1) threads = 1;
+    if (threads > PARPATH_MAX_THREADS) threads = PARPATH_MAX_THREADS;
+
+    n = g->size;
+    memset(&f, 0, sizeof(f));
+    f.g = g;
+    f.visited = g->visit_bits;
+    f.queue = g->queue;
+    f.trail = goal_cells ? g->trail : NULL;
+    memset(g->visit_bits, 0, (((size_t)n * (size_t)n + 63) / 64) * sizeof(uint64_t));
+    for (p = 0; p < PLAYER_COUNT; p++) {
+        if (!game_in_range(g, g->players[p].row, g->players[p].col)) return 0;
+        f.pawn_cell[p] = g->players[p].row * n + g->players[p].col;
+    }
+
+    if (threads > 1) {
+        pool_open();
+        if (thread_atomic_cas(&pool.busy, 0, 1)) {
+            pooled = 1;
+            helpers = pool_grow(threads - 1);
+        }
+    }
+
+    for (p = 0; p < PLAYER_COUNT; p++) {
+        int start = f.pawn_cell[p];
+        long local_sides = 0;
+        int q;
+
+        if (f.verified & (1L << p)) continue;
+
+        g->visit_bits[start >> 6] |= (uint64_t)1 << (start & 63);
+        f.queue[0] = start;
+        f.next = 0;
+        f.tail = 1;
+        f.level_end = 1;
+        f.sides = 0;
+        f.pawns = 0;
+        f.done = 0;
+        f.finished = 0;
+        f.exited = 0;
+        f.result = 0;
+        for (q = 0; q < 4; q++) f.side_cell[q] = -1;
+        if (f.trail) f.trail[start] = 5;
+        note_cell(&f, start, start / n, start % n, &local_sides);
+        if (thread_atomic_load(&f.done)) {
+            f.result = 1;
+        } else {
+            f.barrier.count = 0;
+            f.barrier.gen = 0;
+            f.barrier.total = helpers + 1;
+            if (helpers > 0) {
+                thread_mutex_lock(&pool.lock);
+                pool.flood = &f;
+                pool.active = helpers;
+                pool.job++;
+                thread_cond_broadcast(&pool.wake);
+                thread_mutex_unlock(&pool.lock);
+            }
+            flood_run(&f, 0);
+            while (thread_atomic_load(&f.exited) < helpers) thread_yield();
+        }
+
+        for (q = 0; goal_cells && q < PLAYER_COUNT; q++) {
+            if ((f.pawns & (1L << q)) && !(f.verified & (1L << q))) {
+                goal_cells[q] = (int)f.side_cell[game_goal_side(q)];
+            }
+        }
+        if (f.result) break;
+        for (q = 0; q < PLAYER_COUNT; q++) {
+            if (!(f.pawns & (1L << q))) continue;
+            if (!(f.sides & (1L << game_goal_side(q)))) {
+                f.result = -1;
+                break;
+            }
+        }
+        if (f.result) break;
+        f.verified |= f.pawns;
+    }
+    if (pooled) thread_atomic_store(&pool.busy, 0);
+    return f.result >= 0;
+}
+
+static void scatter_walls(Game *g, int count) {
+    int n = g->size;
+    int i;
+    for (i = 0; i < count; i++) {
+        int row = rand() % (n - 1);
+        int col = rand() % (n - 1);
+        WallDir dir = (rand() % 2) ? DIR_H : DIR_V;
+        game_add_wall_from_map(g, row, col, dir);
+    }
+}
+
+static double time_checks(Game *g, int threads, int *ok) {
+    double start = thread_now_ms();
+    double elapsed;
+    int reps = 0;
+    do {
+        *ok = game_paths_open(g, threads);
+        reps++;
+        elapsed = thread_now_ms() - start;
+    } while (elapsed < 300.0 || reps < 3);
+    return elapsed / reps;
+}
+
+int parpath_benchmark(FILE *out) {
+    static const int sizes[] = {128, 256, 512, 1024, 2048};
+    static const int thread_counts[] = {1, 2, 4, 8, 16};
+    Game g;
+    int crossover = 0;
+    size_t si;
+    size_t ti;
+
+    game_init(&g);
+    srand(12345);
+#ifdef PARPATH_MIN_CELLS
+    fprintf(out, "Path check benchmark (%d CPU(s), built to go parallel from %ld cells)\n", thread_cpu_count(),
+            (long)PARPATH_MIN_CELLS);
+#else
+    fprintf(out, "Path check benchmark (%d CPU(s), parallel where a timed flood says so)\n", thread_cpu_count());
+#endif
+    fprintf(out, "%6s %8s %12s %8s\n", "size", "threads", "ms/check", "speedup");
+
+    for (si = 0; si < sizeof(sizes) / sizeof(sizes[0]); si++) {
+        int n = sizes[si];
+        double serial_ms = 0.0;
+        double best_ms = 0.0;
+        if (!game_start(&g, n, 0, MODE_PVP, "P1", "P2")) {
+            fprintf(out, "%6d  not enough memory\n", n);
+            break;
+        }
+        scatter_walls(&g, n * n / 6);
+
+        for (ti = 0; ti < sizeof(thread_counts) / sizeof(thread_counts[0]); ti++) {
+            int threads = thread_counts[ti];
+            int ok;
+            double ms = time_checks(&g, threads, &ok);
+            if (threads == 1) serial_ms = ms;
+            else if (best_ms == 0.0 || ms < best_ms) best_ms = ms;
+            fprintf(out, "%6d %8d %12.3f %7.2fx%s\n", n, threads, ms, serial_ms / ms, ok ? "" : "  (blocked)");
+            fflush(out);
+        }
+        /* A tenth faster at least, so noise does not switch it on. */
+        if (!crossover && best_ms > 0.0 && best_ms < serial_ms * 0.9) crossover = n;
+    }
+    game_free(&g);
+    if (crossover) {
+        fprintf(out, "Threads pay off from %dx%d here; /DPARPATH_MIN_CELLS=%ld fixes that cutoff in the build.\n",
+                crossover, crossover, (long)crossover * crossover);
+    } else {
+        fprintf(out, "Threads did not pay off on any size here; /DPARPATH_MIN_CELLS=0 keeps them off in the build.\n");
+    }
+    return 1;
+}
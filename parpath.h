@@ -0,0 +1,23 @@
+#ifndef SIMPLE_PARPATH_H
+#define SIMPLE_PARPATH_H
+
+#include <stdio.h>
+
+#include "game.h"
+
+/* Boards below this many cells always flood on one thread: the level
+ * barriers cost more than the flood. */
+#define PARPATH_FLOOR_CELLS (128 * 128)
+#define PARPATH_MAX_THREADS 16
+
+/* Threads for a flood the caller left to game_paths_open: 1 on a single
+ * CPU or a small board. Above that the first board of each size times
+ * a few floods each way, and boards at least as large as one where threads
+ * won use them. Building with PARPATH_MIN_CELLS fixes the cutoff instead
+ * (0 keeps every check serial). */
+int parpath_auto_threads(Game *g);
+int parpath_default_threads(void);
+int parpath_all_players_have_path(Game *g, int threads, int *goal_cells);
+int parpath_benchmark(FILE *out);
+
+#endif
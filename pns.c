@@ -0,0 +1,852 @@
+#include "pns.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "impact.h"
+#include "notation.h"
+#include "race.h"
+#include "thread.h"
+
+typedef struct {
+    unsigned long long key;
+    uint32_t pn;
+    uint32_t dn;
+    uint32_t work;
+    uint32_t walk;
+    AiAction best;
+} PnsEntry;
+
+/* A result that leans on a repetition holds only while the position it
+ * repeats is still on the path: dep is the ply of that position, -1 for
+ * the ply limit (which no path can lift), or PNS_NO_DEP. */
+#define PNS_NO_DEP (PNS_MAX_PLY + 1)
+
+/* One child of an expanded node. Fixed children are finished games,
+ * solved races, repetitions, the ply limit and results that depend on
+ * the path; they are never looked up again while the node is open. */
+typedef struct {
+    AiAction act;
+    unsigned long long board;
+    unsigned long long key;
+    uint32_t pn;
+    uint32_t dn;
+    int dep;
+    int fixed;
+} PnsChild;
+
+typedef struct {
+    PnsConfig cfg;
+    PnsEntry *table;
+    size_t mask;
+    Game *g;
+    int attacker;
+    ImpactScratch impact;
+    RaceTable race;
+    unsigned long long path[PNS_MAX_PLY + 1];
+    int ply;
+    long nodes;
+    double deadline_ms;
+    int aborted;
+    int out_of_memory;
+    uint32_t walk;
+    long walk_size;
+    long walk_missing;
+} Pns;
+
+static void set_err(char *err, size_t cap, const char *msg) {
+    if (err && cap) {
+        snprintf(err, cap, "%s", msg);
+    }
+}
+
+void pns_default_config(PnsConfig *cfg) {
+    if (!cfg) return;
+    cfg->node_limit = 1000000;
+    cfg->time_limit_ms = 0;
+    cfg->table_bits = 20;
+}
+
+static unsigned long long mix64(unsigned long long x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+static unsigned long long pawn_key(int player, Pos p) {
+    return mix64((1ULL << 60) ^ ((unsigned long long)player << 48) ^
+                 ((unsigned long long)p.row << 24) ^ (unsigned long long)p.col);
+}
+
+static unsigned long long wall_key(int row, int col, WallDir dir) {
+    return mix64((2ULL << 60) ^ ((unsigned long long)dir << 48) ^
+                 ((unsigned long long)row << 24) ^ (unsigned long long)col);
+}
+
+static unsigned long long board_key(const Game *g) {
+    unsigned long long key = mix64((5ULL << 60) ^ (unsigned long long)g->size);
+    int r;
+    int c;
+    int i;
+    for (i = 0; i < PLAYER_COUNT; i++) key ^= pawn_key(i, g->players[i]);
+    for (r = 0; r < g->size - 1; r++) {
+        for (c = 0; c < g->size - 1; c++) {
+            if (game_wall_at(g, r, c, DIR_H)) key ^= wall_key(r, c, DIR_H);
+            if (game_wall_at(g, r, c, DIR_V)) key ^= wall_key(r, c, DIR_V);
+        }
+    }
+    return key;
+}
+
+/* Unlike the AI table, wall counts are hashed in full: a proof must not
+ * be borrowed from a position with a different stock. */
+static unsigned long long state_key(const Game *g, int side, unsigned long long board) {
+    unsigned long long key = board ^ mix64((4ULL << 60) ^ (unsigned long long)side);
+    int i;
+    for (i = 0; i < PLAYER_COUNT; i++) {
+        key ^= mix64((3ULL << 60) ^ ((unsigned long long)i << 48) ^ ((unsigned long long)g->walls_left[i] << 24) ^
+                     (unsigned long long)g->blocked_turns[i]);
+    }
+    return key;
+}
+
+static uint32_t add_sat(uint32_t a, uint32_t b) {
+    return a >= PNS_INF - b ? PNS_INF : a + b;
+}
+
+/* Two-slot buckets; a miss replaces the slot that took less work. */
+static PnsEntry *lookup(Pns *p, unsigned long long key) {
+    PnsEntry *e = &p->table[key & p->mask & ~(size_t)1];
+    if (e[0].key == key) return &e[0];
+    if (e[1].key == key) return &e[1];
+    return NULL;
+}
+
+static void store(Pns *p, unsigned long long key, uint32_t pn, uint32_t dn, long work, const AiAction *best) {
+    PnsEntry *e = &p->table[key & p->mask & ~(size_t)1];
+    PnsEntry *slot;
+    if (e[0].key == key || e[0].key == 0) {
+        slot = &e[0];
+    } else if (e[1].key == key || e[1].key == 0) {
+        slot = &e[1];
+    } else {
+        slot = e[0].work <= e[1].work ? &e[0] : &e[1];
+    }
+    if (slot->key != key) slot->walk = 0;
+    slot->key = key;
+    slot->pn = pn;
+    slot->dn = dn;
+    slot->work = work > 0xFFFFFFFFL ? 0xFFFFFFFFu : (uint32_t)work;
+    slot->best = *best;
+}
+
+static void set_proof(int winner_is_attacker, uint32_t *pn, uint32_t *dn) {
+    *pn = winner_is_attacker ? 0 : PNS_INF;
+    *dn = winner_is_attacker ? PNS_INF : 0;
+}
+
+/* Finished games and pure races have a known result. A race the attacker
+ * cannot win, drawn ones included, is a disproof. Building the race table
+ * costs far more than a node, so children only use it when it is already
+ * built for their walls; it is built when a race node is expanded. */
+static int leaf_value(Pns *p, int side, int build, uint32_t *pn, uint32_t *dn) {
+    Game *g = p->g;
+    int winner = game_check_winner(g);
+    if (winner >= 0) {
+        set_proof(winner == p->attacker, pn, dn);
+        return 1;
+    }
+    if (race_is_pure(g, 0) && (!build || race_prepare(&p->race, g))) {
+        int root = g->current_player;
+        RaceResult r;
+        g->current_player = side;
+        r = race_solve(&p->race, g, NULL, NULL);
+        g->current_player = root;
+        if (r == RACE_UNKNOWN) return 0;
+        set_proof((r == RACE_WIN && side == p->attacker) || (r == RACE_LOSS && side != p->attacker), pn, dn);
+        return 1;
+    }
+    return 0;
+}
+
+/* The ply at which key is on the current path, or -1. */
+static int on_path(const Pns *p, unsigned long long key) {
+    int i;
+    for (i = 0; i < p->ply; i++) {
+        if (p->path[i] == key) return i;
+    }
+    return -1;
+}
+
+static int apply(Game *g, int side, const AiAction *a) {
+    if (a->type == AI_ACT_NONE) {
+        g->blocked_turns[side]--;
+        return 1;
+    }
+    return ai_apply_action(g, side, a, NULL, 0);
+}
+
+static void undo(Game *g, int side, const AiAction *a, Pos old) {
+    if (a->type == AI_ACT_NONE) {
+        g->blocked_turns[side]++;
+    } else if (a->type == AI_ACT_MOVE) {
+        game_set_player_pos(g, side, old.row, old.col);
+    } else {
+        game_remove_wall(g, side, a->row, a->col, a->dir);
+    }
+}
+
+static unsigned long long child_board(const Game *g, int side, unsigned long long board, const AiAction *a) {
+    if (a->type == AI_ACT_MOVE) return board ^ pawn_key(side, g->players[side]) ^ pawn_key(side, a->target);
+    if (a->type == AI_ACT_WALL) return board ^ wall_key(a->row, a->col, a->dir);
+    return board;
+}
+
+/* Every legal action of the side to move: moves first, then walls in
+ * impact order. A blocked side, or one with nothing legal, passes. */
+static int list_actions(Pns *p, int side, AiAction **out) {
+    Game *g = p->g;
+    Pos moves[16];
+    AiAction *list;
+    int move_count = 0;
+    int wall_count = 0;
+    int count = 0;
+    int i;
+
+    if (g->blocked_turns[side] <= 0) {
+        move_count = game_list_moves(g, side, moves, 16);
+        if (g->walls_left[side] > 0) {
+            if (!impact_scan(&p->impact, g, side)) return -1;
+            wall_count = p->impact.count;
+        }
+    }
+    list = (AiAction *)malloc(sizeof(AiAction) * (size_t)(move_count + wall_count + 1));
+    if (!list) return -1;
+    for (i = 0; i < move_count; i++) {
+        list[count].type = AI_ACT_MOVE;
+        list[count].target = moves[i];
+        list[count].row = 0;
+        list[count].col = 0;
+        list[count].dir = DIR_H;
+        count++;
+    }
+    for (i = 0; i < wall_count; i++) {
+        const WallImpact *w = &p->impact.list[i];
+        list[count].type = AI_ACT_WALL;
+        list[count].target.row = 0;
+        list[count].target.col = 0;
+        list[count].row = w->row;
+        list[count].col = w->col;
+        list[count].dir = w->dir;
+        count++;
+    }
+    if (count == 0) {
+        memset(&list[0], 0, sizeof(AiAction));
+        list[0].type = AI_ACT_NONE;
+        count = 1;
+    }
+    *out = list;
+    return count;
+}
+
+static int expand(Pns *p, int side, unsigned long long board, PnsChild **out) {
+    Game *g = p->g;
+    AiAction *acts;
+    PnsChild *kids;
+    int count = list_actions(p, side, &acts);
+    int kept = 0;
+    int i;
+
+    if (count < 0) return -1;
+    kids = (PnsChild *)malloc(sizeof(PnsChild) * (size_t)count);
+    if (!kids) {
+        free(acts);
+        return -1;
+    }
+    for (i = 0; i < count; i++) {
+        PnsChild *k = &kids[kept];
+        Pos old = g->players[side];
+        k->act = acts[i];
+        k->board = child_board(g, side, board, &acts[i]);
+        if (!apply(g, side, &acts[i])) continue;
+        k->key = state_key(g, 1 - side, k->board);
+        k->pn = 1;
+        k->dn = 1;
+        k->dep = PNS_NO_DEP;
+        k->fixed = leaf_value(p, 1 - side, 0, &k->pn, &k->dn);
+        if (!k->fixed) {
+            int at = on_path(p, k->key);
+            if (at >= 0 || p->ply + 1 >= PNS_MAX_PLY) {
+                set_proof(0, &k->pn, &k->dn);
+                k->dep = at >= 0 ? at : -1;
+                k->fixed = 1;
+            }
+        }
+        undo(g, side, &acts[i], old);
+        kept++;
+    }
+    free(acts);
+    *out = kids;
+    return kept;
+}
+
+static int should_stop(Pns *p) {
+    if (p->aborted) return 1;
+    if (p->nodes >= p->cfg.node_limit) p->aborted = 1;
+    if (p->cfg.time_limit_ms > 0 && (p->nodes & 255) == 0 && thread_now_ms() >= p->deadline_ms) p->aborted = 1;
+    return p->aborted;
+}
+
+/* The ply a solved node's result depends on: the least path-dependent
+ * child that wins it for the side to move, or else the most dependent of
+ * the children that all lose. Dependencies at or below the node itself
+ * are inside its own subtree and do not count. */
+static int result_dep(const PnsChild *kids, int count, int attack, int ply) {
+    int dep = -2;
+    int i;
+    for (i = 0; i < count; i++) {
+        uint32_t mine = attack ? kids[i].pn : kids[i].dn;
+        if (mine == 0 && kids[i].dep > dep) dep = kids[i].dep;
+    }
+    if (dep == -2) {
+        dep = PNS_NO_DEP;
+        for (i = 0; i < count; i++) {
+            if (kids[i].dep < dep) dep = kids[i].dep;
+        }
+    }
+    return dep >= ply ? PNS_NO_DEP : dep;
+}
+
+/* Searches below the node until its proof number reaches thpn or its
+ * disproof number reaches thdn, then stores it. The attacker's nodes take
+ * the smallest proof number of their children and the sum of their
+ * disproof numbers; the defender's the other way round. A solved result
+ * that depends on the path above the node is passed up in dep instead of
+ * being stored, since another path to the same position may not repeat. */
+static void mid(Pns *p, int side, unsigned long long board, unsigned long long key, uint32_t thpn, uint32_t thdn,
+                uint32_t *pn, uint32_t *dn, int *dep) {
+    Game *g = p->g;
+    int attack = side == p->attacker;
+    int ply = p->ply;
+    long start = p->nodes;
+    AiAction best;
+    PnsChild *kids;
+    int count;
+    int i;
+
+    *dep = PNS_NO_DEP;
+    if (should_stop(p)) return;
+    p->nodes++;
+    memset(&best, 0, sizeof(best));
+    if (leaf_value(p, side, 1, pn, dn)) {
+        store(p, key, *pn, *dn, 1, &best);
+        return;
+    }
+    count = expand(p, side, board, &kids);
+    if (count < 0) {
+        p->out_of_memory = 1;
+        p->aborted = 1;
+        return;
+    }
+    p->path[p->ply++] = key;
+
+    for (;;) {
+        uint32_t first = PNS_INF;
+        uint32_t second = PNS_INF;
+        uint32_t sum = 0;
+        uint32_t cthpn;
+        uint32_t cthdn;
+        int pick = 0;
+        PnsChild *k;
+        Pos old;
+
+        for (i = 0; i < count; i++) {
+            uint32_t mine;
+            uint32_t theirs;
+            if (!kids[i].fixed) {
+                PnsEntry *e = lookup(p, kids[i].key);
+                if (e) {
+                    kids[i].pn = e->pn;
+                    kids[i].dn = e->dn;
+                }
+            }
+            mine = attack ? kids[i].pn : kids[i].dn;
+            theirs = attack ? kids[i].dn : kids[i].pn;
+            sum = add_sat(sum, theirs);
+            if (mine < first) {
+                second = first;
+                first = mine;
+                pick = i;
+            } else if (mine < second) {
+                second = mine;
+            }
+        }
+        if (count == 0) first = PNS_INF;
+        *pn = attack ? first : sum;
+        *dn = attack ? sum : first;
+        if (count > 0) best = kids[pick].act;
+        if (*pn >= thpn || *dn >= thdn || p->aborted) break;
+
+        k = &kids[pick];
+        if (attack) {
+            cthpn = thpn < second + 1 ? thpn : second + 1;
+            cthdn = add_sat(thdn - *dn, k->dn);
+        } else {
+            cthdn = thdn < second + 1 ? thdn : second + 1;
+            cthpn = add_sat(thpn - *pn, k->pn);
+        }
+        old = g->players[side];
+        apply(g, side, &k->act);
+        mid(p, 1 - side, k->board, k->key, cthpn, cthdn, &k->pn, &k->dn, &k->dep);
+        undo(g, side, &k->act, old);
+        if (k->dep != PNS_NO_DEP) k->fixed = 1;
+    }
+
+    p->ply--;
+    if (*pn == 0 || *dn == 0) *dep = result_dep(kids, count, attack, ply);
+    free(kids);
+    if (*dep != PNS_NO_DEP) return;
+    if (!p->aborted || *pn == 0 || *dn == 0) store(p, key, *pn, *dn, p->nodes - start, &best);
+}
+
+/* Counts the distinct positions of the proof (or disproof) tree: at the
+ * nodes where the winning side chooses, the stored best child; elsewhere
+ * every child. */
+static void walk(Pns *p, int side, unsigned long long board, unsigned long long key, int proving) {
+    Game *g = p->g;
+    PnsEntry *e;
+    uint32_t pn;
+    uint32_t dn;
+    int chooser = proving ? side == p->attacker : side != p->attacker;
+    int i;
+
+    if (leaf_value(p, side, 1, &pn, &dn) || on_path(p, key) >= 0 || p->ply >= PNS_MAX_PLY) {
+        p->walk_size++;
+        return;
+    }
+    e = lookup(p, key);
+    if (!e || (proving ? e->pn : e->dn) != 0) {
+        p->walk_missing++;
+        return;
+    }
+    if (e->walk == p->walk) return;
+    e->walk = p->walk;
+    p->walk_size++;
+    p->path[p->ply++] = key;
+
+    if (chooser || g->blocked_turns[side] > 0) {
+        AiAction a = e->best;
+        Pos old = g->players[side];
+        unsigned long long child;
+        if (g->blocked_turns[side] > 0) a.type = AI_ACT_NONE;
+        child = child_board(g, side, board, &a);
+        if (apply(g, side, &a)) {
+            walk(p, 1 - side, child, state_key(g, 1 - side, child), proving);
+            undo(g, side, &a, old);
+        }
+    } else {
+        AiAction *acts;
+        int count = list_actions(p, side, &acts);
+        for (i = 0; i < count; i++) {
+            Pos old = g->players[side];
+            unsigned long long child = child_board(g, side, board, &acts[i]);
+            if (!apply(g, side, &acts[i])) continue;
+            walk(p, 1 - side, child, state_key(g, 1 - side, child), proving);
+            undo(g, side, &acts[i], old);
+        }
+        if (count > 0) free(acts);
+    }
+    p->ply--;
+}
+
+int pns_prove(const PnsConfig *cfg, const Game *g, PnsStats *stats, char *err, size_t err_cap) {
+    Game work;
+    Pns p;
+    unsigned long long board;
+    unsigned long long key;
+    uint32_t pn = 1;
+    uint32_t dn = 1;
+    int dep = PNS_NO_DEP;
+    double start = thread_now_ms();
+    size_t entries;
+    size_t i;
+    int side;
+
+    if (!cfg || !g || !stats) return 0;
+    memset(stats, 0, sizeof(*stats));
+    memset(&p, 0, sizeof(p));
+    p.cfg = *cfg;
+    if (p.cfg.table_bits < 10) p.cfg.table_bits = 10;
+    if (p.cfg.table_bits > 28) p.cfg.table_bits = 28;
+    if (p.cfg.node_limit <= 0) p.cfg.node_limit = 1;
+    entries = (size_t)1 << p.cfg.table_bits;
+    p.table = (PnsEntry *)calloc(entries, sizeof(PnsEntry));
+    if (!p.table) {
+        set_err(err, err_cap, "Not enough memory for the proof table.");
+        return 0;
+    }
+    p.mask = entries - 1;
+    game_init(&work);
+    if (!game_copy(&work, g)) {
+        free(p.table);
+        set_err(err, err_cap, "Not enough memory for the position.");
+        return 0;
+    }
+    impact_init(&p.impact);
+    race_init(&p.race);
+    p.g = &work;
+    side = g->current_player;
+    p.attacker = side;
+    p.deadline_ms = start + p.cfg.time_limit_ms;
+    board = board_key(&work);
+    key = state_key(&work, side, board);
+
+    if (leaf_value(&p, side, 1, &pn, &dn)) {
+        stats->tree_size = 1;
+    } else {
+        mid(&p, side, board, key, PNS_INF, PNS_INF, &pn, &dn, &dep);
+    }
+    stats->player = side;
+    stats->nodes = p.nodes;
+    stats->result = pn == 0 ? PNS_PROVEN : (dn == 0 ? PNS_DISPROVEN : PNS_UNKNOWN);
+    /* Only the ply limit survives to the root; such a disproof says
+     * nothing about longer lines. */
+    if (dep != PNS_NO_DEP) {
+        stats->result = PNS_UNKNOWN;
+        stats->ply_limited = 1;
+    }
+
+    if (stats->result != PNS_UNKNOWN && !stats->tree_size) {
+        PnsEntry *root = lookup(&p, key);
+        if (root && stats->result == PNS_PROVEN) stats->best = root->best;
+        p.walk = 1;
+        walk(&p, side, board, key, stats->result == PNS_PROVEN);
+        stats->tree_size = p.walk_size;
+        stats->tree_missing = p.walk_missing;
+    }
+    for (i = 0; i < entries; i++) {
+        if (p.table[i].key != 0) stats->entries_used++;
+    }
+    stats->entries = (long)entries;
+    stats->ms = thread_now_ms() - start;
+
+    race_free(&p.race);
+    impact_free(&p.impact);
+    game_free(&work);
+    free(p.table);
+    if (p.out_of_memory) {
+        set_err(err, err_cap, "Not enough memory to expand a position.");
+        return 0;
+    }
+    return 1;
+}
+
+void pns_print(FILE *out, const PnsConfig *cfg, const PnsStats *stats) {
+    char move[32];
+    if (stats->result == PNS_PROVEN) {
+        fprintf(out, "Proven: player %d to move wins", stats->player + 1);
+        if (stats->best.type != AI_ACT_NONE) {
+            notation_format_action(&stats->best, move, sizeof(move));
+            fprintf(out, ", first move %s", move);
+        }
+        fprintf(out, ".\n");
+    } else if (stats->result == PNS_DISPROVEN) {
+        fprintf(out, "Disproven: player %d to move has no forced win.\n", stats->player + 1);
+    } else if (stats->ply_limited) {
+        fprintf(out, "Unknown: no forced win within %d plies, but longer lines were not searched.\n", PNS_MAX_PLY);
+    } else {
+        fprintf(out, "Unknown: no result within %ld nodes", cfg->node_limit);
+        if (cfg->time_limit_ms > 0) fprintf(out, " or %d ms", cfg->time_limit_ms);
+        fprintf(out, ".\n");
+    }
+    if (stats->result != PNS_UNKNOWN) {
+        fprintf(out, "%s tree: %ld position(s)", stats->result == PNS_PROVEN ? "Proof" : "Disproof", stats->tree_size);
+        if (stats->tree_missing > 0) fprintf(out, ", %ld more not kept in the table", stats->tree_missing);
+        fprintf(out, "\n");
+    }
+    fprintf(out, "%ld nodes in %.1f ms, table %ld of %ld entries in use\n", stats->nodes, stats->ms,
+            stats->entries_used, stats->entries);
+}
+
+/* Exact solver for the benchmark: every position reachable from the start
+ * of a small game, packed into one number (pawn cells, side to move, wall
+ * stocks and one bit per wall slot), then solved backwards from the
+ * finished games. Positions neither side can force are draws. */
+typedef struct {
+    unsigned long long *codes;
+    int *first;
+    int *next;
+    signed char *value;
+    int count;
+    int cap;
+    int first_cap;
+    long edges;
+    long edge_cap;
+    int *slots;
+    size_t slot_mask;
+} PnsBrute;
+
+static unsigned long long brute_code(const Game *g, int side) {
+    int n = g->size;
+    unsigned long long code = (unsigned long long)(g->players[0].row * n + g->players[0].col) |
+                              ((unsigned long long)(g->players[1].row * n + g->players[1].col) << 4) |
+                              ((unsigned long long)side << 8) | ((unsigned long long)g->walls_left[0] << 9) |
+                              ((unsigned long long)g->walls_left[1] << 12);
+    int r;
+    int c;
+    for (r = 0; r < n - 1; r++) {
+        for (c = 0; c < n - 1; c++) {
+            if (game_wall_at(g, r, c, DIR_H)) code |= 1ULL << (15 + r * (n - 1) + c);
+            if (game_wall_at(g, r, c, DIR_V)) code |= 1ULL << (24 + r * (n - 1) + c);
+        }
+    }
+    return code;
+}
+
+static int brute_decode(Game *g, int size, unsigned long long code) {
+    Pos pawns[PLAYER_COUNT];
+    int r;
+    int c;
+    if (!game_clear(g, size)) return 0;
+    for (r = 0; r < size - 1; r++) {
+        for (c = 0; c < size - 1; c++) {
+            if ((code >> (15 + r * (size - 1) + c)) & 1) game_add_wall_from_map(g, r, c, DIR_H);
+            if ((code >> (24 + r * (size - 1) + c)) & 1) game_add_wall_from_map(g, r, c, DIR_V);
+        }
+    }
+    pawns[0].row = (int)(code & 15) / size;
+    pawns[0].col = (int)(code & 15) % size;
+    pawns[1].row = (int)((code >> 4) & 15) / size;
+    pawns[1].col = (int)((code >> 4) & 15) % size;
+    g->walls_left[0] = (int)((code >> 9) & 7);
+    g->walls_left[1] = (int)((code >> 12) & 7);
+    g->current_player = (int)((code >> 8) & 1);
+    return game_set_pawns(g, pawns);
+}
+
+/* The index of a position, adding it when new; -1 when out of memory. */
+static int brute_index(PnsBrute *b, unsigned long long code) {
+    size_t h = (size_t)mix64(code) & b->slot_mask;
+    while (b->slots[h] >= 0) {
+        if (b->codes[b->slots[h]] == code) return b->slots[h];
+        h = (h + 1) & b->slot_mask;
+    }
+    if ((size_t)b->count * 2 >= b->slot_mask) {
+        size_t cap = (b->slot_mask + 1) * 2;
+        int *slots = (int *)malloc(cap * sizeof(int));
+        int i;
+        if (!slots) return -1;
+        memset(slots, 0xFF, cap * sizeof(int));
+        for (i = 0; i < b->count; i++) {
+            size_t k = (size_t)mix64(b->codes[i]) & (cap - 1);
+            while (slots[k] >= 0) k = (k + 1) & (cap - 1);
+            slots[k] = i;
+        }
+        free(b->slots);
+        b->slots = slots;
+        b->slot_mask = cap - 1;
+        return brute_index(b, code);
+    }
+    if (b->count == b->cap) {
+        int cap = b->cap ? b->cap * 2 : 1024;
+        unsigned long long *codes = (unsigned long long *)realloc(b->codes, (size_t)cap * sizeof(*codes));
+        if (!codes) return -1;
+        b->codes = codes;
+        b->cap = cap;
+    }
+    b->codes[b->count] = code;
+    b->slots[h] = b->count;
+    return b->count++;
+}
+
+static int brute_edge(PnsBrute *b, int to) {
+    if (to < 0) return 0;
+    if (b->edges == b->edge_cap) {
+        long cap = b->edge_cap ? b->edge_cap * 2 : 4096;
+        int *next = (int *)realloc(b->next, (size_t)cap * sizeof(int));
+        if (!next) return 0;
+        b->next = next;
+        b->edge_cap = cap;
+    }
+    b->next[b->edges++] = to;
+    return 1;
+}
+
+/* Lists the positions breadth first; position i's successors are
+ * next[first[i]] up to next[first[i + 1]]. A side with nothing legal
+ * passes, as in the search. */
+static int brute_build(PnsBrute *b, int size, int walls) {
+    Game g;
+    Pos moves[16];
+    int i;
+    int ok = 1;
+
+    memset(b, 0, sizeof(*b));
+    b->slot_mask = 1023;
+    b->slots = (int *)malloc((b->slot_mask + 1) * sizeof(int));
+    if (!b->slots) return 0;
+    memset(b->slots, 0xFF, (b->slot_mask + 1) * sizeof(int));
+    game_init(&g);
+    if (!game_start(&g, size, walls, MODE_PVP, "A", "B") || brute_index(b, brute_code(&g, 0)) < 0) ok = 0;
+
+    for (i = 0; ok && i < b->count; i++) {
+        long before = b->edges;
+        int side;
+        int count;
+        int r;
+        int c;
+        int d;
+        int j;
+        if (b->first_cap <= b->cap) {
+            int *first = (int *)realloc(b->first, ((size_t)b->cap + 1) * sizeof(int));
+            if (!first) {
+                ok = 0;
+                break;
+            }
+            b->first = first;
+            b->first_cap = b->cap + 1;
+        }
+        if (!brute_decode(&g, size, b->codes[i])) {
+            ok = 0;
+            break;
+        }
+        b->first[i] = (int)before;
+        side = g.current_player;
+        if (game_check_winner(&g) >= 0) continue;
+        count = game_list_moves(&g, side, moves, 16);
+        for (j = 0; ok && j < count; j++) {
+            Pos old = g.players[side];
+            game_set_player_pos(&g, side, moves[j].row, moves[j].col);
+            ok = brute_edge(b, brute_index(b, brute_code(&g, 1 - side)));
+            game_set_player_pos(&g, side, old.row, old.col);
+        }
+        for (r = 0; ok && r < size - 1; r++) {
+            for (c = 0; ok && c < size - 1; c++) {
+                for (d = 0; ok && d < 2; d++) {
+                    WallDir dir = d ? DIR_V : DIR_H;
+                    if (!game_place_wall(&g, side, r, c, dir, NULL, 0)) continue;
+                    ok = brute_edge(b, brute_index(b, brute_code(&g, 1 - side)));
+                    game_remove_wall(&g, side, r, c, dir);
+                }
+            }
+        }
+        if (ok && b->edges == before) ok = brute_edge(b, brute_index(b, brute_code(&g, 1 - side)));
+    }
+    game_free(&g);
+    if (!ok) return 0;
+    b->first[b->count] = (int)b->edges;
+    b->value = (signed char *)calloc((size_t)b->count, 1);
+    return b->value != NULL;
+}
+
+/* value is 1 when the side to move can force a win, -1 when the other
+ * side can, 0 for a draw. */
+static void brute_solve(PnsBrute *b, int size) {
+    Game g;
+    int changed = 1;
+    int i;
+    game_init(&g);
+    for (i = 0; i < b->count; i++) {
+        int winner;
+        if (b->first[i] != b->first[i + 1] || !brute_decode(&g, size, b->codes[i])) continue;
+        winner = game_check_winner(&g);
+        if (winner >= 0) b->value[i] = winner == g.current_player ? 1 : -1;
+    }
+    game_free(&g);
+    while (changed) {
+        changed = 0;
+        for (i = 0; i < b->count; i++) {
+            int all_lost = 1;
+            int j;
+            if (b->value[i] != 0 || b->first[i] == b->first[i + 1]) continue;
+            for (j = b->first[i]; j < b->first[i + 1]; j++) {
+                if (b->value[b->next[j]] == -1) break;
+                if (b->value[b->next[j]] != 1) all_lost = 0;
+            }
+            if (j < b->first[i + 1]) {
+                b->value[i] = 1;
+                changed = 1;
+            } else if (all_lost) {
+                b->value[i] = -1;
+                changed = 1;
+            }
+        }
+    }
+}
+
+static void brute_free(PnsBrute *b) {
+    free(b->codes);
+    free(b->first);
+    free(b->next);
+    free(b->value);
+    free(b->slots);
+}
+
+/* Every step-th unfinished position of a small game, proven by the search
+ * and by the exact solver; the two must never disagree. */
+static int bench_game(FILE *out, int size, int walls, int step) {
+    PnsBrute b;
+    PnsConfig cfg;
+    Game g;
+    long checked = 0;
+    long unknown = 0;
+    long wrong = 0;
+    long nodes = 0;
+    double t0 = thread_now_ms();
+    double build_ms;
+    double prove_ms;
+    int ok;
+    int i;
+
+    if (!brute_build(&b, size, walls)) {
+        brute_free(&b);
+        fprintf(out, "%dx%d with %d wall(s) each: not enough memory\n", size, size, walls);
+        return 0;
+    }
+    brute_solve(&b, size);
+    build_ms = thread_now_ms() - t0;
+
+    pns_default_config(&cfg);
+    cfg.node_limit = 100000;
+    cfg.table_bits = 16;
+    game_init(&g);
+    t0 = thread_now_ms();
+    for (i = 0; i < b.count; i += step) {
+        PnsStats stats;
+        if (b.first[i] == b.first[i + 1] || !brute_decode(&g, size, b.codes[i])) continue;
+        if (!pns_prove(&cfg, &g, &stats, NULL, 0)) break;
+        checked++;
+        nodes += stats.nodes;
+        if (stats.result == PNS_UNKNOWN) {
+            unknown++;
+        } else if ((stats.result == PNS_PROVEN) != (b.value[i] == 1)) {
+            char line[512];
+            wrong++;
+            if (wrong <= 5 && notation_format(&g, line, sizeof(line))) {
+                fprintf(out, "  %s: search says %s, exact says %s\n", line,
+                        stats.result == PNS_PROVEN ? "win" : "no win", b.value[i] == 1 ? "win" : "no win");
+            }
+        }
+    }
+    prove_ms = thread_now_ms() - t0;
+    game_free(&g);
+
+    fprintf(out, "%dx%d with %d wall(s) each: %d positions solved exactly in %.0f ms; %ld checked by the search"
+            " (%.0f nodes, %.2f ms each), %ld unknown, %ld wrong\n",
+            size, size, walls, b.count, build_ms, checked, checked ? (double)nodes / checked : 0.0,
+            checked ? prove_ms / checked : 0.0, unknown, wrong);
+    fflush(out);
+    ok = wrong == 0 && i >= b.count;
+    brute_free(&b);
+    return ok;
+}
+
+int pns_benchmark(FILE *out) {
+    int ok = 1;
+    if (!bench_game(out, 3, 1, 1)) ok = 0;
+    if (!bench_game(out, 3, 2, 1)) ok = 0;
+    if (!bench_game(out, 4, 1, 7)) ok = 0;
+    if (!bench_game(out, 4, 2, 997)) ok = 0;
+    return ok;
+}
@@ -0,0 +1,54 @@
+#ifndef SIMPLE_PNS_H
+#define SIMPLE_PNS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "ai.h"
+#include "game.h"
+
+#define PNS_INF 0x3FFFFFFFu
+#define PNS_MAX_PLY 200
+
+typedef enum {
+    PNS_UNKNOWN = 0,
+    PNS_PROVEN,
+    PNS_DISPROVEN
+} PnsResult;
+
+typedef struct {
+    long node_limit;
+    int time_limit_ms;
+    int table_bits;
+} PnsConfig;
+
+typedef struct {
+    PnsResult result;
+    int player;
+    AiAction best;
+    int ply_limited;
+    long nodes;
+    long tree_size;
+    long tree_missing;
+    long entries_used;
+    long entries;
+    double ms;
+} PnsStats;
+
+/* Depth-first proof-number search (df-pn) for a forced win of the side to
+ * move, with magic off. Every legal action is tried on both sides, so a
+ * proof or disproof holds for the whole game tree. A line that repeats a
+ * position counts as a failure for the attacker, since a forced win never
+ * needs one. The table has a fixed size; when it is full the entries that
+ * took the least work are replaced. PNS_UNKNOWN means the node or time
+ * budget ran out first. */
+void pns_default_config(PnsConfig *cfg);
+int pns_prove(const PnsConfig *cfg, const Game *g, PnsStats *stats, char *err, size_t err_cap);
+void pns_print(FILE *out, const PnsConfig *cfg, const PnsStats *stats);
+
+/* Small games solved exactly by working back from every finished position,
+ * against the search on a sample of their positions. */
+int pns_benchmark(FILE *out);
+
+#endif
@@ -0,0 +1,81 @@
+#include "ponder.h"
+
+#include <string.h>
+
+static void ponder_run(void *arg) {
+    Ponder *p = (Ponder *)arg;
+    Ai *ai = p->ai;
+    const Game *g = &p->pos;
+    int human = g->current_player;
+    int computer = game_next_player(human);
+    AiAction replies[AI_MAX_ACTIONS];
+    int order[AI_MAX_ACTIONS];
+    int likely[AI_MAX_ACTIONS];
+    int count;
+    int i;
+    int j;
+
+    count = ai_list_actions(ai, g, human, replies, AI_MAX_ACTIONS);
+
+    /* Most plausible human replies first: those the evaluation likes best
+     * for the human get searched before the input arrives. */
+    for (i = 0; i < count; i++) {
+        order[i] = i;
+        if (thread_atomic_load(&ai->stop)) return;
+        if (!game_copy(&p->next, g) || !ai_apply_action(&p->next, human, &replies[i], NULL, 0)) {
+            likely[i] = -1000000;
+            continue;
+        }
+        likely[i] = -ai_evaluate(ai, &p->next, computer);
+    }
+    for (i = 1; i < count; i++) {
+        int key = order[i];
+        for (j = i - 1; j >= 0 && likely[order[j]] < likely[key]; j--) order[j + 1] = order[j];
+        order[j + 1] = key;
+    }
+
+    for (i = 0; i < count; i++) {
+        if (thread_atomic_load(&ai->stop)) return;
+        if (likely[order[i]] == -1000000) continue;
+        if (!game_copy(&p->next, g)) return;
+        if (!ai_apply_action(&p->next, human, &replies[order[i]], NULL, 0)) continue;
+        if (game_check_winner(&p->next) >= 0) continue;
+        p->next.current_player = computer;
+        ai_ponder(ai, &p->next);
+        if (!ai->aborted || !thread_atomic_load(&ai->stop)) thread_atomic_add(&p->replies_done, 1);
+    }
+}
+
+void ponder_init(Ponder *p) {
+    if (!p) return;
+    memset(p, 0, sizeof(*p));
+    game_init(&p->pos);
+    game_init(&p->next);
+}
+
+void ponder_free(Ponder *p) {
+    if (!p) return;
+    ponder_stop(p);
+    game_free(&p->pos);
+    game_free(&p->next);
+}
+
+int ponder_start(Ponder *p, Ai *ai, const Game *g) {
+    if (!p || !ai || !g) return 0;
+    if (p->running) ponder_stop(p);
+    if (!game_copy(&p->pos, g)) return 0;
+    p->ai = ai;
+    p->replies_done = 0;
+    thread_atomic_store(&ai->stop, 0);
+    if (!thread_start(&p->thread, ponder_run, p)) return 0;
+    p->running = 1;
+    return 1;
+}
+
+void ponder_stop(Ponder *p) {
+    if (!p || !p->running) return;
+    thread_atomic_store(&p->ai->stop, 1);
+    thread_join(&p->thread);
+    thread_atomic_store(&p->ai->stop, 0);
+    p->running = 0;
+}
@@ -0,0 +1,22 @@
+#ifndef SIMPLE_PONDER_H
+#define SIMPLE_PONDER_H
+
+#include "ai.h"
+#include "game.h"
+#include "thread.h"
+
+typedef struct {
+    Ai *ai;
+    Game pos;
+    Game next;
+    Thread thread;
+    int running;
+    volatile long replies_done;
+} Ponder;
+
+void ponder_init(Ponder *p);
+void ponder_free(Ponder *p);
+int ponder_start(Ponder *p, Ai *ai, const Game *g);
+void ponder_stop(Ponder *p);
+
+#endif
@@ -0,0 +1,500 @@
+#include "race.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "thread.h"
+
+static const int step_dr[4] = {-1, 1, 0, 0};
+static const int step_dc[4] = {0, 0, -1, 1};
+
+void race_init(RaceTable *t) {
+    if (!t) return;
+    memset(t, 0, sizeof(*t));
+}
+
+void race_free(RaceTable *t) {
+    if (!t) return;
+    free(t->right);
+    free(t->down);
+    free(t->result);
+    free(t->plies);
+    free(t->left);
+    free(t->queue);
+    free(t->open);
+    free(t->goal);
+    race_init(t);
+}
+
+int race_is_pure(const Game *g, int magic) {
+    if (!g || magic) return 0;
+    return g->walls_left[0] == 0 && g->walls_left[1] == 0;
+}
+
+/* Pawn moves from cell me with the opponent on cell opp, in the order of
+ * game_list_moves: steps, the jump, then the side steps around it. */
+static int race_moves(const Game *g, int me, int opp, int *out) {
+    int n = g->size;
+    int r = me / n;
+    int c = me % n;
+    int orow = opp / n;
+    int ocol = opp % n;
+    int odr = orow - r;
+    int odc = ocol - c;
+    int count = 0;
+    int d;
+
+    for (d = 0; d < 4; d++) {
+        int nr = r + step_dr[d];
+        int nc = c + step_dc[d];
+        if (game_is_blocked(g, r, c, nr, nc) || nr * n + nc == opp) continue;
+        out[count++] = nr * n + nc;
+    }
+    if (odr * odr + odc * odc != 1 || game_is_blocked(g, r, c, orow, ocol)) return count;
+    if (!game_is_blocked(g, orow, ocol, orow + odr, ocol + odc)) {
+        out[count++] = (orow + odr) * n + ocol + odc;
+        return count;
+    }
+    for (d = 0; d < 4; d++) {
+        int nr = orow + step_dr[d];
+        int nc = ocol + step_dc[d];
+        if ((step_dr[d] != 0) == (odr != 0)) continue;
+        if (!game_is_blocked(g, orow, ocol, nr, nc)) out[count++] = nr * n + nc;
+    }
+    return count;
+}
+
+/* The same moves read from the table's per-cell masks: open[cell] has
+ * bit d set when the step in direction d stays on the board unblocked. */
+static int table_moves(const RaceTable *t, int me, int opp, int *out) {
+    int n = t->size;
+    int count = 0;
+    int d;
+
+    for (d = 0; d < 4; d++) {
+        int to = me + step_dr[d] * n + step_dc[d];
+        if (!((t->open[me] >> d) & 1) || to == opp) continue;
+        out[count++] = to;
+    }
+    for (d = 0; d < 4; d++) {
+        int e;
+        if (!((t->open[me] >> d) & 1) || me + step_dr[d] * n + step_dc[d] != opp) continue;
+        if ((t->open[opp] >> d) & 1) {
+            out[count++] = opp + step_dr[d] * n + step_dc[d];
+            break;
+        }
+        for (e = 0; e < 4; e++) {
+            if ((step_dr[e] != 0) == (step_dr[d] != 0)) continue;
+            if ((t->open[opp] >> e) & 1) out[count++] = opp + step_dr[e] * n + step_dc[e];
+        }
+        break;
+    }
+    return count;
+}
+
+/* Whether table_moves(t, from, opp) would list to, without listing. */
+static int table_can_move(const RaceTable *t, int from, int to, int opp) {
+    int n = t->size;
+    int d;
+    int e;
+
+    for (d = 0; d < 4; d++) {
+        int next = from + step_dr[d] * n + step_dc[d];
+        if (!((t->open[from] >> d) & 1)) continue;
+        if (next != opp) {
+            if (next == to) return 1;
+            continue;
+        }
+        if ((t->open[opp] >> d) & 1) {
+            if (opp + step_dr[d] * n + step_dc[d] == to) return 1;
+            continue;
+        }
+        for (e = 0; e < 4; e++) {
+            if ((step_dr[e] != 0) == (step_dr[d] != 0)) continue;
+            if (((t->open[opp] >> e) & 1) && opp + step_dr[e] * n + step_dc[e] == to) return 1;
+        }
+    }
+    return 0;
+}
+
+static int at_goal(const Game *g, int player, int cell) {
+    return game_is_goal(g, player, cell / g->size, cell % g->size);
+}
+
+static long state_index(int cells, int p0, int p1, int side) {
+    return ((long)p0 * cells + p1) * 2 + side;
+}
+
+static int same_layout(const RaceTable *t, const Game *g) {
+    return t->ready && t->size == g->size && memcmp(t->right, g->block_right, t->words * sizeof(uint64_t)) == 0 &&
+           memcmp(t->down, g->block_down, t->words * sizeof(uint64_t)) == 0;
+}
+
+static int reserve(RaceTable *t, int size, long states) {
+    size_t words = ((size_t)size * (size_t)size + 63) / 64;
+    if (t->size == size && t->states == states && t->result) return 1;
+    race_free(t);
+    t->right = (uint64_t *)malloc(words * sizeof(uint64_t));
+    t->down = (uint64_t *)malloc(words * sizeof(uint64_t));
+    t->result = (unsigned char *)malloc((size_t)states);
+    t->plies = (uint16_t *)malloc((size_t)states * sizeof(uint16_t));
+    t->left = (unsigned char *)malloc((size_t)states);
+    t->queue = (uint32_t *)malloc((size_t)states * sizeof(uint32_t));
+    t->open = (unsigned char *)malloc((size_t)size * (size_t)size);
+    t->goal = (unsigned char *)malloc((size_t)size * (size_t)size);
+    if (!t->right || !t->down || !t->result || !t->plies || !t->left || !t->queue || !t->open || !t->goal) {
+        race_free(t);
+        return 0;
+    }
+    t->size = size;
+    t->words = words;
+    t->states = states;
+    return 1;
+}
+
+/* Builds the table for the walls of g, or keeps it when the walls have
+ * not changed. Returns 0 when the board is too large for a table. */
+int race_prepare(RaceTable *t, const Game *g) {
+    static const int back_dr[12] = {-1, 1, 0, 0, -2, 2, 0, 0, -1, -1, 1, 1};
+    static const int back_dc[12] = {0, 0, -1, 1, 0, 0, -2, 2, -1, 1, -1, 1};
+    int n;
+    int cells;
+    long states;
+    long head = 0;
+    long tail = 0;
+    double start;
+    int p0;
+    int p1;
+    int s;
+
+    if (!t || !g) return 0;
+    if (same_layout(t, g)) return 1;
+    n = g->size;
+    cells = n * n;
+    states = (long)cells * cells * 2;
+    if (states > RACE_MAX_STATES || !reserve(t, n, states)) return 0;
+
+    start = thread_now_ms();
+    t->ready = 0;
+    memcpy(t->right, g->block_right, t->words * sizeof(uint64_t));
+    memcpy(t->down, g->block_down, t->words * sizeof(uint64_t));
+    memset(t->result, RACE_UNKNOWN, (size_t)states);
+    memset(t->plies, 0, (size_t)states * sizeof(uint16_t));
+    for (p0 = 0; p0 < cells; p0++) {
+        int r = p0 / n;
+        int c = p0 % n;
+        t->open[p0] = 0;
+        for (s = 0; s < 4; s++) {
+            if (!game_is_blocked(g, r, c, r + step_dr[s], c + step_dc[s])) t->open[p0] |= (unsigned char)(1 << s);
+        }
+        t->goal[p0] = (unsigned char)(at_goal(g, 0, p0) | (at_goal(g, 1, p0) << 1));
+    }
+
+    for (p0 = 0; p0 < cells; p0++) {
+        for (p1 = 0; p1 < cells; p1++) {
+            int done;
+            if (p0 == p1) continue;
+            done = (t->goal[p0] & 1) || (t->goal[p1] & 2);
+            for (s = 0; s < 2; s++) {
+                long at = state_index(cells, p0, p1, s);
+                if (done) {
+                    int winner = (t->goal[p0] & 1) ? 0 : 1;
+                    t->result[at] = (unsigned char)(s == winner ? RACE_WIN : RACE_LOSS);
+                    t->queue[tail++] = (uint32_t)at;
+                } else {
+                    int moves[8];
+                    t->left[at] = (unsigned char)table_moves(t, s == 0 ? p0 : p1, s == 0 ? p1 : p0, moves);
+                }
+            }
+        }
+    }
+
+    /* Work back from finished positions in order of length: a position
+     * is won once one move reaches a lost one, and lost once every move
+     * reaches a won one. The last one to resolve it is the longest. */
+    while (head < tail) {
+        long at = (long)t->queue[head++];
+        int side = (int)(at & 1);
+        int mover = 1 - side;
+        int pair = (int)(at >> 1);
+        int pos[2];
+        int moved;
+        int k;
+
+        pos[0] = pair / cells;
+        pos[1] = pair % cells;
+        moved = pos[mover];
+        for (k = 0; k < 12; k++) {
+            int fr = moved / n + back_dr[k];
+            int fc = moved % n + back_dc[k];
+            int from = fr * n + fc;
+            long prev;
+
+            if (fr < 0 || fc < 0 || fr >= n || fc >= n || from == pos[side]) continue;
+            prev = mover == 0 ? state_index(cells, from, pos[1], 0) : state_index(cells, pos[0], from, 1);
+            if (t->result[prev] != RACE_UNKNOWN) continue;
+            if (!table_can_move(t, from, moved, pos[side])) continue;
+
+            if (t->result[at] == RACE_LOSS) {
+                t->result[prev] = RACE_WIN;
+            } else if (--t->left[prev] == 0) {
+                t->result[prev] = RACE_LOSS;
+            } else {
+                continue;
+            }
+            t->plies[prev] = (uint16_t)(t->plies[at] + 1);
+            t->queue[tail++] = (uint32_t)prev;
+        }
+    }
+    t->ready = 1;
+    t->build_ms = thread_now_ms() - start;
+    return 1;
+}
+
+static RaceResult flip(RaceResult r) {
+    if (r == RACE_WIN) return RACE_LOSS;
+    if (r == RACE_LOSS) return RACE_WIN;
+    return r;
+}
+
+/* Blocked turns are not in the table: they are played out here, with
+ * the table answering as soon as nobody is blocked. */
+static RaceResult solve(const RaceTable *t, const Game *g, int p0, int p1, int side, int b0, int b1, int *plies,
+                        int *best) {
+    int cells = g->size * g->size;
+    int pos[2];
+    int moves[8];
+    int count;
+    int found = 0;
+    int i;
+    RaceResult out = RACE_UNKNOWN;
+
+    if (best) *best = -1;
+    if (at_goal(g, 0, p0) || at_goal(g, 1, p1)) {
+        *plies = 0;
+        return side == (at_goal(g, 0, p0) ? 0 : 1) ? RACE_WIN : RACE_LOSS;
+    }
+    if ((side == 0 ? b0 : b1) > 0) {
+        RaceResult r = solve(t, g, p0, p1, 1 - side, side == 0 ? b0 - 1 : b0, side == 1 ? b1 - 1 : b1, plies, NULL);
+        *plies += 1;
+        return flip(r);
+    }
+    if (b0 == 0 && b1 == 0 && !best) {
+        long at = state_index(cells, p0, p1, side);
+        if (t->result[at] == RACE_UNKNOWN) return RACE_DRAW;
+        *plies = t->plies[at];
+        return (RaceResult)t->result[at];
+    }
+
+    pos[0] = p0;
+    pos[1] = p1;
+    count = table_moves(t, pos[side], pos[1 - side], moves);
+    for (i = 0; i < count; i++) {
+        int child_plies = 0;
+        RaceResult r;
+        RaceResult mine;
+        int better;
+
+        pos[side] = moves[i];
+        r = solve(t, g, pos[0], pos[1], 1 - side, b0, b1, &child_plies, NULL);
+        pos[side] = side == 0 ? p0 : p1;
+        mine = flip(r);
+        child_plies++;
+        /* Prefer a win, the fastest one; then a draw; then the slowest loss. */
+        if (!found) better = 1;
+        else if (mine != out) better = mine == RACE_WIN || (mine == RACE_DRAW && out == RACE_LOSS);
+        else better = (mine == RACE_WIN && child_plies < *plies) || (mine == RACE_LOSS && child_plies > *plies);
+        if (better) {
+            out = mine;
+            *plies = child_plies;
+            if (best) *best = moves[i];
+            found = 1;
+        }
+    }
+    return found ? out : RACE_DRAW;
+}
+
+/* Exact result for the side to move, the number of plies until a pawn
+ * arrives and, with best set, the move that gets there. RACE_UNKNOWN when
+ * the table was built for other walls or too many turns are blocked. */
+RaceResult race_solve(const RaceTable *t, const Game *g, int *plies, Pos *best) {
+    int n;
+    int p0;
+    int p1;
+    int cell = -1;
+    int len = 0;
+    RaceResult r;
+
+    if (!t || !g || !same_layout(t, g)) return RACE_UNKNOWN;
+    if (g->blocked_turns[0] + g->blocked_turns[1] > RACE_MAX_BLOCKED) return RACE_UNKNOWN;
+    n = g->size;
+    p0 = g->players[0].row * n + g->players[0].col;
+    p1 = g->players[1].row * n + g->players[1].col;
+    r = solve(t, g, p0, p1, g->current_player, g->blocked_turns[0], g->blocked_turns[1], &len, best ? &cell : NULL);
+    if (plies) *plies = len;
+    if (best) {
+        best->row = cell < 0 ? -1 : cell / n;
+        best->col = cell < 0 ? -1 : cell % n;
+    }
+    return r;
+}
+
+/* Plain search to a fixed depth, for checking the table. */
+static RaceResult brute(const Game *g, int *pos, int side, int depth, int *plies) {
+    int moves[8];
+    int count;
+    int own = pos[side];
+    int win = -1;
+    int loss = -1;
+    int open = 0;
+    int i;
+
+    if (at_goal(g, 0, pos[0]) || at_goal(g, 1, pos[1])) {
+        *plies = 0;
+        return side == (at_goal(g, 0, pos[0]) ? 0 : 1) ? RACE_WIN : RACE_LOSS;
+    }
+    if (depth == 0) return RACE_UNKNOWN;
+    count = race_moves(g, pos[side], pos[1 - side], moves);
+    for (i = 0; i < count; i++) {
+        int p = 0;
+        RaceResult r;
+        pos[side] = moves[i];
+        r = brute(g, pos, 1 - side, depth - 1, &p);
+        pos[side] = own;
+        p++;
+        if (r == RACE_LOSS && (win < 0 || p < win)) win = p;
+        else if (r == RACE_WIN && p > loss) loss = p;
+        else if (r == RACE_UNKNOWN || r == RACE_DRAW) open = 1;
+    }
+    if (win >= 0) {
+        *plies = win;
+        return RACE_WIN;
+    }
+    if (open || count == 0) return RACE_UNKNOWN;
+    *plies = loss;
+    return RACE_LOSS;
+}
+
+static int path_length(const Game *g, int player, int start, int *dist, int *queue) {
+    int n = g->size;
+    int head = 0;
+    int tail = 0;
+    int c;
+    for (c = 0; c < n * n; c++) dist[c] = -1;
+    dist[start] = 0;
+    queue[tail++] = start;
+    while (head < tail) {
+        int u = queue[head++];
+        int j;
+        if (at_goal(g, player, u)) return dist[u];
+        for (j = 0; j < 4; j++) {
+            int nr = u / n + step_dr[j];
+            int nc = u % n + step_dc[j];
+            if (game_is_blocked(g, u / n, u % n, nr, nc) || dist[nr * n + nc] >= 0) continue;
+            dist[nr * n + nc] = dist[u] + 1;
+            queue[tail++] = nr * n + nc;
+        }
+    }
+    return -1;
+}
+
+static int place_pawns(Game *g, int p0, int p1) {
+    int n = g->size;
+    int first = g->players[1].row * n + g->players[1].col == p0 ? 1 : 0;
+    int cell[2];
+    cell[0] = p0;
+    cell[1] = p1;
+    return game_set_player_pos(g, first, cell[first] / n, cell[first] % n) &&
+           game_set_player_pos(g, 1 - first, cell[1 - first] / n, cell[1 - first] % n);
+}
+
+/* Random walls, then random pawn pairs: the table against the plain
+ * rule (shorter path wins, the side to move first) and against search. */
+static int bench_size(FILE *out, int size, int samples) {
+    RaceTable t;
+    Game g;
+    int *dist;
+    int *queue;
+    long differ = 0;
+    long checked = 0;
+    long wrong = 0;
+    double solve_ms = 0.0;
+    int cells = size * size;
+    int i;
+
+    race_init(&t);
+    game_init(&g);
+    dist = (int *)malloc((size_t)cells * sizeof(int));
+    queue = (int *)malloc((size_t)cells * sizeof(int));
+    if (!dist || !queue || !game_start(&g, size, 0, MODE_PVP, "A", "B")) {
+        free(dist);
+        free(queue);
+        game_free(&g);
+        return 0;
+    }
+    game_set_seed(&g, (uint64_t)size * 104729u);
+    for (i = 0; i < cells / 4; i++) {
+        int r = (int)(game_random(&g) % (unsigned int)(size - 1));
+        int c = (int)(game_random(&g) % (unsigned int)(size - 1));
+        g.walls_left[0] = 1;
+        game_place_wall(&g, 0, r, c, (game_random(&g) & 1) ? DIR_V : DIR_H, NULL, 0);
+    }
+    g.walls_left[0] = 0;
+    if (!race_prepare(&t, &g)) {
+        free(dist);
+        free(queue);
+        game_free(&g);
+        return 0;
+    }
+
+    for (i = 0; i < samples; i++) {
+        int p0 = (int)(game_random(&g) % (unsigned int)cells);
+        int p1 = (int)(game_random(&g) % (unsigned int)cells);
+        int side = (int)(game_random(&g) & 1);
+        int pos[2];
+        int plies = 0;
+        int mine;
+        int theirs;
+        double t0;
+        RaceResult r;
+        Pos best;
+
+        if (p0 == p1 || at_goal(&g, 0, p0) || at_goal(&g, 1, p1) || !place_pawns(&g, p0, p1)) continue;
+        g.current_player = side;
+
+        t0 = thread_now_ms();
+        r = race_solve(&t, &g, &plies, &best);
+        solve_ms += thread_now_ms() - t0;
+
+        mine = path_length(&g, side, side == 0 ? p0 : p1, dist, queue);
+        theirs = path_length(&g, 1 - side, side == 0 ? p1 : p0, dist, queue);
+        if (r != RACE_DRAW && (r == RACE_WIN) != (mine <= theirs)) differ++;
+
+        if (plies <= 7 && r != RACE_DRAW) {
+            int bp = 0;
+            pos[0] = p0;
+            pos[1] = p1;
+            checked++;
+            if (brute(&g, pos, side, plies, &bp) != r || bp != plies) wrong++;
+        }
+    }
+
+    fprintf(out, "%3dx%-3d %8ld states built in %7.1f ms; %d positions at %5.2f us each, %ld decided differently"
+            " from path lengths alone; %ld checked by plain search, %ld wrong\n",
+            size, size, t.states, t.build_ms, samples, solve_ms * 1000.0 / samples, differ, checked, wrong);
+    fflush(out);
+    free(dist);
+    free(queue);
+    race_free(&t);
+    game_free(&g);
+    return wrong == 0;
+}
+
+int race_benchmark(FILE *out) {
+    int ok = 1;
+    if (!bench_size(out, 5, 2000)) ok = 0;
+    if (!bench_size(out, 9, 2000)) ok = 0;
+    if (!bench_size(out, 17, 2000)) ok = 0;
+    if (!bench_size(out, 25, 2000)) ok = 0;
+    return ok;
+}
@@ -0,0 +1,49 @@
+#ifndef SIMPLE_RACE_H
+#define SIMPLE_RACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "game.h"
+
+#define RACE_MAX_STATES (1L << 21)
+#define RACE_MAX_BLOCKED 8
+
+/* From the point of view of the side to move. */
+typedef enum {
+    RACE_UNKNOWN = 0,
+    RACE_WIN,
+    RACE_LOSS,
+    RACE_DRAW
+} RaceResult;
+
+/* Once neither player has a wall left (and magic cannot hand any back)
+ * the walls are fixed and the game is a pawn race. The table holds the
+ * exact result and length of every pawn pair and side to move for one
+ * wall layout, worked backwards from the finished positions, so jumps
+ * and pawns getting in each other's way are accounted for. */
+typedef struct {
+    int size;
+    size_t words;
+    uint64_t *right;
+    uint64_t *down;
+    unsigned char *result;
+    uint16_t *plies;
+    unsigned char *left;
+    uint32_t *queue;
+    unsigned char *open;
+    unsigned char *goal;
+    long states;
+    int ready;
+    double build_ms;
+} RaceTable;
+
+void race_init(RaceTable *t);
+void race_free(RaceTable *t);
+int race_is_pure(const Game *g, int magic);
+int race_prepare(RaceTable *t, const Game *g);
+RaceResult race_solve(const RaceTable *t, const Game *g, int *plies, Pos *best);
+int race_benchmark(FILE *out);
+
+#endif
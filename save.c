@@ -1,26 +1,41 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include "save.h"
 
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define SAVE_VERSION 2
+#define SAVE_V1_SIZE 50
+#define SAVE_FIELD_COUNT 11
+
 static void set_err(char *err, size_t cap, const char *msg) {
     if (err && cap) {
         snprintf(err, cap, "%s", msg);
     }
 }
 
-static int write_u32(FILE *fp, uint32_t value) {
-    return fwrite(&value, sizeof(value), 1, fp) == 1;
-}
-
 static int read_u32(FILE *fp, uint32_t *value) {
     return fread(value, sizeof(*value), 1, fp) == 1;
 }
 
 static int validate_loaded_game(const Game *g) {
     if (!g) return 0;
-    if (g->size < 2 || g->size > MAX_SIZE) return 0;
+    if (g->size < MIN_SIZE || g->size > MAX_SIZE) return 0;
     if (g->current_player < 0 || g->current_player >= PLAYER_COUNT) return 0;
     if (!game_in_range(g, g->players[0].row, g->players[0].col)) return 0;
     if (!game_in_range(g, g->players[1].row, g->players[1].col)) return 0;
@@ -31,57 +46,258 @@ static int validate_loaded_game(const Game *g) {
     return 1;
 }
 
+static size_t wall_bytes(int size) {
+    size_t spots = (size_t)(size - 1) * (size_t)(size - 1);
+    return (spots + 7) / 8;
+}
+
+static void pack_walls(const Game *g, WallDir dir, unsigned char *out) {
+    int n = g->size - 1;
+    int r;
+    int c;
+    size_t bit = 0;
+    memset(out, 0, wall_bytes(g->size));
+    for (r = 0; r < n; r++) {
+        for (c = 0; c < n; c++, bit++) {
+            if (game_wall_at(g, r, c, dir)) out[bit >> 3] |= (unsigned char)(1u << (bit & 7));
+        }
+    }
+}
+
+static int unpack_walls(Game *g, WallDir dir, const unsigned char *in) {
+    int n = g->size - 1;
+    int r;
+    int c;
+    size_t bit = 0;
+    for (r = 0; r < n; r++) {
+        for (c = 0; c < n; c++, bit++) {
+            if (!(in[bit >> 3] & (1u << (bit & 7)))) continue;
+            if (!game_add_wall_from_map(g, r, c, dir)) return 0;
+        }
+    }
+    return 1;
+}
+
+static unsigned char *put_u32(unsigned char *out, uint32_t value) {
+    memcpy(out, &value, sizeof(value));
+    return out + sizeof(value);
+}
+
+size_t save_image_size(const Game *g) {
+    if (!g) return 0;
+    return 4 + sizeof(uint32_t) * (1 + SAVE_FIELD_COUNT) + sizeof(g->player_name) + 2 * wall_bytes(g->size);
+}
+
+int save_encode(const Game *g, unsigned char *out, size_t cap) {
+    uint32_t f[SAVE_FIELD_COUNT];
+    int i;
+
+    if (!g || !out || cap < save_image_size(g)) return 0;
+    f[0] = (uint32_t)g->size;
+    f[1] = (uint32_t)g->mode;
+    f[2] = (uint32_t)g->current_player;
+    f[3] = (uint32_t)g->blocked_turns[0];
+    f[4] = (uint32_t)g->blocked_turns[1];
+    f[5] = (uint32_t)g->walls_left[0];
+    f[6] = (uint32_t)g->walls_left[1];
+    f[7] = (uint32_t)g->players[0].row;
+    f[8] = (uint32_t)g->players[0].col;
+    f[9] = (uint32_t)g->players[1].row;
+    f[10] = (uint32_t)g->players[1].col;
+
+    memcpy(out, "SQDR", 4);
+    out = put_u32(out + 4, SAVE_VERSION);
+    for (i = 0; i < SAVE_FIELD_COUNT; i++) out = put_u32(out, f[i]);
+    memcpy(out, g->player_name, sizeof(g->player_name));
+    out += sizeof(g->player_name);
+    pack_walls(g, DIR_H, out);
+    pack_walls(g, DIR_V, out + wall_bytes(g->size));
+    return 1;
+}
+
+/* Reads an image made by save_encode back into g. g keeps its random
+ * stream, as with load_game. */
+int save_decode(Game *g, const unsigned char *in, size_t len, char *err, size_t err_cap) {
+    uint32_t version;
+    uint32_t f[SAVE_FIELD_COUNT];
+    Game temp;
+    int i;
+
+    if (!g || !in || len < 8 + sizeof(f) + sizeof(temp.player_name) || memcmp(in, "SQDR", 4) != 0) {
+        set_err(err, err_cap, "Game image is corrupted or unsupported.");
+        return 0;
+    }
+    memcpy(&version, in + 4, sizeof(version));
+    memcpy(f, in + 8, sizeof(f));
+    if (version != SAVE_VERSION || f[0] < MIN_SIZE || f[0] > MAX_SIZE) {
+        set_err(err, err_cap, "Game image is corrupted or unsupported.");
+        return 0;
+    }
+
+    game_init(&temp);
+    if (!game_clear(&temp, (int)f[0])) {
+        set_err(err, err_cap, "Not enough memory for the board.");
+        return 0;
+    }
+    if (len < save_image_size(&temp)) goto bad_data;
+    temp.mode = (GameMode)f[1];
+    temp.current_player = (int)f[2];
+    temp.blocked_turns[0] = (int)f[3];
+    temp.blocked_turns[1] = (int)f[4];
+    temp.walls_left[0] = (int)f[5];
+    temp.walls_left[1] = (int)f[6];
+    temp.players[0].row = (int)f[7];
+    temp.players[0].col = (int)f[8];
+    temp.players[1].row = (int)f[9];
+    temp.players[1].col = (int)f[10];
+    in += 8 + sizeof(f);
+    memcpy(temp.player_name, in, sizeof(temp.player_name));
+    in += sizeof(temp.player_name);
+    for (i = 0; i < PLAYER_COUNT; i++) temp.player_name[i][NAME_SIZE - 1] = '\0';
+    if (!unpack_walls(&temp, DIR_H, in) || !unpack_walls(&temp, DIR_V, in + wall_bytes(temp.size))) goto bad_data;
+    if (!validate_loaded_game(&temp)) goto bad_data;
+
+    temp.rng = g->rng;
+    game_free(g);
+    *g = temp;
+    return 1;
+
+bad_data:
+    game_free(&temp);
+    set_err(err, err_cap, "Game image data is invalid.");
+    return 0;
+}
+
+/* Writes `path.tmp`, flushes it to disk and renames it over `path`, so a
+ * crash leaves either the old file or the new one, never half of it. */
+int save_write_file(const char *filename, const unsigned char *data, size_t len, char *err, size_t err_cap) {
+    char temp[SAVE_PATH_MAX + 8];
+
+    if (!filename || !filename[0] || strlen(filename) >= SAVE_PATH_MAX) {
+        set_err(err, err_cap, "Invalid save file name.");
+        return 0;
+    }
+    snprintf(temp, sizeof(temp), "%s.tmp", filename);
+
+#ifdef _WIN32
+    {
+        HANDLE h = CreateFileA(temp, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+        DWORD done = 0;
+        int ok;
+        if (h == INVALID_HANDLE_VALUE) {
+            set_err(err, err_cap, "Cannot open file for save.");
+            return 0;
+        }
+        ok = WriteFile(h, data, (DWORD)len, &done, NULL) && done == (DWORD)len && FlushFileBuffers(h);
+        CloseHandle(h);
+        if (!ok || !MoveFileExA(temp, filename, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+            DeleteFileA(temp);
+            set_err(err, err_cap, "Failed to write save file.");
+            return 0;
+        }
+    }
+#else
+    {
+        char dir[SAVE_PATH_MAX];
+        const char *slash = strrchr(filename, '/');
+        size_t off = 0;
+        int fd = open(temp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        int ok = 1;
+        if (fd < 0) {
+            set_err(err, err_cap, "Cannot open file for save.");
+            return 0;
+        }
+        while (ok && off < len) {
+            ssize_t n = write(fd, data + off, len - off);
+            if (n <= 0) ok = 0;
+            else off += (size_t)n;
+        }
+        if (ok && fsync(fd) != 0) ok = 0;
+        if (close(fd) != 0) ok = 0;
+        if (!ok || rename(temp, filename) != 0) {
+            unlink(temp);
+            set_err(err, err_cap, "Failed to write save file.");
+            return 0;
+        }
+
+        /* The rename itself is durable once the directory is flushed. */
+        if (slash) {
+            snprintf(dir, sizeof(dir), "%.*s", (int)(slash - filename + 1), filename);
+        } else {
+            snprintf(dir, sizeof(dir), ".");
+        }
+        fd = open(dir, O_RDONLY);
+        if (fd >= 0) {
+            fsync(fd);
+            close(fd);
+        }
+    }
+#endif
+    return 1;
+}
+
 int save_game(const char *filename, const Game *g, char *err, size_t err_cap) {
-    FILE *fp;
-    uint32_t version = 1;
-    const char header[4] = {'S', 'Q', 'D', 'R'};
+    unsigned char *image;
+    size_t len;
+    int ok;
 
     if (!filename || !filename[0] || !g) {
         set_err(err, err_cap, "Invalid save request.");
         return 0;
     }
 
-    fp = fopen(filename, "wb");
-    if (!fp) {
-        set_err(err, err_cap, "Cannot open file for save.");
+    len = save_image_size(g);
+    image = (unsigned char *)malloc(len);
+    if (!image) {
+        set_err(err, err_cap, "Not enough memory for save.");
         return 0;
     }
+    save_encode(g, image, len);
+    ok = save_write_file(filename, image, len, err, err_cap);
+    free(image);
+    return ok;
+}
 
-    if (fwrite(header, 1, 4, fp) != 4) goto fail;
-    if (!write_u32(fp, version)) goto fail;
-    if (!write_u32(fp, (uint32_t)g->size)) goto fail;
-    if (!write_u32(fp, (uint32_t)g->mode)) goto fail;
-    if (!write_u32(fp, (uint32_t)g->current_player)) goto fail;
-    if (!write_u32(fp, (uint32_t)g->blocked_turns[0])) goto fail;
-    if (!write_u32(fp, (uint32_t)g->blocked_turns[1])) goto fail;
-    if (!write_u32(fp, (uint32_t)g->walls_left[0])) goto fail;
-    if (!write_u32(fp, (uint32_t)g->walls_left[1])) goto fail;
-    if (!write_u32(fp, (uint32_t)g->players[0].row)) goto fail;
-    if (!write_u32(fp, (uint32_t)g->players[0].col)) goto fail;
-    if (!write_u32(fp, (uint32_t)g->players[1].row)) goto fail;
-    if (!write_u32(fp, (uint32_t)g->players[1].col)) goto fail;
-
-    if (fwrite(g->player_name, sizeof(g->player_name), 1, fp) != 1) goto fail;
-    if (fwrite(g->block_right, sizeof(g->block_right), 1, fp) != 1) goto fail;
-    if (fwrite(g->block_down, sizeof(g->block_down), 1, fp) != 1) goto fail;
-    if (fwrite(g->h_wall_at, sizeof(g->h_wall_at), 1, fp) != 1) goto fail;
-    if (fwrite(g->v_wall_at, sizeof(g->v_wall_at), 1, fp) != 1) goto fail;
+static int read_walls_v1(FILE *fp, Game *g) {
+    unsigned char grid[4][SAVE_V1_SIZE][SAVE_V1_SIZE];
+    int r;
+    int c;
 
-    fclose(fp);
+    if (g->size > SAVE_V1_SIZE) return 0;
+    if (fread(grid, sizeof(grid), 1, fp) != 1) return 0;
+
+    /* grid[0] and grid[1] are the blocked-edge arrays; they follow from the
+     * wall anchors in grid[2] (H) and grid[3] (V). */
+    for (r = 0; r < g->size - 1; r++) {
+        for (c = 0; c < g->size - 1; c++) {
+            if (grid[2][r][c] && !game_add_wall_from_map(g, r, c, DIR_H)) return 0;
+            if (grid[3][r][c] && !game_add_wall_from_map(g, r, c, DIR_V)) return 0;
+        }
+    }
     return 1;
+}
 
-fail:
-    fclose(fp);
-    set_err(err, err_cap, "Failed to write save file.");
-    return 0;
+static int read_walls_v2(FILE *fp, Game *g) {
+    size_t bytes = wall_bytes(g->size);
+    unsigned char *walls = (unsigned char *)malloc(bytes + 1);
+    int ok = 0;
+
+    if (!walls) return 0;
+    if (fread(walls, 1, bytes, fp) == bytes && unpack_walls(g, DIR_H, walls) &&
+        fread(walls, 1, bytes, fp) == bytes && unpack_walls(g, DIR_V, walls)) {
+        ok = 1;
+    }
+    free(walls);
+    return ok;
 }
 
 int load_game(const char *filename, Game *g, char *err, size_t err_cap) {
     FILE *fp;
     char header[4];
     uint32_t version;
-    uint32_t u;
+    uint32_t f[SAVE_FIELD_COUNT];
     Game temp;
+    int i;
 
     if (!filename || !filename[0] || !g) {
         set_err(err, err_cap, "Invalid load request.");
@@ -94,44 +310,55 @@ int load_game(const char *filename, Game *g, char *err, size_t err_cap) {
         return 0;
     }
 
+    game_init(&temp);
     if (fread(header, 1, 4, fp) != 4) goto bad_file;
     if (memcmp(header, "SQDR", 4) != 0) goto bad_file;
     if (!read_u32(fp, &version)) goto bad_file;
-    if (version != 1) goto bad_file;
-
-    memset(&temp, 0, sizeof(temp));
-    if (!read_u32(fp, &u)) goto bad_file; temp.size = (int)u;
-    if (!read_u32(fp, &u)) goto bad_file; temp.mode = (GameMode)u;
-    if (!read_u32(fp, &u)) goto bad_file; temp.current_player = (int)u;
-    if (!read_u32(fp, &u)) goto bad_file; temp.blocked_turns[0] = (int)u;
-    if (!read_u32(fp, &u)) goto bad_file; temp.blocked_turns[1] = (int)u;
-    if (!read_u32(fp, &u)) goto bad_file; temp.walls_left[0] = (int)u;
-    if (!read_u32(fp, &u)) goto bad_file; temp.walls_left[1] = (int)u;
-    if (!read_u32(fp, &u)) goto bad_file; temp.players[0].row = (int)u;
-    if (!read_u32(fp, &u)) goto bad_file; temp.players[0].col = (int)u;
-    if (!read_u32(fp, &u)) goto bad_file; temp.players[1].row = (int)u;
-    if (!read_u32(fp, &u)) goto bad_file; temp.players[1].col = (int)u;
+    if (version != 1 && version != SAVE_VERSION) goto bad_file;
+
+    for (i = 0; i < SAVE_FIELD_COUNT; i++) {
+        if (!read_u32(fp, &f[i])) goto bad_file;
+    }
+    if (f[0] < MIN_SIZE || f[0] > MAX_SIZE) goto bad_data;
+    if (!game_clear(&temp, (int)f[0])) goto bad_file;
+
+    temp.mode = (GameMode)f[1];
+    temp.current_player = (int)f[2];
+    temp.blocked_turns[0] = (int)f[3];
+    temp.blocked_turns[1] = (int)f[4];
+    temp.walls_left[0] = (int)f[5];
+    temp.walls_left[1] = (int)f[6];
+    temp.players[0].row = (int)f[7];
+    temp.players[0].col = (int)f[8];
+    temp.players[1].row = (int)f[9];
+    temp.players[1].col = (int)f[10];
 
     if (fread(temp.player_name, sizeof(temp.player_name), 1, fp) != 1) goto bad_file;
-    if (fread(temp.block_right, sizeof(temp.block_right), 1, fp) != 1) goto bad_file;
-    if (fread(temp.block_down, sizeof(temp.block_down), 1, fp) != 1) goto bad_file;
-    if (fread(temp.h_wall_at, sizeof(temp.h_wall_at), 1, fp) != 1) goto bad_file;
-    if (fread(temp.v_wall_at, sizeof(temp.v_wall_at), 1, fp) != 1) goto bad_file;
+    if (version == 1) {
+        if (!read_walls_v1(fp, &temp)) goto bad_file;
+    } else {
+        if (!read_walls_v2(fp, &temp)) goto bad_file;
+    }
 
     temp.player_name[0][NAME_SIZE - 1] = '\0';
     temp.player_name[1][NAME_SIZE - 1] = '\0';
 
-    if (!validate_loaded_game(&temp)) {
-        fclose(fp);
-        set_err(err, err_cap, "Save file data is invalid.");
-        return 0;
-    }
+    if (!validate_loaded_game(&temp)) goto bad_data;
 
+    temp.rng = g->rng;
+    game_free(g);
     *g = temp;
     fclose(fp);
     return 1;
 
+bad_data:
+    game_free(&temp);
+    fclose(fp);
+    set_err(err, err_cap, "Save file data is invalid.");
+    return 0;
+
 bad_file:
+    game_free(&temp);
     fclose(fp);
     set_err(err, err_cap, "Save file is corrupted or unsupported.");
     return 0;
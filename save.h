@@ -3,6 +3,12 @@
 
 #include "game.h"
 
+#define SAVE_PATH_MAX 260
+
+size_t save_image_size(const Game *g);
+int save_encode(const Game *g, unsigned char *out, size_t cap);
+int save_decode(Game *g, const unsigned char *in, size_t len, char *err, size_t err_cap);
+int save_write_file(const char *filename, const unsigned char *data, size_t len, char *err, size_t err_cap);
 int save_game(const char *filename, const Game *g, char *err, size_t err_cap);
 int load_game(const char *filename, Game *g, char *err, size_t err_cap);
 
@@ -0,0 +1,793 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#ifdef _MSC_VER
+#pragma comment(lib, "ws2_32.lib")
+#endif
+#endif
+
+#include "spectate.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "io.h"
+#include "save.h"
+
+#ifdef _WIN32
+typedef WSAPOLLFD PollFd;
+typedef WSABUF IoVec;
+#define BAD_SOCKET ((SpectateSocket)INVALID_SOCKET)
+#define poll_sockets(fds, count, ms) WSAPoll((fds), (ULONG)(count), (ms))
+#define close_socket(fd) closesocket((SOCKET)(fd))
+#else
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+typedef struct pollfd PollFd;
+typedef struct iovec IoVec;
+#define BAD_SOCKET (-1)
+#define poll_sockets(fds, count, ms) poll((fds), (nfds_t)(count), (ms))
+#define close_socket(fd) close(fd)
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+#endif
+
+#define SPECTATE_POLL_MS 10
+#define SPECTATE_SEND_BUFFER (64 * 1024)
+#define WALL_V_BIT 0x80000000u
+#define WALL_REMOVED_BIT 0x40000000u
+#define WALL_INDEX_MASK 0x3FFFFFFFu
+#define DIFF_WALLS_CLEARED 1u
+
+struct SpectateObserver {
+    SpectateSocket fd;
+    SpectateFrame *queue[SPECTATE_QUEUE];
+    int head;
+    int count;
+    size_t offset;
+    int waiting_key;
+    int resyncs;
+    int dead;
+};
+
+static void set_err(char *err, size_t cap, const char *msg) {
+    if (err && cap) {
+        snprintf(err, cap, "%s", msg);
+    }
+}
+
+static int net_startup(void) {
+#ifdef _WIN32
+    WSADATA data;
+    return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+#else
+    return 1;
+#endif
+}
+
+static void net_cleanup(void) {
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+static int set_nonblocking(SpectateSocket fd) {
+#ifdef _WIN32
+    u_long on = 1;
+    return ioctlsocket((SOCKET)fd, FIONBIO, &on) == 0;
+#else
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+static int would_block(void) {
+#ifdef _WIN32
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+}
+
+/* One vectored write of everything queued; returns bytes sent, 0 if the
+ * socket is full, -1 on error. */
+static long send_vector(SpectateSocket fd, IoVec *vec, int count) {
+#ifdef _WIN32
+    DWORD sent = 0;
+    if (WSASend((SOCKET)fd, vec, (DWORD)count, &sent, 0, NULL, NULL) != 0) return would_block() ? 0 : -1;
+    return (long)sent;
+#else
+    struct msghdr msg;
+    ssize_t sent;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = vec;
+    msg.msg_iovlen = (size_t)count;
+    sent = sendmsg(fd, &msg, MSG_NOSIGNAL);
+    if (sent < 0) return would_block() ? 0 : -1;
+    return (long)sent;
+#endif
+}
+
+static void set_vec(IoVec *v, const unsigned char *data, size_t len) {
+#ifdef _WIN32
+    v->buf = (CHAR *)data;
+    v->len = (ULONG)len;
+#else
+    v->iov_base = (void *)data;
+    v->iov_len = len;
+#endif
+}
+
+static unsigned char *put_u32(unsigned char *out, uint32_t value) {
+    memcpy(out, &value, sizeof(value));
+    return out + sizeof(value);
+}
+
+static uint32_t get_u32(const unsigned char *in) {
+    uint32_t value;
+    memcpy(&value, in, sizeof(value));
+    return value;
+}
+
+static SpectateFrame *frame_new(uint32_t seq, int kind, size_t payload) {
+    size_t len = SPECTATE_HEADER_BYTES + payload;
+    SpectateFrame *f = (SpectateFrame *)malloc(sizeof(SpectateFrame) + len);
+    unsigned char *p;
+    if (!f) return NULL;
+    f->refs = 1;
+    f->seq = seq;
+    f->kind = kind;
+    f->len = len;
+    f->data = (unsigned char *)(f + 1);
+    p = put_u32(f->data, (uint32_t)len);
+    p = put_u32(p, seq);
+    put_u32(p, (uint32_t)kind);
+    return f;
+}
+
+static void frame_ref(SpectateFrame *f) {
+    thread_atomic_add(&f->refs, 1);
+}
+
+static void frame_unref(SpectateFrame *f) {
+    if (f && thread_atomic_add(&f->refs, -1) == 0) free(f);
+}
+
+static size_t bit_count(uint64_t x) {
+    size_t n = 0;
+    while (x) {
+        x &= x - 1;
+        n++;
+    }
+    return n;
+}
+
+/* ---- game thread ---- */
+
+static int reset_prev(Spectate *s, int size) {
+    size_t words = ((size_t)size * (size_t)size + 63) / 64;
+    int d;
+    for (d = 0; d < 2; d++) {
+        free(s->prev_walls[d]);
+        s->prev_walls[d] = (uint64_t *)calloc(words, sizeof(uint64_t));
+        if (!s->prev_walls[d]) {
+            s->size = 0;
+            return 0;
+        }
+    }
+    s->size = size;
+    s->words = words;
+    return 1;
+}
+
+static unsigned char *put_changes(Spectate *s, const Game *g, unsigned char *p, int removed) {
+    int d;
+    size_t w;
+    for (d = 0; d < 2; d++) {
+        const uint64_t *now = d == 0 ? g->h_wall_at : g->v_wall_at;
+        for (w = 0; w < s->words; w++) {
+            uint64_t bits = removed ? s->prev_walls[d][w] & ~now[w] : now[w] & ~s->prev_walls[d][w];
+            while (bits) {
+                uint64_t low = bits & (~bits + 1);
+                int b = 0;
+                while (low >>= 1) b++;
+                bits &= bits - 1;
+                p = put_u32(p, (uint32_t)(w * 64 + (size_t)b) | (d ? WALL_V_BIT : 0) | (removed ? WALL_REMOVED_BIT : 0));
+            }
+        }
+    }
+    return p;
+}
+
+/* Removals are listed before additions so a viewer never sees two walls
+ * overlap. When most walls vanished at once (magic), the frame says
+ * "clear all" and lists what is left instead. */
+static SpectateFrame *encode_diff(Spectate *s, const Game *g, const char *note) {
+    size_t removed = 0;
+    size_t added = 0;
+    size_t standing = 0;
+    size_t note_len = note ? strlen(note) : 0;
+    size_t changes;
+    uint32_t flags = 0;
+    SpectateFrame *f;
+    unsigned char *p;
+    size_t w;
+    int d;
+    int i;
+
+    for (d = 0; d < 2; d++) {
+        const uint64_t *now = d == 0 ? g->h_wall_at : g->v_wall_at;
+        for (w = 0; w < s->words; w++) {
+            uint64_t before = s->prev_walls[d][w];
+            standing += bit_count(now[w]);
+            if (before == now[w]) continue;
+            removed += bit_count(before & ~now[w]);
+            added += bit_count(now[w] & ~before);
+        }
+    }
+    if (removed > standing) flags |= DIFF_WALLS_CLEARED;
+    changes = flags ? standing : removed + added;
+    if (note_len >= SPECTATE_NOTE_MAX) note_len = SPECTATE_NOTE_MAX - 1;
+
+    f = frame_new(s->seq, SPECTATE_DIFF, 4 * (3 + 4 * PLAYER_COUNT + 2) + note_len + 4 * changes);
+    if (!f) return NULL;
+    p = f->data + SPECTATE_HEADER_BYTES;
+    p = put_u32(p, (uint32_t)g->current_player);
+    p = put_u32(p, (uint32_t)(game_check_winner(g) + 1));
+    for (i = 0; i < PLAYER_COUNT; i++) {
+        p = put_u32(p, (uint32_t)g->players[i].row);
+        p = put_u32(p, (uint32_t)g->players[i].col);
+        p = put_u32(p, (uint32_t)g->walls_left[i]);
+        p = put_u32(p, (uint32_t)g->blocked_turns[i]);
+    }
+    p = put_u32(p, flags);
+    p = put_u32(p, (uint32_t)note_len);
+    if (note_len) memcpy(p, note, note_len);
+    p += note_len;
+    p = put_u32(p, (uint32_t)changes);
+    if (flags) {
+        memset(s->prev_walls[0], 0, s->words * sizeof(uint64_t));
+        memset(s->prev_walls[1], 0, s->words * sizeof(uint64_t));
+    } else {
+        p = put_changes(s, g, p, 1);
+    }
+    put_changes(s, g, p, 0);
+    memcpy(s->prev_walls[0], g->h_wall_at, s->words * sizeof(uint64_t));
+    memcpy(s->prev_walls[1], g->v_wall_at, s->words * sizeof(uint64_t));
+    return f;
+}
+
+static SpectateFrame *encode_key(Spectate *s, const Game *g) {
+    size_t len = save_image_size(g);
+    SpectateFrame *f = frame_new(s->seq, SPECTATE_KEY, len);
+    if (!f) return NULL;
+    save_encode(g, f->data + SPECTATE_HEADER_BYTES, len);
+    return f;
+}
+
+static void publish(Spectate *s, SpectateFrame *f) {
+    if (!f) {
+        thread_atomic_store(&s->need_key, 1);
+        return;
+    }
+    s->frames++;
+    s->encoded_bytes += (long long)f->len;
+    thread_mutex_lock(&s->lock);
+    if (s->inbox_count < SPECTATE_INBOX) {
+        s->inbox[s->inbox_count++] = f;
+        f = NULL;
+    } else {
+        s->lost = 1;
+    }
+    thread_mutex_unlock(&s->lock);
+    if (f) {
+        frame_unref(f);
+        thread_atomic_store(&s->need_key, 1);
+    }
+}
+
+/* Called on the game thread after each state change. Encodes the frame
+ * once; sending is left to the broadcaster thread. */
+void spectate_turn(Spectate *s, const Game *g, const char *note) {
+    int fresh = 0;
+
+    if (!s || !s->running || !g) return;
+    if (g->size != s->size) {
+        if (!reset_prev(s, g->size)) return;
+        fresh = 1;
+    }
+    s->seq++;
+    if (!fresh) publish(s, encode_diff(s, g, note));
+    if (fresh || thread_atomic_load(&s->need_key)) {
+        thread_atomic_store(&s->need_key, 0);
+        publish(s, encode_key(s, g));
+        memcpy(s->prev_walls[0], g->h_wall_at, s->words * sizeof(uint64_t));
+        memcpy(s->prev_walls[1], g->v_wall_at, s->words * sizeof(uint64_t));
+    }
+}
+
+static int apply_diff(Game *g, const unsigned char *p, size_t len, char *note, int *winner) {
+    const unsigned char *end = p + len;
+    uint32_t flags;
+    uint32_t note_len;
+    uint32_t changes;
+    uint32_t k;
+    int i;
+
+    if (len < 4 * (2 + 4 * PLAYER_COUNT + 2)) return 0;
+    g->current_player = (int)get_u32(p) % PLAYER_COUNT;
+    *winner = (int)get_u32(p + 4) - 1;
+    p += 8;
+    for (i = 0; i < PLAYER_COUNT; i++, p += 16) {
+        g->players[i].row = (int)get_u32(p);
+        g->players[i].col = (int)get_u32(p + 4);
+    }
+    flags = get_u32(p);
+    note_len = get_u32(p + 4);
+    p += 8;
+    if (note_len >= SPECTATE_NOTE_MAX || (size_t)(end - p) < note_len + 4) return 0;
+    memcpy(note, p, note_len);
+    note[note_len] = '\0';
+    p += note_len;
+    changes = get_u32(p);
+    p += 4;
+    if ((size_t)(end - p) / 4 < changes) return 0;
+
+    if (flags & DIFF_WALLS_CLEARED) {
+        int r;
+        int c;
+        for (r = 0; r < g->size - 1; r++) {
+            for (c = 0; c < g->size - 1; c++) {
+                if (game_wall_at(g, r, c, DIR_H)) game_remove_wall(g, 0, r, c, DIR_H);
+                if (game_wall_at(g, r, c, DIR_V)) game_remove_wall(g, 0, r, c, DIR_V);
+            }
+        }
+    }
+    for (k = 0; k < changes; k++, p += 4) {
+        uint32_t e = get_u32(p);
+        int at = (int)(e & WALL_INDEX_MASK);
+        WallDir dir = (e & WALL_V_BIT) ? DIR_V : DIR_H;
+        int ok;
+        if (e & WALL_REMOVED_BIT) ok = game_remove_wall(g, 0, at / g->size, at % g->size, dir);
+        else ok = game_add_wall_from_map(g, at / g->size, at % g->size, dir);
+        if (!ok) return 0;
+    }
+
+    /* Counters last: removing a wall above hands one back to a player. */
+    p = end - len + 8;
+    for (i = 0; i < PLAYER_COUNT; i++, p += 16) {
+        g->walls_left[i] = (int)get_u32(p + 8);
+        g->blocked_turns[i] = (int)get_u32(p + 12);
+    }
+    return 1;
+}
+
+/* ---- broadcaster thread ---- */
+
+static void observer_push(SpectateObserver *o, SpectateFrame *f) {
+    frame_ref(f);
+    o->queue[(o->head + o->count) % SPECTATE_QUEUE] = f;
+    o->count++;
+}
+
+/* Drops everything queued except a frame already partly on the wire,
+ * which has to finish so the stream stays framed. */
+static void observer_trim(SpectateObserver *o) {
+    int keep = o->offset > 0 ? 1 : 0;
+    while (o->count > keep) {
+        o->count--;
+        frame_unref(o->queue[(o->head + o->count) % SPECTATE_QUEUE]);
+    }
+}
+
+static void observer_resync(Spectate *s, SpectateObserver *o) {
+    observer_trim(o);
+    o->waiting_key = 1;
+    o->resyncs++;
+    s->resynced++;
+    if (o->resyncs > SPECTATE_MAX_RESYNCS) o->dead = 1;
+}
+
+static void offer(Spectate *s, SpectateObserver *o, SpectateFrame *f) {
+    if (o->dead) return;
+    if (f->kind == SPECTATE_KEY) {
+        if (!o->waiting_key) return;
+        observer_trim(o);
+        observer_push(o, f);
+        o->waiting_key = 0;
+        return;
+    }
+    if (o->waiting_key) return;
+    if (o->count == SPECTATE_QUEUE) {
+        observer_resync(s, o);
+        return;
+    }
+    observer_push(o, f);
+}
+
+static void observer_flush(Spectate *s, SpectateObserver *o) {
+    IoVec vec[SPECTATE_QUEUE];
+    long sent;
+    int i;
+
+    if (o->dead || o->count == 0) return;
+    for (i = 0; i < o->count; i++) {
+        SpectateFrame *f = o->queue[(o->head + i) % SPECTATE_QUEUE];
+        size_t skip = i == 0 ? o->offset : 0;
+        set_vec(&vec[i], f->data + skip, f->len - skip);
+    }
+    sent = send_vector(o->fd, vec, o->count);
+    if (sent < 0) {
+        o->dead = 1;
+        return;
+    }
+    s->sent_bytes += sent;
+    while (sent > 0) {
+        SpectateFrame *f = o->queue[o->head];
+        size_t left = f->len - o->offset;
+        if ((size_t)sent < left) {
+            o->offset += (size_t)sent;
+            break;
+        }
+        sent -= (long)left;
+        frame_unref(f);
+        o->head = (o->head + 1) % SPECTATE_QUEUE;
+        o->count--;
+        o->offset = 0;
+    }
+}
+
+static void observer_close(SpectateObserver *o) {
+    o->offset = 0;
+    observer_trim(o);
+    close_socket(o->fd);
+}
+
+/* The kernel send buffer is kept small so a stalled viewer shows up as a
+ * full queue here, where it can be resynced, instead of as megabytes of
+ * stale frames sitting in the socket. */
+static void accept_observers(Spectate *s) {
+    int buffer = SPECTATE_SEND_BUFFER;
+    for (;;) {
+        SpectateSocket fd = (SpectateSocket)accept(s->listener, NULL, NULL);
+        SpectateObserver *o;
+        if (fd == BAD_SOCKET) return;
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, (const char *)&buffer, (int)sizeof(buffer));
+        if (s->observer_count >= SPECTATE_MAX_OBSERVERS || !set_nonblocking(fd)) {
+            close_socket(fd);
+            continue;
+        }
+        o = &s->observers[s->observer_count++];
+        memset(o, 0, sizeof(*o));
+        o->fd = fd;
+        o->waiting_key = 1;
+        s->joined++;
+    }
+}
+
+static void remove_dead(Spectate *s) {
+    int i = 0;
+    while (i < s->observer_count) {
+        if (!s->observers[i].dead) {
+            i++;
+            continue;
+        }
+        observer_close(&s->observers[i]);
+        s->dropped++;
+        s->observers[i] = s->observers[--s->observer_count];
+    }
+}
+
+static void track_frame(Spectate *s, SpectateFrame *f) {
+    const unsigned char *payload = f->data + SPECTATE_HEADER_BYTES;
+    size_t len = f->len - SPECTATE_HEADER_BYTES;
+    char note[SPECTATE_NOTE_MAX];
+    int winner;
+
+    if (f->kind == SPECTATE_KEY) {
+        s->mirror_ok = save_decode(&s->mirror, payload, len, NULL, 0);
+        frame_unref(s->keyframe);
+        frame_ref(f);
+        s->keyframe = f;
+    } else if (s->mirror_ok && !apply_diff(&s->mirror, payload, len, note, &winner)) {
+        s->mirror_ok = 0;
+        thread_atomic_store(&s->need_key, 1);
+    }
+    s->last_seq = f->seq;
+}
+
+/* One keyframe of the current state, shared by everyone waiting for one. */
+static void serve_waiting(Spectate *s) {
+    SpectateFrame *f;
+    size_t len;
+    int waiting = 0;
+    int i;
+
+    for (i = 0; i < s->observer_count; i++) waiting |= s->observers[i].waiting_key;
+    if (!waiting || !s->mirror_ok) return;
+    if (!s->keyframe || s->keyframe->seq != s->last_seq) {
+        len = save_image_size(&s->mirror);
+        f = frame_new(s->last_seq, SPECTATE_KEY, len);
+        if (!f) return;
+        save_encode(&s->mirror, f->data + SPECTATE_HEADER_BYTES, len);
+        frame_unref(s->keyframe);
+        s->keyframe = f;
+    }
+    for (i = 0; i < s->observer_count; i++) offer(s, &s->observers[i], s->keyframe);
+}
+
+static void fan_out(Spectate *s) {
+    SpectateFrame *frames[SPECTATE_INBOX];
+    int count;
+    int lost;
+    int i;
+    int k;
+
+    thread_mutex_lock(&s->lock);
+    count = s->inbox_count;
+    memcpy(frames, s->inbox, (size_t)count * sizeof(frames[0]));
+    s->inbox_count = 0;
+    lost = s->lost;
+    s->lost = 0;
+    thread_mutex_unlock(&s->lock);
+
+    for (k = 0; k < count; k++) {
+        SpectateFrame *f = frames[k];
+        track_frame(s, f);
+        for (i = 0; i < s->observer_count; i++) offer(s, &s->observers[i], f);
+        frame_unref(f);
+    }
+    if (lost) {
+        /* Frames went missing: nobody can follow diffs until the game
+         * thread sends a fresh keyframe. */
+        s->mirror_ok = 0;
+        for (i = 0; i < s->observer_count; i++) {
+            observer_trim(&s->observers[i]);
+            s->observers[i].waiting_key = 1;
+        }
+    }
+    serve_waiting(s);
+    for (i = 0; i < s->observer_count; i++) observer_flush(s, &s->observers[i]);
+}
+
+static void spectate_run(void *arg) {
+    Spectate *s = (Spectate *)arg;
+    PollFd *fds = (PollFd *)calloc(SPECTATE_MAX_OBSERVERS + 1, sizeof(PollFd));
+    char sink[256];
+    int i;
+
+    while (fds && !thread_atomic_load(&s->quit)) {
+        fan_out(s);
+        remove_dead(s);
+
+        fds[0].fd = s->listener;
+        fds[0].events = POLLIN;
+        fds[0].revents = 0;
+        for (i = 0; i < s->observer_count; i++) {
+            fds[i + 1].fd = s->observers[i].fd;
+            fds[i + 1].events = (short)(POLLIN | (s->observers[i].count > 0 ? POLLOUT : 0));
+            fds[i + 1].revents = 0;
+        }
+        if (poll_sockets(fds, s->observer_count + 1, SPECTATE_POLL_MS) <= 0) continue;
+
+        for (i = 0; i < s->observer_count; i++) {
+            SpectateObserver *o = &s->observers[i];
+            short ev = fds[i + 1].revents;
+            if (ev & (POLLERR | POLLHUP | POLLNVAL)) {
+                o->dead = 1;
+                continue;
+            }
+            if (ev & POLLIN) {
+                long got = (long)recv(o->fd, sink, sizeof(sink), 0);
+                if (got == 0 || (got < 0 && !would_block())) o->dead = 1;
+            }
+            if (ev & POLLOUT) observer_flush(s, o);
+        }
+        if (fds[0].revents & POLLIN) accept_observers(s);
+    }
+
+    fan_out(s);
+    for (i = 0; i < s->observer_count; i++) observer_close(&s->observers[i]);
+    s->observer_count = 0;
+    free(fds);
+}
+
+void spectate_init(Spectate *s) {
+    if (!s) return;
+    memset(s, 0, sizeof(*s));
+    s->listener = BAD_SOCKET;
+    game_init(&s->mirror);
+}
+
+/* Listens on the loopback interface only. */
+int spectate_start(Spectate *s, int port, char *err, size_t err_cap) {
+    struct sockaddr_in addr;
+    int yes = 1;
+
+    if (!s || port < 1 || port > 65535) {
+        set_err(err, err_cap, "Invalid spectator port.");
+        return 0;
+    }
+    if (!net_startup()) {
+        set_err(err, err_cap, "Cannot start networking.");
+        return 0;
+    }
+    s->observers = (SpectateObserver *)calloc(SPECTATE_MAX_OBSERVERS, sizeof(SpectateObserver));
+    s->listener = (SpectateSocket)socket(AF_INET, SOCK_STREAM, 0);
+    if (!s->observers || s->listener == BAD_SOCKET) {
+        set_err(err, err_cap, "Cannot open the spectator socket.");
+        spectate_stop(s);
+        return 0;
+    }
+    setsockopt(s->listener, SOL_SOCKET, SO_REUSEADDR, (const char *)&yes, (int)sizeof(yes));
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((unsigned short)port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(s->listener, (struct sockaddr *)&addr, (int)sizeof(addr)) != 0 || listen(s->listener, 16) != 0 ||
+        !set_nonblocking(s->listener)) {
+        set_err(err, err_cap, "Cannot listen on the spectator port.");
+        spectate_stop(s);
+        return 0;
+    }
+
+    s->port = port;
+    s->need_key = 1;
+    thread_mutex_init(&s->lock);
+    if (!thread_start(&s->thread, spectate_run, s)) {
+        thread_mutex_destroy(&s->lock);
+        set_err(err, err_cap, "Cannot start the spectator thread.");
+        spectate_stop(s);
+        return 0;
+    }
+    s->running = 1;
+    return 1;
+}
+
+void spectate_stop(Spectate *s) {
+    int started;
+    if (!s) return;
+    started = s->observers != NULL || s->listener != BAD_SOCKET;
+    if (s->running) {
+        thread_atomic_store(&s->quit, 1);
+        thread_join(&s->thread);
+        thread_mutex_destroy(&s->lock);
+        s->running = 0;
+        printf("Spectators: %ld joined, %ld dropped, %ld resync(s); %ld frames, %.1f KB encoded, %.1f KB sent.\n",
+               s->joined, s->dropped, s->resynced, s->frames, (double)s->encoded_bytes / 1024.0,
+               (double)s->sent_bytes / 1024.0);
+    }
+    while (s->inbox_count > 0) frame_unref(s->inbox[--s->inbox_count]);
+    frame_unref(s->keyframe);
+    s->keyframe = NULL;
+    if (s->listener != BAD_SOCKET) close_socket(s->listener);
+    s->listener = BAD_SOCKET;
+    free(s->observers);
+    s->observers = NULL;
+    game_free(&s->mirror);
+    s->mirror_ok = 0;
+    free(s->prev_walls[0]);
+    free(s->prev_walls[1]);
+    s->prev_walls[0] = NULL;
+    s->prev_walls[1] = NULL;
+    s->size = 0;
+    if (started) net_cleanup();
+}
+
+/* ---- viewer ---- */
+
+static int read_full(SpectateSocket fd, unsigned char *buf, size_t len) {
+    while (len > 0) {
+        long got = (long)recv(fd, (char *)buf, (int)(len > 65536 ? 65536 : len), 0);
+        if (got <= 0) return 0;
+        buf += got;
+        len -= (size_t)got;
+    }
+    return 1;
+}
+
+/* Connects to a running game and redraws the board from each frame. */
+int spectate_watch(const char *host, int port, char *err, size_t err_cap) {
+    struct sockaddr_in addr;
+    SpectateSocket fd;
+    Game g;
+    unsigned char head[SPECTATE_HEADER_BYTES];
+    unsigned char *buf = NULL;
+    size_t cap = 0;
+    int have_state = 0;
+    int ok = 1;
+
+    if (!net_startup()) {
+        set_err(err, err_cap, "Cannot start networking.");
+        return 0;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((unsigned short)port);
+    if (port < 1 || port > 65535 || inet_pton(AF_INET, host ? host : "127.0.0.1", &addr.sin_addr) != 1) {
+        set_err(err, err_cap, "Invalid spectator address.");
+        net_cleanup();
+        return 0;
+    }
+    fd = (SpectateSocket)socket(AF_INET, SOCK_STREAM, 0);
+    if (fd == BAD_SOCKET || connect(fd, (struct sockaddr *)&addr, (int)sizeof(addr)) != 0) {
+        if (fd != BAD_SOCKET) close_socket(fd);
+        set_err(err, err_cap, "Cannot connect to the game.");
+        net_cleanup();
+        return 0;
+    }
+
+    game_init(&g);
+    printf("Watching 127.0.0.1:%d\n", port);
+    while (read_full(fd, head, sizeof(head))) {
+        uint32_t len = get_u32(head);
+        uint32_t seq = get_u32(head + 4);
+        uint32_t kind = get_u32(head + 8);
+        size_t payload;
+        char note[SPECTATE_NOTE_MAX];
+        int winner = -1;
+
+        if (len < SPECTATE_HEADER_BYTES) {
+            ok = 0;
+            break;
+        }
+        payload = len - SPECTATE_HEADER_BYTES;
+        if (payload > cap) {
+            unsigned char *grown = (unsigned char *)realloc(buf, payload);
+            if (!grown) {
+                ok = 0;
+                break;
+            }
+            buf = grown;
+            cap = payload;
+        }
+        if (!read_full(fd, buf, payload)) break;
+
+        note[0] = '\0';
+        if (kind == SPECTATE_KEY) {
+            if (!save_decode(&g, buf, payload, err, err_cap)) {
+                ok = 0;
+                break;
+            }
+            have_state = 1;
+            winner = game_check_winner(&g);
+        } else if (kind == SPECTATE_DIFF && have_state) {
+            if (!apply_diff(&g, buf, payload, note, &winner)) {
+                set_err(err, err_cap, "Lost track of the game.");
+                ok = 0;
+                break;
+            }
+        } else {
+            continue;
+        }
+
+        printf("\n[frame %u]\n", seq);
+        io_print_board(&g);
+        io_print_status(&g);
+        if (note[0]) printf("%s\n", note);
+        if (winner >= 0) printf("Winner: %s\n", g.player_name[winner]);
+        fflush(stdout);
+    }
+    if (ok && err && err_cap) snprintf(err, err_cap, "Game closed the feed.");
+
+    free(buf);
+    game_free(&g);
+    close_socket(fd);
+    net_cleanup();
+    return ok;
+}
@@ -0,0 +1,89 @@
+#ifndef SIMPLE_SPECTATE_H
+#define SIMPLE_SPECTATE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "game.h"
+#include "thread.h"
+
+#define SPECTATE_DEFAULT_PORT 7531
+#define SPECTATE_MAX_OBSERVERS 256
+#define SPECTATE_QUEUE 64
+#define SPECTATE_INBOX 64
+#define SPECTATE_MAX_RESYNCS 3
+#define SPECTATE_HEADER_BYTES 12
+#define SPECTATE_NOTE_MAX 160
+
+/* Frame on the wire: u32 total length, u32 sequence, u32 kind, payload.
+ * A keyframe carries a save image (save_encode). A diff carries the side
+ * to move, the winner, both pawns and counters, a note (magic or AI
+ * message) and the wall anchors that changed since the last frame. */
+typedef enum {
+    SPECTATE_KEY = 1,
+    SPECTATE_DIFF = 2
+} SpectateKind;
+
+/* Encoded once on the game thread, then shared read-only by every
+ * observer queue that holds it; freed when the last reference drops. */
+typedef struct {
+    volatile long refs;
+    uint32_t seq;
+    int kind;
+    size_t len;
+    unsigned char *data;
+} SpectateFrame;
+
+#ifdef _WIN32
+typedef uintptr_t SpectateSocket;
+#else
+typedef int SpectateSocket;
+#endif
+
+typedef struct SpectateObserver SpectateObserver;
+
+typedef struct {
+    SpectateSocket listener;
+    int port;
+
+    /* Game thread: what the observers were last told. */
+    int size;
+    size_t words;
+    uint64_t *prev_walls[2];
+    uint32_t seq;
+
+    /* Hand-off to the broadcaster thread. */
+    ThreadMutex lock;
+    SpectateFrame *inbox[SPECTATE_INBOX];
+    int inbox_count;
+    int lost;
+    volatile long need_key;
+
+    /* Broadcaster thread. The mirror is rebuilt from the frames, so new or
+     * resynced observers get a keyframe without asking the game thread. */
+    SpectateObserver *observers;
+    int observer_count;
+    Game mirror;
+    int mirror_ok;
+    SpectateFrame *keyframe;
+    uint32_t last_seq;
+    Thread thread;
+    volatile long quit;
+    int running;
+
+    long frames;
+    long long encoded_bytes;
+    long long sent_bytes;
+    long joined;
+    long resynced;
+    long dropped;
+} Spectate;
+
+void spectate_init(Spectate *s);
+int spectate_start(Spectate *s, int port, char *err, size_t err_cap);
+void spectate_turn(Spectate *s, const Game *g, const char *note);
+void spectate_stop(Spectate *s);
+
+int spectate_watch(const char *host, int port, char *err, size_t err_cap);
+
+#endif
@@ -0,0 +1,334 @@
+#include "suite.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "notation.h"
+#include "thread.h"
+
+static void set_err(char *err, size_t cap, const char *msg) {
+    if (err && cap) {
+        snprintf(err, cap, "%s", msg);
+    }
+}
+
+void suite_default_config(SuiteConfig *cfg) {
+    if (!cfg) return;
+    memset(cfg, 0, sizeof(*cfg));
+    ai_default_config(&cfg->ai);
+    cfg->ai.depth = 8;
+    cfg->ai.node_limit = 200000;
+    cfg->ai.time_limit_ms = 0;
+    cfg->ai.table_bits = 18;
+    cfg->threads = thread_cpu_count();
+}
+
+static char *read_text(const char *path) {
+    FILE *fp = fopen(path, "rb");
+    char *text;
+    long len;
+
+    if (!fp) return NULL;
+    if (fseek(fp, 0, SEEK_END) != 0 || (len = ftell(fp)) < 0 || fseek(fp, 0, SEEK_SET) != 0) {
+        fclose(fp);
+        return NULL;
+    }
+    text = (char *)malloc((size_t)len + 1);
+    if (text && fread(text, 1, (size_t)len, fp) != (size_t)len) {
+        free(text);
+        text = NULL;
+    }
+    fclose(fp);
+    if (text) text[len] = '\0';
+    return text;
+}
+
+static char *trim(char *p) {
+    char *end;
+    while (*p == ' ' || *p == '\t') p++;
+    end = p + strlen(p);
+    while (end > p && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r')) *--end = '\0';
+    return p;
+}
+
+/* Splits one line in place: the position stays at the front and each
+ * operation after a semicolon is read into e. */
+static int parse_entry(char *line, SuiteEntry *e, char *msg, size_t cap) {
+    char *op = strchr(line, ';');
+    int has_expect = 0;
+
+    e->position = line;
+    while (op) {
+        char *next = strchr(op + 1, ';');
+        char *word;
+        *op = '\0';
+        if (next) *next = '\0';
+        word = trim(op + 1);
+        if (strncmp(word, "bm ", 3) == 0) {
+            const char *p = word + 3;
+            while (*p) {
+                if (e->best_count >= SUITE_MAX_BEST) {
+                    snprintf(msg, cap, "too many best moves");
+                    return 0;
+                }
+                p = notation_parse_action(p, &e->best[e->best_count]);
+                if (!p) {
+                    snprintf(msg, cap, "bad best move");
+                    return 0;
+                }
+                e->best_count++;
+                while (*p == ' ' || *p == '\t') p++;
+            }
+            e->expect = SUITE_BEST_MOVE;
+            has_expect = e->best_count > 0;
+        } else if (strcmp(word, "win") == 0 || strcmp(word, "loss") == 0) {
+            e->expect = word[0] == 'w' ? SUITE_WIN : SUITE_LOSS;
+            has_expect = 1;
+        } else if (strncmp(word, "id ", 3) == 0) {
+            snprintf(e->id, sizeof(e->id), "%s", trim(word + 3));
+        } else if (word[0] != '\0') {
+            snprintf(msg, cap, "unknown operation \"%s\"", word);
+            return 0;
+        }
+        if (next) *next = ';';
+        op = next;
+    }
+    e->position = trim(line);
+    if (!has_expect) {
+        snprintf(msg, cap, "no bm, win or loss");
+        return 0;
+    }
+    return 1;
+}
+
+int suite_load(Suite *s, const char *path, char *err, size_t err_cap) {
+    Game g;
+    char *p;
+    int cap = 0;
+    int line_no = 0;
+
+    if (!s || !path) return 0;
+    memset(s, 0, sizeof(*s));
+    s->text = read_text(path);
+    if (!s->text) {
+        set_err(err, err_cap, "Cannot read the suite file.");
+        return 0;
+    }
+
+    game_init(&g);
+    p = s->text;
+    while (*p) {
+        char *line = p;
+        char *nl = strchr(p, '\n');
+        char msg[96];
+        SuiteEntry *e;
+
+        if (nl) {
+            *nl = '\0';
+            p = nl + 1;
+        } else {
+            p += strlen(p);
+        }
+        line_no++;
+        line = trim(line);
+        if (line[0] == '\0' || line[0] == '#') continue;
+
+        if (s->count == cap) {
+            int grown = cap ? cap * 2 : 64;
+            SuiteEntry *list = (SuiteEntry *)realloc(s->entries, (size_t)grown * sizeof(SuiteEntry));
+            if (!list) {
+                set_err(err, err_cap, "Not enough memory for the suite.");
+                game_free(&g);
+                suite_free(s);
+                return 0;
+            }
+            s->entries = list;
+            cap = grown;
+        }
+        e = &s->entries[s->count];
+        memset(e, 0, sizeof(*e));
+        e->line = line_no;
+        if (!parse_entry(line, e, msg, sizeof(msg)) ||
+            !notation_parse(&g, e->position, NULL, msg, sizeof(msg))) {
+            if (err && err_cap) snprintf(err, err_cap, "%s:%d: %s", path, line_no, msg);
+            game_free(&g);
+            suite_free(s);
+            return 0;
+        }
+        if (e->id[0] == '\0') snprintf(e->id, sizeof(e->id), "line %d", line_no);
+        s->count++;
+    }
+    game_free(&g);
+    if (s->count == 0) {
+        set_err(err, err_cap, "The suite has no positions.");
+        suite_free(s);
+        return 0;
+    }
+    return 1;
+}
+
+void suite_free(Suite *s) {
+    if (!s) return;
+    free(s->text);
+    free(s->entries);
+    memset(s, 0, sizeof(*s));
+}
+
+static int same_action(const AiAction *a, const AiAction *b) {
+    if (a->type != b->type) return 0;
+    if (a->type == AI_ACT_MOVE) return a->target.row == b->target.row && a->target.col == b->target.col;
+    return a->row == b->row && a->col == b->col && a->dir == b->dir;
+}
+
+static int meets(const SuiteEntry *e, const AiAction *best, int score) {
+    int i;
+    if (e->expect == SUITE_WIN) return score > AI_WIN_BOUND;
+    if (e->expect == SUITE_LOSS) return score < -AI_WIN_BOUND;
+    for (i = 0; i < e->best_count; i++) {
+        if (same_action(best, &e->best[i])) return 1;
+    }
+    return 0;
+}
+
+/* Time to solution: when the search last switched to an answer that it
+ * then kept through every later iteration. */
+typedef struct {
+    SuiteEntry *entry;
+    double start;
+} SuiteWatch;
+
+static void on_depth(void *ctx, int depth, const AiAction *best, int score) {
+    SuiteWatch *w = (SuiteWatch *)ctx;
+    SuiteEntry *e = w->entry;
+    e->depth = depth;
+    e->answer = *best;
+    e->score = score;
+    if (!meets(e, best, score)) {
+        e->solve_ms = -1.0;
+    } else if (e->solve_ms < 0.0) {
+        e->solve_ms = thread_now_ms() - w->start;
+    }
+}
+
+typedef struct {
+    const SuiteConfig *cfg;
+    Suite *suite;
+    volatile long next;
+    volatile long failed;
+} SuiteShared;
+
+static void suite_worker_main(void *arg) {
+    SuiteShared *sh = (SuiteShared *)arg;
+    SuiteWatch watch;
+    Game g;
+    Ai ai;
+
+    game_init(&g);
+    if (!ai_init(&ai, &sh->cfg->ai)) {
+        ai_free(&ai);
+        thread_atomic_store(&sh->failed, 1);
+        return;
+    }
+    ai.on_depth = on_depth;
+    ai.on_depth_ctx = &watch;
+
+    for (;;) {
+        long idx = thread_atomic_add(&sh->next, 1) - 1;
+        SuiteEntry *e;
+        AiAction best;
+
+        if (idx >= sh->suite->count) break;
+        e = &sh->suite->entries[idx];
+        e->solve_ms = -1.0;
+        e->answer.type = AI_ACT_NONE;
+        e->score = 0;
+        e->depth = 0;
+        if (!notation_parse(&g, e->position, NULL, NULL, 0)) continue;
+        ai_clear_table(&ai);
+        watch.entry = e;
+        watch.start = thread_now_ms();
+        if (ai_search(&ai, &g, &best, NULL)) e->answer = best;
+        e->ms = thread_now_ms() - watch.start;
+        e->nodes = ai.nodes;
+        e->solved = e->solve_ms >= 0.0;
+    }
+
+    ai_free(&ai);
+    game_free(&g);
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+/* Positions are shared out to the threads one at a time; each thread has
+ * its own engine, so a position's search does not depend on the others. */
+int suite_run(const SuiteConfig *cfg, Suite *s, SuiteStats *stats, char *err, size_t err_cap) {
+    SuiteShared sh;
+    Thread threads[SUITE_MAX_THREADS];
+    double *times;
+    double start;
+    int count;
+    int i;
+
+    if (!cfg || !s || !stats) return 0;
+    memset(stats, 0, sizeof(*stats));
+    memset(&sh, 0, sizeof(sh));
+    sh.cfg = cfg;
+    sh.suite = s;
+
+    count = cfg->threads < 1 ? 1 : cfg->threads;
+    if (count > SUITE_MAX_THREADS) count = SUITE_MAX_THREADS;
+    if (count > s->count) count = s->count;
+    start = thread_now_ms();
+    for (i = 0; i < count; i++) {
+        if (!thread_start(&threads[i], suite_worker_main, &sh)) suite_worker_main(&sh);
+    }
+    for (i = 0; i < count; i++) thread_join(&threads[i]);
+    stats->ms = thread_now_ms() - start;
+    stats->threads = count;
+    if (sh.failed) {
+        set_err(err, err_cap, "Not enough memory for the engines.");
+        return 0;
+    }
+
+    times = (double *)malloc((size_t)s->count * sizeof(double));
+    if (!times) {
+        set_err(err, err_cap, "Not enough memory for the report.");
+        return 0;
+    }
+    stats->count = s->count;
+    for (i = 0; i < s->count; i++) {
+        stats->nodes += s->entries[i].nodes;
+        if (s->entries[i].solved) times[stats->solved++] = s->entries[i].solve_ms;
+    }
+    if (stats->solved > 0) {
+        qsort(times, (size_t)stats->solved, sizeof(double), compare_double);
+        stats->p50_ms = times[(stats->solved - 1) / 2];
+        stats->p90_ms = times[(stats->solved * 9 - 1) / 10];
+        stats->max_ms = times[stats->solved - 1];
+    }
+    free(times);
+    return 1;
+}
+
+void suite_print(FILE *out, const Suite *s, const SuiteStats *stats, int all) {
+    int i;
+    for (i = 0; i < s->count; i++) {
+        const SuiteEntry *e = &s->entries[i];
+        char answer[32];
+        if (e->solved && !all) continue;
+        notation_format_action(&e->answer, answer, sizeof(answer));
+        fprintf(out, "%-4s %-24s %-8s score %7d depth %2d %9.1f ms %9ld nodes\n", e->solved ? "ok" : "FAIL", e->id,
+                answer, e->score, e->depth, e->solved ? e->solve_ms : e->ms, e->nodes);
+    }
+    fprintf(out, "Solved %d of %d (%.1f%%) in %.2f s on %d thread(s), %lld nodes (%.0f nodes/s)\n", stats->solved,
+            stats->count, stats->count ? 100.0 * stats->solved / stats->count : 0.0, stats->ms / 1000.0,
+            stats->threads, stats->nodes, stats->ms > 0.0 ? stats->nodes * 1000.0 / stats->ms : 0.0);
+    if (stats->solved > 0) {
+        fprintf(out, "Time to solution: median %.1f ms, p90 %.1f ms, max %.1f ms\n", stats->p50_ms, stats->p90_ms,
+                stats->max_ms);
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef SIMPLE_SUITE_H
+#define SIMPLE_SUITE_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "ai.h"
+
+#define SUITE_MAX_BEST 8
+#define SUITE_MAX_THREADS 64
+#define SUITE_ID_SIZE 32
+
+/* Suite file: one position per line in notation form, then operations
+ * after semicolons. "bm" lists the accepted best moves, "win" or "loss"
+ * gives the result for the side to move, "id" names the line. Blank
+ * lines and lines starting with '#' are skipped:
+ *
+ *   9 1,4 8,4 10,10 1 - ; bm 0,4 ; id one-step */
+typedef enum {
+    SUITE_BEST_MOVE = 0,
+    SUITE_WIN,
+    SUITE_LOSS
+} SuiteExpect;
+
+typedef struct {
+    int line;
+    char id[SUITE_ID_SIZE];
+    const char *position;
+    SuiteExpect expect;
+    AiAction best[SUITE_MAX_BEST];
+    int best_count;
+
+    /* Filled in by suite_run. */
+    int solved;
+    AiAction answer;
+    int score;
+    int depth;
+    double solve_ms;
+    double ms;
+    long nodes;
+} SuiteEntry;
+
+typedef struct {
+    char *text;
+    SuiteEntry *entries;
+    int count;
+} Suite;
+
+typedef struct {
+    AiConfig ai;
+    int threads;
+} SuiteConfig;
+
+typedef struct {
+    int count;
+    int solved;
+    int threads;
+    double ms;
+    double p50_ms;
+    double p90_ms;
+    double max_ms;
+    long long nodes;
+} SuiteStats;
+
+void suite_default_config(SuiteConfig *cfg);
+int suite_load(Suite *s, const char *path, char *err, size_t err_cap);
+void suite_free(Suite *s);
+int suite_run(const SuiteConfig *cfg, Suite *s, SuiteStats *stats, char *err, size_t err_cap);
+void suite_print(FILE *out, const Suite *s, const SuiteStats *stats, int all);
+
+#endif
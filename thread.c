@@ -0,0 +1,233 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "thread.h"
+
+#include <stddef.h>
+
+#ifndef _WIN32
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+static DWORD WINAPI thread_trampoline(LPVOID arg) {
+    Thread *t = (Thread *)arg;
+    t->fn(t->arg);
+    return 0;
+}
+#else
+static void *thread_trampoline(void *arg) {
+    Thread *t = (Thread *)arg;
+    t->fn(t->arg);
+    return NULL;
+}
+#endif
+
+int thread_start(Thread *t, ThreadFunc fn, void *arg) {
+    if (!t || !fn) return 0;
+    t->fn = fn;
+    t->arg = arg;
+    t->started = 0;
+#ifdef _WIN32
+    t->handle = CreateThread(NULL, 0, thread_trampoline, t, 0, NULL);
+    if (!t->handle) return 0;
+#else
+    if (pthread_create(&t->handle, NULL, thread_trampoline, t) != 0) return 0;
+#endif
+    t->started = 1;
+    return 1;
+}
+
+void thread_join(Thread *t) {
+    if (!t || !t->started) return;
+#ifdef _WIN32
+    WaitForSingleObject(t->handle, INFINITE);
+    CloseHandle(t->handle);
+#else
+    pthread_join(t->handle, NULL);
+#endif
+    t->started = 0;
+}
+
+int thread_cpu_count(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
+}
+
+void thread_sleep_ms(int ms) {
+#ifdef _WIN32
+    Sleep((DWORD)ms);
+#else
+    struct timespec ts;
+    ts.tv_sec = ms / 1000;
+    ts.tv_nsec = (long)(ms % 1000) * 1000000L;
+    nanosleep(&ts, NULL);
+#endif
+}
+
+void thread_yield(void) {
+#ifdef _WIN32
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+}
+
+double thread_now_ms(void) {
+#ifdef _WIN32
+    LARGE_INTEGER freq;
+    LARGE_INTEGER now;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (double)now.QuadPart * 1000.0 / (double)freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1000000.0;
+#endif
+}
+
+void thread_mutex_init(ThreadMutex *m) {
+#ifdef _WIN32
+    InitializeCriticalSection(&m->cs);
+#else
+    pthread_mutex_init(&m->m, NULL);
+#endif
+}
+
+void thread_mutex_destroy(ThreadMutex *m) {
+#ifdef _WIN32
+    DeleteCriticalSection(&m->cs);
+#else
+    pthread_mutex_destroy(&m->m);
+#endif
+}
+
+void thread_mutex_lock(ThreadMutex *m) {
+#ifdef _WIN32
+    EnterCriticalSection(&m->cs);
+#else
+    pthread_mutex_lock(&m->m);
+#endif
+}
+
+void thread_mutex_unlock(ThreadMutex *m) {
+#ifdef _WIN32
+    LeaveCriticalSection(&m->cs);
+#else
+    pthread_mutex_unlock(&m->m);
+#endif
+}
+
+void thread_cond_init(ThreadCond *c) {
+#ifdef _WIN32
+    InitializeConditionVariable(&c->cv);
+#else
+    pthread_cond_init(&c->cv, NULL);
+#endif
+}
+
+void thread_cond_destroy(ThreadCond *c) {
+#ifdef _WIN32
+    (void)c;
+#else
+    pthread_cond_destroy(&c->cv);
+#endif
+}
+
+void thread_cond_wait(ThreadCond *c, ThreadMutex *m) {
+#ifdef _WIN32
+    SleepConditionVariableCS(&c->cv, &m->cs, INFINITE);
+#else
+    pthread_cond_wait(&c->cv, &m->m);
+#endif
+}
+
+void thread_cond_signal(ThreadCond *c) {
+#ifdef _WIN32
+    WakeConditionVariable(&c->cv);
+#else
+    pthread_cond_signal(&c->cv);
+#endif
+}
+
+void thread_cond_broadcast(ThreadCond *c) {
+#ifdef _WIN32
+    WakeAllConditionVariable(&c->cv);
+#else
+    pthread_cond_broadcast(&c->cv);
+#endif
+}
+
+long thread_atomic_load(volatile long *p) {
+#ifdef _WIN32
+    return InterlockedCompareExchange(p, 0, 0);
+#else
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+#endif
+}
+
+void thread_atomic_store(volatile long *p, long value) {
+#ifdef _WIN32
+    InterlockedExchange(p, value);
+#else
+    __atomic_store_n(p, value, __ATOMIC_RELEASE);
+#endif
+}
+
+long thread_atomic_add(volatile long *p, long delta) {
+#ifdef _WIN32
+    return InterlockedExchangeAdd(p, delta) + delta;
+#else
+    return __atomic_add_fetch(p, delta, __ATOMIC_ACQ_REL);
+#endif
+}
+
+int thread_atomic_cas(volatile long *p, long expected, long desired) {
+#ifdef _WIN32
+    return InterlockedCompareExchange(p, desired, expected) == expected;
+#else
+    return __atomic_compare_exchange_n(p, &expected, desired, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+#endif
+}
+
+uint64_t thread_atomic_or64(volatile uint64_t *p, uint64_t bits) {
+#ifdef _WIN32
+    return (uint64_t)InterlockedOr64((volatile LONG64 *)p, (LONG64)bits);
+#else
+    return __atomic_fetch_or(p, bits, __ATOMIC_ACQ_REL);
+#endif
+}
+
+uint64_t thread_atomic_load64(volatile uint64_t *p) {
+#ifdef _WIN32
+    return (uint64_t)InterlockedCompareExchange64((volatile LONG64 *)p, 0, 0);
+#else
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+#endif
+}
+
+int thread_atomic_cas64(volatile uint64_t *p, uint64_t expected, uint64_t desired) {
+#ifdef _WIN32
+    return (uint64_t)InterlockedCompareExchange64((volatile LONG64 *)p, (LONG64)desired, (LONG64)expected) == expected;
+#else
+    return __atomic_compare_exchange_n(p, &expected, desired, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+#endif
+}
+
+void thread_fence(void) {
+#ifdef _WIN32
+    MemoryBarrier();
+#else
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+#endif
+}
@@ -0,0 +1,74 @@
+#ifndef SIMPLE_THREAD_H
+#define SIMPLE_THREAD_H
+
+#include <stdint.h>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+typedef void (*ThreadFunc)(void *arg);
+
+typedef struct {
+#ifdef _WIN32
+    HANDLE handle;
+#else
+    pthread_t handle;
+#endif
+    ThreadFunc fn;
+    void *arg;
+    int started;
+} Thread;
+
+typedef struct {
+#ifdef _WIN32
+    CRITICAL_SECTION cs;
+#else
+    pthread_mutex_t m;
+#endif
+} ThreadMutex;
+
+typedef struct {
+#ifdef _WIN32
+    CONDITION_VARIABLE cv;
+#else
+    pthread_cond_t cv;
+#endif
+} ThreadCond;
+
+int thread_start(Thread *t, ThreadFunc fn, void *arg);
+void thread_join(Thread *t);
+int thread_cpu_count(void);
+void thread_sleep_ms(int ms);
+void thread_yield(void);
+double thread_now_ms(void);
+
+void thread_mutex_init(ThreadMutex *m);
+void thread_mutex_destroy(ThreadMutex *m);
+void thread_mutex_lock(ThreadMutex *m);
+void thread_mutex_unlock(ThreadMutex *m);
+
+void thread_cond_init(ThreadCond *c);
+void thread_cond_destroy(ThreadCond *c);
+void thread_cond_wait(ThreadCond *c, ThreadMutex *m);
+void thread_cond_signal(ThreadCond *c);
+void thread_cond_broadcast(ThreadCond *c);
+
+long thread_atomic_load(volatile long *p);
+void thread_atomic_store(volatile long *p, long value);
+long thread_atomic_add(volatile long *p, long delta);
+int thread_atomic_cas(volatile long *p, long expected, long desired);
+uint64_t thread_atomic_or64(volatile uint64_t *p, uint64_t bits);
+uint64_t thread_atomic_load64(volatile uint64_t *p);
+int thread_atomic_cas64(volatile uint64_t *p, uint64_t expected, uint64_t desired);
+void thread_fence(void);
+
+#endif
@@ -0,0 +1,648 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "trainset.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ai.h"
+#include "save.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define TRAIN_OUT_BUFFER (1 << 20)
+#define TRAIN_DEDUP_PROBES 32
+
+static void set_err(char *err, size_t cap, const char *msg) {
+    if (err && cap) {
+        snprintf(err, cap, "%s", msg);
+    }
+}
+
+static size_t anchor_bytes(int size) {
+    size_t spots = (size_t)(size - 1) * (size_t)(size - 1);
+    return (spots + 7) / 8;
+}
+
+size_t trainset_record_bytes(int size) {
+    size_t walls = 2 * anchor_bytes(size);
+    return sizeof(TrainRecord) + ((walls + 7) & ~(size_t)7);
+}
+
+void trainset_default_config(TrainConfig *cfg) {
+    if (!cfg) return;
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->prefix = "train";
+    cfg->size = 9;
+    cfg->walls = 10;
+    cfg->games = 1000;
+    cfg->threads = thread_cpu_count();
+    cfg->dedup_bits = 0;
+    cfg->node_limit = 2000;
+    cfg->depth = 2;
+    cfg->random_pct = 10;
+    cfg->seed = 1;
+    cfg->magic = 1;
+    cfg->adjudicate = 0;
+}
+
+static uint64_t mix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+static uint64_t read_bits(const uint64_t *src, size_t off, int len) {
+    size_t word = off >> 6;
+    int shift = (int)(off & 63);
+    uint64_t v = src[word] >> shift;
+    if (shift && shift + len > 64) v |= src[word + 1] << (64 - shift);
+    return len == 64 ? v : v & (((uint64_t)1 << len) - 1);
+}
+
+static void write_bits(unsigned char *dst, size_t off, uint64_t v, int len) {
+    while (len > 0) {
+        int shift = (int)(off & 7);
+        int take = 8 - shift < len ? 8 - shift : len;
+        dst[off >> 3] |= (unsigned char)((v & ((1u << take) - 1)) << shift);
+        v >>= take;
+        off += (size_t)take;
+        len -= take;
+    }
+}
+
+/* Anchor bits of one row are contiguous in the game's bitsets, so they
+ * are copied up to 64 at a time. */
+static void pack_anchors(const Game *g, const uint64_t *bits, unsigned char *out) {
+    int n = g->size;
+    int r;
+    size_t at = 0;
+    for (r = 0; r < n - 1; r++) {
+        size_t from = (size_t)r * (size_t)n;
+        int left = n - 1;
+        while (left > 0) {
+            int take = left < 64 ? left : 64;
+            write_bits(out, at, read_bits(bits, from, take), take);
+            from += (size_t)take;
+            at += (size_t)take;
+            left -= take;
+        }
+    }
+}
+
+/* Everything that makes the position, not what was learned about it. */
+static uint64_t record_key(const TrainRecord *rec, size_t record_bytes) {
+    const unsigned char *walls = (const unsigned char *)(rec + 1);
+    size_t words = (record_bytes - sizeof(TrainRecord)) / 8;
+    uint64_t key = mix64(((uint64_t)rec->pawn[0] << 32) ^ rec->pawn[1]);
+    size_t i;
+    key = mix64(key ^ ((uint64_t)rec->walls_left[0] << 40) ^ ((uint64_t)rec->walls_left[1] << 24) ^
+                ((uint64_t)rec->side << 16) ^ ((uint64_t)rec->blocked[0] << 8) ^ rec->blocked[1]);
+    for (i = 0; i < words; i++) {
+        uint64_t w;
+        memcpy(&w, walls + i * 8, 8);
+        key = mix64(key ^ w);
+    }
+    return key ? key : 1;
+}
+
+static void fill_record(Ai *ai, const Game *g, unsigned char *out, size_t record_bytes) {
+    TrainRecord *rec = (TrainRecord *)out;
+    unsigned char *walls = out + sizeof(TrainRecord);
+    int n = g->size;
+    int p;
+
+    memset(out, 0, record_bytes);
+    for (p = 0; p < PLAYER_COUNT; p++) {
+        int left = g->walls_left[p];
+        int blocked = g->blocked_turns[p];
+        rec->pawn[p] = (uint32_t)(g->players[p].row * n + g->players[p].col);
+        rec->path_len[p] = (uint32_t)ai_path_length(ai, g, p);
+        rec->walls_left[p] = (uint16_t)(left > 0xFFFF ? 0xFFFF : left);
+        rec->blocked[p] = (uint8_t)(blocked > 0xFF ? 0xFF : blocked);
+    }
+    rec->side = (uint8_t)g->current_player;
+    rec->winner = TRAIN_NO_WINNER;
+    pack_anchors(g, g->h_wall_at, walls);
+    pack_anchors(g, g->v_wall_at, walls + anchor_bytes(n));
+    rec->key = record_key(rec, record_bytes);
+}
+
+/* Lock-free set of record keys shared by all writers; 0 marks a free
+ * slot. A full neighbourhood lets the record through rather than block. */
+typedef struct {
+    volatile uint64_t *slots;
+    size_t mask;
+} TrainDedup;
+
+static int dedup_insert(TrainDedup *d, uint64_t key) {
+    size_t i = (size_t)mix64(key) & d->mask;
+    int probe;
+    for (probe = 0; probe < TRAIN_DEDUP_PROBES; probe++, i = (i + 1) & d->mask) {
+        uint64_t cur = thread_atomic_load64(&d->slots[i]);
+        if (cur == key) return 0;
+        if (cur != 0) continue;
+        if (thread_atomic_cas64(&d->slots[i], 0, key)) return 1;
+        if (thread_atomic_load64(&d->slots[i]) == key) return 0;
+    }
+    return 1;
+}
+
+typedef struct {
+    FILE *fp;
+    unsigned char *buf;
+    size_t len;
+    size_t record_bytes;
+    int ok;
+} ShardWriter;
+
+static int shard_open(ShardWriter *w, const char *path, int size) {
+    unsigned char header[TRAIN_HEADER_BYTES];
+    uint32_t fields[3];
+
+    memset(w, 0, sizeof(*w));
+    w->record_bytes = trainset_record_bytes(size);
+    w->buf = (unsigned char *)malloc(TRAIN_OUT_BUFFER);
+    w->fp = fopen(path, "wb");
+    if (!w->buf || !w->fp) {
+        free(w->buf);
+        if (w->fp) fclose(w->fp);
+        memset(w, 0, sizeof(*w));
+        return 0;
+    }
+
+    fields[0] = TRAIN_VERSION;
+    fields[1] = (uint32_t)size;
+    fields[2] = (uint32_t)w->record_bytes;
+    memset(header, 0, sizeof(header));
+    memcpy(header, TRAIN_MAGIC, 4);
+    memcpy(header + 4, fields, sizeof(fields));
+    w->ok = fwrite(header, 1, sizeof(header), w->fp) == sizeof(header);
+    return 1;
+}
+
+static void shard_flush(ShardWriter *w) {
+    if (w->len > 0 && fwrite(w->buf, 1, w->len, w->fp) != w->len) w->ok = 0;
+    w->len = 0;
+}
+
+static void shard_put(ShardWriter *w, const unsigned char *rec) {
+    if (w->len + w->record_bytes > TRAIN_OUT_BUFFER) shard_flush(w);
+    if (w->record_bytes > TRAIN_OUT_BUFFER) {
+        if (fwrite(rec, 1, w->record_bytes, w->fp) != w->record_bytes) w->ok = 0;
+        return;
+    }
+    memcpy(w->buf + w->len, rec, w->record_bytes);
+    w->len += w->record_bytes;
+}
+
+static int shard_close(ShardWriter *w) {
+    int ok;
+    if (!w->fp) return 0;
+    shard_flush(w);
+    if (fclose(w->fp) != 0) w->ok = 0;
+    free(w->buf);
+    ok = w->ok;
+    memset(w, 0, sizeof(*w));
+    return ok;
+}
+
+typedef struct {
+    const TrainConfig *cfg;
+    TrainDedup *dedup;
+    volatile long *next_game;
+    int id;
+    ShardWriter shard;
+    unsigned char *game_recs;
+    size_t game_cap;
+    TrainStats stats;
+    int ok;
+} TrainWorker;
+
+static int reserve_game_recs(TrainWorker *w, size_t count) {
+    size_t bytes = count * w->shard.record_bytes;
+    unsigned char *recs;
+    size_t cap;
+    if (bytes <= w->game_cap) return 1;
+    cap = w->game_cap ? w->game_cap * 2 : w->shard.record_bytes * 256;
+    while (cap < bytes) cap *= 2;
+    recs = (unsigned char *)realloc(w->game_recs, cap);
+    if (!recs) return 0;
+    w->game_recs = recs;
+    w->game_cap = cap;
+    return 1;
+}
+
+static int choose_action(Ai *ai, Game *g, int random_pct, AiAction *out) {
+    AiAction list[AI_MAX_ACTIONS];
+    int count;
+    if ((int)(game_random(g) % 100) < random_pct) {
+        count = ai_list_actions(ai, g, g->current_player, list, AI_MAX_ACTIONS);
+        if (count > 0) {
+            *out = list[game_random(g) % (unsigned int)count];
+            return 1;
+        }
+    }
+    return ai_search(ai, g, out, NULL);
+}
+
+/* Plays one game the way run_game_loop does (magic, blocked turns, then
+ * an action) and records the position before every action. With
+ * adjudication a pure race ends the game at once with its exact result;
+ * that needs magic off, since magic can hand walls back. */
+static size_t play_game(TrainWorker *w, Ai *ai, Game *g, int *winner) {
+    const TrainConfig *cfg = w->cfg;
+    size_t rb = w->shard.record_bytes;
+    size_t count = 0;
+    long ply;
+    long max_ply = 4L * cfg->size * cfg->size;
+    char msg[160];
+
+    *winner = -1;
+    for (ply = 0; ply < max_ply; ply++) {
+        AiAction a;
+        int side = g->current_player;
+
+        if (cfg->magic) game_apply_magic(g, msg, sizeof(msg));
+        *winner = game_check_winner(g);
+        if (*winner >= 0) break;
+
+        if (cfg->adjudicate && race_is_pure(g, cfg->magic) && race_prepare(&ai->race, g)) {
+            RaceResult r = race_solve(&ai->race, g, NULL, NULL);
+            if (r != RACE_UNKNOWN) {
+                *winner = r == RACE_WIN ? side : (r == RACE_LOSS ? 1 - side : -1);
+                w->stats.adjudicated++;
+                break;
+            }
+        }
+
+        if (g->blocked_turns[side] > 0) {
+            g->blocked_turns[side]--;
+            g->current_player = game_next_player(side);
+            continue;
+        }
+
+        if (!reserve_game_recs(w, count + 1)) break;
+        fill_record(ai, g, w->game_recs + count * rb, rb);
+        count++;
+
+        if (!choose_action(ai, g, cfg->random_pct, &a) || !ai_apply_action(g, side, &a, NULL, 0)) {
+            if (!game_try_ai_turn(g, msg, sizeof(msg))) break;
+        }
+        *winner = game_check_winner(g);
+        if (*winner >= 0) break;
+        g->current_player = game_next_player(side);
+    }
+    return count;
+}
+
+static void train_worker_main(void *arg) {
+    TrainWorker *w = (TrainWorker *)arg;
+    const TrainConfig *cfg = w->cfg;
+    AiConfig ai_cfg;
+    Ai ai;
+    Game g;
+    char path[SAVE_PATH_MAX];
+
+    snprintf(path, sizeof(path), "%s-%02d.sqtd", cfg->prefix, w->id);
+    if (!shard_open(&w->shard, path, cfg->size)) return;
+
+    ai_default_config(&ai_cfg);
+    ai_cfg.depth = cfg->depth;
+    ai_cfg.node_limit = cfg->node_limit;
+    ai_cfg.time_limit_ms = 0;
+    ai_cfg.table_bits = 16;
+    game_init(&g);
+    if (!ai_init(&ai, &ai_cfg)) {
+        ai_free(&ai);
+        shard_close(&w->shard);
+        return;
+    }
+
+    for (;;) {
+        long idx = thread_atomic_add(w->next_game, 1) - 1;
+        size_t count;
+        size_t i;
+        int winner;
+
+        if (idx >= cfg->games) break;
+        if (!game_start(&g, cfg->size, cfg->walls, MODE_PVP, "A", "B")) break;
+        game_set_seed(&g, mix64(cfg->seed ^ ((uint64_t)idx << 20)));
+        ai_clear_table(&ai);
+        count = play_game(w, &ai, &g, &winner);
+
+        for (i = 0; i < count; i++) {
+            unsigned char *rec = w->game_recs + i * w->shard.record_bytes;
+            TrainRecord *head = (TrainRecord *)rec;
+            head->winner = (uint8_t)(winner >= 0 ? winner : TRAIN_NO_WINNER);
+            if (w->dedup && !dedup_insert(w->dedup, head->key)) {
+                w->stats.duplicates++;
+                continue;
+            }
+            shard_put(&w->shard, rec);
+            w->stats.positions++;
+            w->stats.bytes += (long long)w->shard.record_bytes;
+        }
+        w->stats.games++;
+    }
+
+    ai_free(&ai);
+    game_free(&g);
+    free(w->game_recs);
+    w->ok = shard_close(&w->shard);
+}
+
+int trainset_selfplay(const TrainConfig *cfg, TrainStats *stats, char *err, size_t err_cap) {
+    TrainWorker workers[TRAIN_MAX_THREADS];
+    Thread threads[TRAIN_MAX_THREADS];
+    TrainDedup dedup;
+    volatile long next_game = 0;
+    int count;
+    int ok = 1;
+    int i;
+    double start;
+
+    if (!cfg || !stats) return 0;
+    if (cfg->size < MIN_SIZE || cfg->size > MAX_SIZE || cfg->games < 1) {
+        set_err(err, err_cap, "Invalid self-play settings.");
+        return 0;
+    }
+    count = cfg->threads < 1 ? 1 : cfg->threads;
+    if (count > TRAIN_MAX_THREADS) count = TRAIN_MAX_THREADS;
+
+    dedup.slots = NULL;
+    dedup.mask = 0;
+    if (cfg->dedup_bits > 0) {
+        int bits = cfg->dedup_bits > 32 ? 32 : cfg->dedup_bits;
+        dedup.slots = (volatile uint64_t *)calloc((size_t)1 << bits, sizeof(uint64_t));
+        if (!dedup.slots) {
+            set_err(err, err_cap, "Not enough memory for the dedup table.");
+            return 0;
+        }
+        dedup.mask = ((size_t)1 << bits) - 1;
+    }
+
+    memset(stats, 0, sizeof(*stats));
+    memset(workers, 0, sizeof(workers));
+    start = thread_now_ms();
+    for (i = 0; i < count; i++) {
+        workers[i].cfg = cfg;
+        workers[i].dedup = dedup.slots ? &dedup : NULL;
+        workers[i].next_game = &next_game;
+        workers[i].id = i;
+        if (!thread_start(&threads[i], train_worker_main, &workers[i])) train_worker_main(&workers[i]);
+    }
+    for (i = 0; i < count; i++) {
+        thread_join(&threads[i]);
+        if (!workers[i].ok) ok = 0;
+        stats->games += workers[i].stats.games;
+        stats->positions += workers[i].stats.positions;
+        stats->duplicates += workers[i].stats.duplicates;
+        stats->bytes += workers[i].stats.bytes;
+        stats->adjudicated += workers[i].stats.adjudicated;
+    }
+    stats->ms = thread_now_ms() - start;
+    free((void *)dedup.slots);
+
+    if (!ok) set_err(err, err_cap, "Failed to write a training shard.");
+    return ok;
+}
+
+int trainset_export_saves(const char *path, char **files, int file_count, TrainStats *stats, char *err, size_t err_cap) {
+    ShardWriter shard;
+    unsigned char *rec = NULL;
+    Ai ai;
+    AiConfig ai_cfg;
+    Game g;
+    int size = 0;
+    int i;
+    int ok = 1;
+    double start = thread_now_ms();
+
+    if (!path || !files || file_count < 1 || !stats) return 0;
+    memset(stats, 0, sizeof(*stats));
+    memset(&shard, 0, sizeof(shard));
+    game_init(&g);
+    ai_default_config(&ai_cfg);
+    ai_cfg.table_bits = 10;
+    if (!ai_init(&ai, &ai_cfg)) {
+        ai_free(&ai);
+        set_err(err, err_cap, "Not enough memory.");
+        return 0;
+    }
+
+    for (i = 0; i < file_count && ok; i++) {
+        int winner;
+        if (!load_game(files[i], &g, err, err_cap)) {
+            ok = 0;
+            break;
+        }
+        if (size == 0) {
+            size = g.size;
+            rec = (unsigned char *)malloc(trainset_record_bytes(size));
+            if (!rec || !shard_open(&shard, path, size)) {
+                set_err(err, err_cap, "Cannot create training shard.");
+                ok = 0;
+                break;
+            }
+        } else if (g.size != size) {
+            set_err(err, err_cap, "Saves in one shard must share a board size.");
+            ok = 0;
+            break;
+        }
+        fill_record(&ai, &g, rec, shard.record_bytes);
+        winner = game_check_winner(&g);
+        ((TrainRecord *)rec)->winner = (uint8_t)(winner >= 0 ? winner : TRAIN_NO_WINNER);
+        shard_put(&shard, rec);
+        stats->positions++;
+        stats->bytes += (long long)shard.record_bytes;
+    }
+
+    if (shard.fp && !shard_close(&shard) && ok) {
+        set_err(err, err_cap, "Failed to write training shard.");
+        ok = 0;
+    }
+    free(rec);
+    ai_free(&ai);
+    game_free(&g);
+    stats->ms = thread_now_ms() - start;
+    return ok;
+}
+
+int trainset_open(TrainShard *s, const char *path, char *err, size_t err_cap) {
+    uint32_t fields[3];
+    const unsigned char *base;
+    size_t bytes;
+
+    if (!s || !path) return 0;
+    memset(s, 0, sizeof(*s));
+
+#ifdef _WIN32
+    {
+        LARGE_INTEGER size;
+        s->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (s->file == INVALID_HANDLE_VALUE) {
+            set_err(err, err_cap, "Cannot open training shard.");
+            return 0;
+        }
+        if (!GetFileSizeEx(s->file, &size) || size.QuadPart < TRAIN_HEADER_BYTES) {
+            CloseHandle(s->file);
+            set_err(err, err_cap, "Training shard is too short.");
+            return 0;
+        }
+        bytes = (size_t)size.QuadPart;
+        s->mapping = CreateFileMappingA(s->file, NULL, PAGE_READONLY, 0, 0, NULL);
+        base = s->mapping ? (const unsigned char *)MapViewOfFile(s->mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+        if (!base) {
+            if (s->mapping) CloseHandle(s->mapping);
+            CloseHandle(s->file);
+            set_err(err, err_cap, "Cannot map training shard.");
+            return 0;
+        }
+    }
+#else
+    {
+        struct stat st;
+        void *map;
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) {
+            set_err(err, err_cap, "Cannot open training shard.");
+            return 0;
+        }
+        if (fstat(fd, &st) != 0 || st.st_size < TRAIN_HEADER_BYTES) {
+            close(fd);
+            set_err(err, err_cap, "Training shard is too short.");
+            return 0;
+        }
+        bytes = (size_t)st.st_size;
+        map = mmap(NULL, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (map == MAP_FAILED) {
+            set_err(err, err_cap, "Cannot map training shard.");
+            return 0;
+        }
+        base = (const unsigned char *)map;
+    }
+#endif
+
+    s->base = base;
+    s->bytes = bytes;
+    memcpy(fields, base + 4, sizeof(fields));
+    if (memcmp(base, TRAIN_MAGIC, 4) != 0 || fields[0] != TRAIN_VERSION || fields[1] < MIN_SIZE ||
+        fields[1] > MAX_SIZE || fields[2] != trainset_record_bytes((int)fields[1])) {
+        trainset_close(s);
+        set_err(err, err_cap, "Not a training shard.");
+        return 0;
+    }
+    s->size = (int)fields[1];
+    s->record_bytes = fields[2];
+    s->count = (bytes - TRAIN_HEADER_BYTES) / s->record_bytes;
+    return 1;
+}
+
+void trainset_close(TrainShard *s) {
+    if (!s || !s->base) return;
+#ifdef _WIN32
+    UnmapViewOfFile(s->base);
+    CloseHandle(s->mapping);
+    CloseHandle(s->file);
+#else
+    munmap((void *)s->base, s->bytes);
+#endif
+    memset(s, 0, sizeof(*s));
+}
+
+const TrainRecord *trainset_record(const TrainShard *s, size_t index) {
+    if (!s || !s->base || index >= s->count) return NULL;
+    return (const TrainRecord *)(s->base + TRAIN_HEADER_BYTES + index * s->record_bytes);
+}
+
+int trainset_wall_at(const TrainShard *s, const TrainRecord *r, int row, int col, WallDir dir) {
+    const unsigned char *walls;
+    size_t bit;
+    if (!s || !r || row < 0 || col < 0 || row >= s->size - 1 || col >= s->size - 1) return 0;
+    walls = (const unsigned char *)(r + 1);
+    if (dir == DIR_V) walls += anchor_bytes(s->size);
+    bit = (size_t)row * (size_t)(s->size - 1) + (size_t)col;
+    return (walls[bit >> 3] >> (bit & 7)) & 1;
+}
+
+/* Rebuilds the position a record was taken from into g. */
+int trainset_to_game(const TrainShard *s, const TrainRecord *r, Game *g) {
+    Pos pawns[PLAYER_COUNT];
+    int n;
+    int row;
+    int col;
+    int p;
+
+    if (!s || !r || !g || !game_clear(g, s->size)) return 0;
+    n = s->size;
+    for (p = 0; p < PLAYER_COUNT; p++) {
+        if (r->pawn[p] >= (uint32_t)(n * n)) return 0;
+        pawns[p].row = (int)r->pawn[p] / n;
+        pawns[p].col = (int)r->pawn[p] % n;
+    }
+    if (!game_set_pawns(g, pawns)) return 0;
+    for (p = 0; p < PLAYER_COUNT; p++) {
+        g->walls_left[p] = r->walls_left[p];
+        g->blocked_turns[p] = r->blocked[p];
+    }
+    g->current_player = r->side < PLAYER_COUNT ? r->side : 0;
+    for (row = 0; row < n - 1; row++) {
+        for (col = 0; col < n - 1; col++) {
+            if (trainset_wall_at(s, r, row, col, DIR_H) && !game_add_wall_from_map(g, row, col, DIR_H)) return 0;
+            if (trainset_wall_at(s, r, row, col, DIR_V) && !game_add_wall_from_map(g, row, col, DIR_V)) return 0;
+        }
+    }
+    return 1;
+}
+
+int trainset_summary(FILE *out, char **files, int file_count) {
+    long long records = 0;
+    long long decided = 0;
+    long long side_won = 0;
+    double path_sum[PLAYER_COUNT] = {0.0, 0.0};
+    double start = thread_now_ms();
+    double ms;
+    int i;
+
+    for (i = 0; i < file_count; i++) {
+        TrainShard s;
+        char err[128];
+        size_t k;
+        if (!trainset_open(&s, files[i], err, sizeof(err))) {
+            fprintf(out, "%s: %s\n", files[i], err);
+            return 0;
+        }
+        for (k = 0; k < s.count; k++) {
+            const TrainRecord *r = trainset_record(&s, k);
+            int p;
+            for (p = 0; p < PLAYER_COUNT; p++) path_sum[p] += r->path_len[p];
+            if (r->winner != TRAIN_NO_WINNER) {
+                decided++;
+                if (r->winner == r->side) side_won++;
+            }
+        }
+        records += (long long)s.count;
+        fprintf(out, "%s: %dx%d board, %lu records of %lu bytes\n", files[i], s.size, s.size,
+                (unsigned long)s.count, (unsigned long)s.record_bytes);
+        trainset_close(&s);
+    }
+
+    ms = thread_now_ms() - start;
+    fprintf(out, "records %lld, decided %lld, side to move won %.1f%%\n", records, decided,
+            decided ? 100.0 * (double)side_won / (double)decided : 0.0);
+    if (records > 0) {
+        fprintf(out, "mean path length P1 %.2f, P2 %.2f\n", path_sum[0] / (double)records, path_sum[1] / (double)records);
+    }
+    fprintf(out, "read in %.1f ms (%.1f M records/s)\n", ms, ms > 0.0 ? (double)records / ms / 1000.0 : 0.0);
+    return 1;
+}
@@ -0,0 +1,80 @@
+#ifndef SIMPLE_TRAINSET_H
+#define SIMPLE_TRAINSET_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "game.h"
+#include "thread.h"
+
+#define TRAIN_MAGIC "SQTD"
+#define TRAIN_VERSION 1
+#define TRAIN_HEADER_BYTES 32
+#define TRAIN_NO_WINNER 0xFF
+#define TRAIN_MAX_THREADS 64
+
+/* Shard file: a TRAIN_HEADER_BYTES header (magic, version, board size,
+ * record size) followed by fixed-width records. Every record starts with
+ * this head and is followed by the H then V wall anchors, (size-1)^2 bits
+ * each, row-major, padded so the next record stays 8-byte aligned. */
+typedef struct {
+    uint64_t key;
+    uint32_t pawn[PLAYER_COUNT];
+    uint32_t path_len[PLAYER_COUNT];
+    uint16_t walls_left[PLAYER_COUNT];
+    uint8_t side;
+    uint8_t winner;
+    uint8_t blocked[PLAYER_COUNT];
+} TrainRecord;
+
+typedef struct {
+    const char *prefix;
+    int size;
+    int walls;
+    long games;
+    int threads;
+    int dedup_bits;
+    long node_limit;
+    int depth;
+    int random_pct;
+    uint64_t seed;
+    int magic;
+    int adjudicate;
+} TrainConfig;
+
+typedef struct {
+    long games;
+    long long positions;
+    long long duplicates;
+    long long bytes;
+    long adjudicated;
+    double ms;
+} TrainStats;
+
+/* A memory-mapped shard. Records are read in place. */
+typedef struct {
+    const unsigned char *base;
+    size_t bytes;
+    int size;
+    size_t record_bytes;
+    size_t count;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#endif
+} TrainShard;
+
+size_t trainset_record_bytes(int size);
+void trainset_default_config(TrainConfig *cfg);
+int trainset_selfplay(const TrainConfig *cfg, TrainStats *stats, char *err, size_t err_cap);
+int trainset_export_saves(const char *path, char **files, int file_count, TrainStats *stats, char *err, size_t err_cap);
+
+int trainset_open(TrainShard *s, const char *path, char *err, size_t err_cap);
+void trainset_close(TrainShard *s);
+const TrainRecord *trainset_record(const TrainShard *s, size_t index);
+int trainset_wall_at(const TrainShard *s, const TrainRecord *r, int row, int col, WallDir dir);
+int trainset_to_game(const TrainShard *s, const TrainRecord *r, Game *g);
+int trainset_summary(FILE *out, char **files, int file_count);
+
+#endif
@@ -0,0 +1,363 @@
+#include "tune.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "thread.h"
+#include "trainset.h"
+
+#define TUNE_BLOCK 256
+#define TUNE_MIN_SLICE 8192
+
+static void set_err(char *err, size_t cap, const char *msg) {
+    if (err && cap) {
+        snprintf(err, cap, "%s", msg);
+    }
+}
+
+void tune_default_config(TuneConfig *cfg) {
+    if (!cfg) return;
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->out_path = AI_WEIGHTS_FILE;
+    cfg->threads = thread_cpu_count();
+    cfg->max_rounds = 100;
+    cfg->start_step = 8;
+}
+
+static int clamp_threads(int threads) {
+    if (threads < 1) return 1;
+    if (threads > TUNE_MAX_THREADS) return TUNE_MAX_THREADS;
+    return threads;
+}
+
+typedef struct {
+    TuneSet *set;
+    const TrainShard *shards;
+    int shard_count;
+    size_t begin;
+    size_t end;
+    int ok;
+} TuneLoader;
+
+/* Fills slots [begin, end) of the set, indexed over all shards in order.
+ * Undecided or unreadable records get label -1 and are dropped later. */
+static void loader_main(void *arg) {
+    TuneLoader *l = (TuneLoader *)arg;
+    TuneSet *set = l->set;
+    AiConfig cfg;
+    Ai ai;
+    Game g;
+    size_t base = 0;
+    int s;
+
+    ai_default_config(&cfg);
+    cfg.table_bits = 10;
+    game_init(&g);
+    if (!ai_init(&ai, &cfg)) {
+        ai_free(&ai);
+        return;
+    }
+
+    for (s = 0; s < l->shard_count; s++) {
+        const TrainShard *shard = &l->shards[s];
+        size_t first;
+        size_t last;
+        size_t i;
+
+        if (l->end <= base) break;
+        first = l->begin > base ? l->begin - base : 0;
+        last = l->end - base < shard->count ? l->end - base : shard->count;
+        for (i = first; i < last; i++) {
+            const TrainRecord *r = trainset_record(shard, i);
+            size_t slot = base + i;
+            int f[AI_EVAL_TERMS];
+            int t;
+
+            set->label[slot] = -1.0f;
+            if (r->winner == TRAIN_NO_WINNER || !trainset_to_game(shard, r, &g)) continue;
+            if (!ai_eval_features(&ai, &g, g.current_player, f)) continue;
+            for (t = 0; t < AI_EVAL_TERMS; t++) set->term[t][slot] = (float)f[t];
+            set->label[slot] = r->winner == r->side ? 1.0f : 0.0f;
+        }
+        base += shard->count;
+    }
+
+    ai_free(&ai);
+    game_free(&g);
+    l->ok = 1;
+}
+
+static int alloc_set(TuneSet *set, size_t count) {
+    int t;
+    memset(set, 0, sizeof(*set));
+    if (count == 0) return 1;
+    set->storage = (float *)malloc((size_t)(AI_EVAL_TERMS + 1) * count * sizeof(float));
+    if (!set->storage) return 0;
+    for (t = 0; t < AI_EVAL_TERMS; t++) set->term[t] = set->storage + (size_t)t * count;
+    set->label = set->storage + (size_t)AI_EVAL_TERMS * count;
+    set->count = count;
+    return 1;
+}
+
+static void compact_set(TuneSet *set) {
+    size_t kept = 0;
+    size_t i;
+    int t;
+    for (i = 0; i < set->count; i++) {
+        if (set->label[i] < 0.0f) continue;
+        if (kept != i) {
+            for (t = 0; t < AI_EVAL_TERMS; t++) set->term[t][kept] = set->term[t][i];
+            set->label[kept] = set->label[i];
+        }
+        kept++;
+    }
+    set->count = kept;
+}
+
+int tune_load(TuneSet *set, char **files, int file_count, int threads, char *err, size_t err_cap) {
+    TrainShard *shards;
+    TuneLoader loaders[TUNE_MAX_THREADS];
+    Thread handles[TUNE_MAX_THREADS];
+    size_t total = 0;
+    size_t per;
+    int opened = 0;
+    int ok = 1;
+    int i;
+
+    if (!set || !files || file_count < 1) return 0;
+    memset(set, 0, sizeof(*set));
+    shards = (TrainShard *)calloc((size_t)file_count, sizeof(TrainShard));
+    if (!shards) {
+        set_err(err, err_cap, "Not enough memory.");
+        return 0;
+    }
+    for (i = 0; i < file_count; i++) {
+        if (!trainset_open(&shards[i], files[i], err, err_cap)) {
+            ok = 0;
+            break;
+        }
+        opened++;
+        total += shards[i].count;
+    }
+
+    if (ok && !alloc_set(set, total)) {
+        set_err(err, err_cap, "Not enough memory for the training positions.");
+        ok = 0;
+    }
+    if (ok && total > 0) {
+        threads = clamp_threads(threads);
+        per = (total + (size_t)threads - 1) / (size_t)threads;
+        memset(loaders, 0, sizeof(loaders));
+        for (i = 0; i < threads; i++) {
+            loaders[i].set = set;
+            loaders[i].shards = shards;
+            loaders[i].shard_count = opened;
+            loaders[i].begin = per * (size_t)i < total ? per * (size_t)i : total;
+            loaders[i].end = loaders[i].begin + per < total ? loaders[i].begin + per : total;
+            if (!thread_start(&handles[i], loader_main, &loaders[i])) loader_main(&loaders[i]);
+        }
+        for (i = 0; i < threads; i++) {
+            thread_join(&handles[i]);
+            if (!loaders[i].ok) ok = 0;
+        }
+        if (!ok) set_err(err, err_cap, "Not enough memory to rebuild positions.");
+        else compact_set(set);
+    }
+
+    for (i = 0; i < opened; i++) trainset_close(&shards[i]);
+    free(shards);
+    if (!ok) tune_free(set);
+    return ok;
+}
+
+void tune_free(TuneSet *set) {
+    if (!set) return;
+    free(set->storage);
+    memset(set, 0, sizeof(*set));
+}
+
+typedef struct {
+    const TuneSet *set;
+    float weights[AI_EVAL_TERMS];
+    float k;
+    size_t begin;
+    size_t end;
+    double sum;
+} TuneSlice;
+
+/* Squared error of sigmoid(k * score) against the labels. Scores are built
+ * a block at a time, one term after another, so each inner loop is a
+ * straight multiply-add over contiguous floats. */
+static void error_slice(void *arg) {
+    TuneSlice *s = (TuneSlice *)arg;
+    const TuneSet *set = s->set;
+    float score[TUNE_BLOCK];
+    double sum = 0.0;
+    size_t i;
+
+    for (i = s->begin; i < s->end; i += TUNE_BLOCK) {
+        size_t len = s->end - i < TUNE_BLOCK ? s->end - i : TUNE_BLOCK;
+        const float *label = set->label + i;
+        float part = 0.0f;
+        size_t j;
+        int t;
+
+        for (j = 0; j < len; j++) score[j] = 0.0f;
+        for (t = 0; t < AI_EVAL_TERMS; t++) {
+            const float *f = set->term[t] + i;
+            float w = s->weights[t];
+            if (w == 0.0f) continue;
+            for (j = 0; j < len; j++) score[j] += w * f[j];
+        }
+        for (j = 0; j < len; j++) {
+            float e = label[j] - 1.0f / (1.0f + expf(-s->k * score[j]));
+            part += e * e;
+        }
+        sum += part;
+    }
+    s->sum = sum;
+}
+
+double tune_error(const TuneSet *set, const int *weights, double k, int threads) {
+    TuneSlice slices[TUNE_MAX_THREADS];
+    Thread handles[TUNE_MAX_THREADS];
+    double sum = 0.0;
+    size_t per;
+    int count;
+    int i;
+    int t;
+
+    if (!set || !weights || set->count == 0) return 0.0;
+    count = clamp_threads(threads);
+    if ((size_t)count * TUNE_MIN_SLICE > set->count) count = (int)(set->count / TUNE_MIN_SLICE) + 1;
+    per = (set->count + (size_t)count - 1) / (size_t)count;
+    per = (per + TUNE_BLOCK - 1) / TUNE_BLOCK * TUNE_BLOCK;
+
+    for (i = 0; i < count; i++) {
+        TuneSlice *s = &slices[i];
+        s->set = set;
+        for (t = 0; t < AI_EVAL_TERMS; t++) s->weights[t] = (float)weights[t];
+        s->k = (float)k;
+        s->begin = per * (size_t)i < set->count ? per * (size_t)i : set->count;
+        s->end = s->begin + per < set->count ? s->begin + per : set->count;
+        s->sum = 0.0;
+        if (i == 0) continue;
+        if (!thread_start(&handles[i], error_slice, s)) error_slice(s);
+    }
+    error_slice(&slices[0]);
+    for (i = 1; i < count; i++) thread_join(&handles[i]);
+    for (i = 0; i < count; i++) sum += slices[i].sum;
+    return sum / (double)set->count;
+}
+
+/* Scale that maps evaluation units onto win probability, found with the
+ * starting weights and then held fixed while the weights move. */
+static double fit_scale(const TuneSet *set, const int *weights, int threads) {
+    double best_k = 0.001;
+    double best = tune_error(set, weights, best_k, threads);
+    double lo;
+    double hi;
+    double k;
+    int i;
+
+    for (k = best_k * 1.25; k < 4.0; k *= 1.25) {
+        double e = tune_error(set, weights, k, threads);
+        if (e < best) {
+            best = e;
+            best_k = k;
+        }
+    }
+    lo = best_k / 1.25;
+    hi = best_k * 1.25;
+    for (i = 0; i < 24; i++) {
+        double a = lo + (hi - lo) / 3.0;
+        double b = hi - (hi - lo) / 3.0;
+        if (tune_error(set, weights, a, threads) < tune_error(set, weights, b, threads)) hi = b;
+        else lo = a;
+    }
+    return (lo + hi) / 2.0;
+}
+
+static void print_weights(FILE *out, const int *weights) {
+    int t;
+    for (t = 0; t < AI_EVAL_TERMS; t++) fprintf(out, " %s=%d", ai_term_name(t), weights[t]);
+    fprintf(out, "\n");
+}
+
+/* Texel-style local search: nudge one weight at a time, keep any change
+ * that lowers the error, and halve the step once nothing helps. */
+int tune_run(const TuneConfig *cfg, char **files, int file_count, FILE *out, char *err, size_t err_cap) {
+    TuneSet set;
+    AiConfig ai_cfg;
+    int *w = ai_cfg.weights;
+    double start = thread_now_ms();
+    double best;
+    double k;
+    int step;
+    int round;
+
+    if (!cfg || !out) return 0;
+    if (!tune_load(&set, files, file_count, cfg->threads, err, err_cap)) return 0;
+    fprintf(out, "Loaded %lu decided positions from %d shard(s) in %.1f ms\n", (unsigned long)set.count, file_count,
+            thread_now_ms() - start);
+    if (set.count == 0) {
+        tune_free(&set);
+        set_err(err, err_cap, "No decided positions to tune on.");
+        return 0;
+    }
+
+    ai_default_config(&ai_cfg);
+    if (ai_load_weights(&ai_cfg, cfg->out_path)) fprintf(out, "Starting from %s\n", cfg->out_path);
+    k = fit_scale(&set, w, cfg->threads);
+    best = tune_error(&set, w, k, cfg->threads);
+    fprintf(out, "scale %.5f, error %.6f, weights", k, best);
+    print_weights(out, w);
+    fflush(out);
+
+    step = cfg->start_step < 1 ? 1 : cfg->start_step;
+    for (round = 1; round <= cfg->max_rounds; round++) {
+        int improved = 0;
+        int t;
+
+        for (t = 0; t < AI_EVAL_TERMS; t++) {
+            int dir;
+            for (dir = 1; dir >= -1; dir -= 2) {
+                int moved = 0;
+                for (;;) {
+                    double e;
+                    w[t] += dir * step;
+                    e = tune_error(&set, w, k, cfg->threads);
+                    if (e < best) {
+                        best = e;
+                        moved = 1;
+                        continue;
+                    }
+                    w[t] -= dir * step;
+                    break;
+                }
+                if (moved) {
+                    improved = 1;
+                    break;
+                }
+            }
+        }
+
+        fprintf(out, "round %d step %d error %.6f (%.1f s), weights", round, step, best,
+                (thread_now_ms() - start) / 1000.0);
+        print_weights(out, w);
+        fflush(out);
+        if (!improved) {
+            if (step == 1) break;
+            step /= 2;
+        }
+    }
+
+    tune_free(&set);
+    if (!ai_save_weights(w, cfg->out_path)) {
+        set_err(err, err_cap, "Cannot write the weight file.");
+        return 0;
+    }
+    fprintf(out, "Wrote %s in %.1f s\n", cfg->out_path, (thread_now_ms() - start) / 1000.0);
+    return 1;
+}
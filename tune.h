@@ -0,0 +1,34 @@
+#ifndef SIMPLE_TUNE_H
+#define SIMPLE_TUNE_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "ai.h"
+
+#define TUNE_MAX_THREADS 64
+
+typedef struct {
+    const char *out_path;
+    int threads;
+    int max_rounds;
+    int start_step;
+} TuneConfig;
+
+/* Labelled positions, one float array per evaluation term plus the
+ * result from the side to move's view (1 win, 0 loss). Arrays are
+ * contiguous so the error loop streams through them. */
+typedef struct {
+    float *term[AI_EVAL_TERMS];
+    float *label;
+    size_t count;
+    float *storage;
+} TuneSet;
+
+void tune_default_config(TuneConfig *cfg);
+int tune_load(TuneSet *set, char **files, int file_count, int threads, char *err, size_t err_cap);
+void tune_free(TuneSet *set);
+double tune_error(const TuneSet *set, const int *weights, double k, int threads);
+int tune_run(const TuneConfig *cfg, char **files, int file_count, FILE *out, char *err, size_t err_cap);
+
+#endif
@@ -0,0 +1,330 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "workload.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "thread.h"
+
+#ifdef _WIN32
+#include <psapi.h>
+#ifdef _MSC_VER
+#pragma comment(lib, "psapi.lib")
+#endif
+#else
+#include <sys/resource.h>
+#endif
+
+#define WORKLOAD_MAGIC "SIMPLE-WORKLOAD 1"
+#define WORKLOAD_NOISE_MS 1.0
+#define WORKLOAD_NOISE_KB 1024L
+
+static void set_err(char *err, size_t cap, const char *msg) {
+    if (err && cap) {
+        snprintf(err, cap, "%s", msg);
+    }
+}
+
+static void trim_newline(char *s) {
+    size_t n = strlen(s);
+    while (n > 0 && (s[n - 1] == '\n' || s[n - 1] == '\r')) {
+        s[n - 1] = '\0';
+        n--;
+    }
+}
+
+static int record_line(char *buf, int cap, void *ctx) {
+    WorkloadRecorder *r = (WorkloadRecorder *)ctx;
+    double start = thread_now_ms();
+    if (!io_read_stdin_line(buf, cap)) return 0;
+    fprintf(r->fp, "%.1f %s\n", thread_now_ms() - start, buf);
+    fflush(r->fp);
+    return 1;
+}
+
+int workload_record_start(WorkloadRecorder *r, const char *path, unsigned int seed, char *err, size_t err_cap) {
+    if (!r || !path) return 0;
+    r->fp = fopen(path, "w");
+    if (!r->fp) {
+        set_err(err, err_cap, "Cannot create workload file.");
+        return 0;
+    }
+    fprintf(r->fp, "%s\nseed %u\n", WORKLOAD_MAGIC, seed);
+    fflush(r->fp);
+    io_set_line_reader(record_line, r);
+    return 1;
+}
+
+void workload_record_stop(WorkloadRecorder *r) {
+    if (!r || !r->fp) return;
+    io_set_line_reader(NULL, NULL);
+    fclose(r->fp);
+    r->fp = NULL;
+}
+
+void workload_init(Workload *w) {
+    if (!w) return;
+    memset(w, 0, sizeof(*w));
+}
+
+void workload_free(Workload *w) {
+    if (!w) return;
+    free(w->lines);
+    free(w->wait_ms);
+    workload_init(w);
+}
+
+static int push_line(Workload *w, const char *text, double wait_ms) {
+    if (w->count == w->capacity) {
+        int cap = w->capacity ? w->capacity * 2 : 64;
+        char (*lines)[LINE_MAX_LEN] = realloc(w->lines, (size_t)cap * sizeof(*lines));
+        double *waits;
+        if (!lines) return 0;
+        w->lines = lines;
+        waits = (double *)realloc(w->wait_ms, (size_t)cap * sizeof(double));
+        if (!waits) return 0;
+        w->wait_ms = waits;
+        w->capacity = cap;
+    }
+    snprintf(w->lines[w->count], LINE_MAX_LEN, "%s", text);
+    w->wait_ms[w->count] = wait_ms;
+    w->count++;
+    return 1;
+}
+
+int workload_load(Workload *w, const char *path, char *err, size_t err_cap) {
+    FILE *fp;
+    char buf[LINE_MAX_LEN + 64];
+    Workload temp;
+
+    if (!w || !path) return 0;
+    fp = fopen(path, "r");
+    if (!fp) {
+        set_err(err, err_cap, "Cannot open workload file.");
+        return 0;
+    }
+
+    workload_init(&temp);
+    if (!fgets(buf, sizeof(buf), fp)) goto bad_file;
+    trim_newline(buf);
+    if (strcmp(buf, WORKLOAD_MAGIC) != 0) goto bad_file;
+    if (fscanf(fp, "seed %u", &temp.seed) != 1) goto bad_file;
+    if (!fgets(buf, sizeof(buf), fp)) goto bad_file;
+
+    while (fgets(buf, sizeof(buf), fp)) {
+        char *end = NULL;
+        double wait = strtod(buf, &end);
+        trim_newline(buf);
+        if (end == buf || *end != ' ') goto bad_file;
+        if (!push_line(&temp, end + 1, wait)) {
+            fclose(fp);
+            workload_free(&temp);
+            set_err(err, err_cap, "Not enough memory for the workload.");
+            return 0;
+        }
+    }
+
+    fclose(fp);
+    workload_free(w);
+    *w = temp;
+    return 1;
+
+bad_file:
+    fclose(fp);
+    workload_free(&temp);
+    set_err(err, err_cap, "Invalid workload file.");
+    return 0;
+}
+
+static void push_turn(WorkloadReplay *rp, double ms) {
+    if (rp->turns == rp->turn_capacity) {
+        int cap = rp->turn_capacity ? rp->turn_capacity * 2 : 256;
+        double *turns = (double *)realloc(rp->turn_ms, (size_t)cap * sizeof(double));
+        if (!turns) return;
+        rp->turn_ms = turns;
+        rp->turn_capacity = cap;
+    }
+    rp->turn_ms[rp->turns++] = ms;
+}
+
+/* A turn is everything the loop does between two reads: drawing, magic,
+ * parsing, the computer's reply. The time spent here is left out. */
+static int replay_line(char *buf, int cap, void *ctx) {
+    WorkloadReplay *rp = (WorkloadReplay *)ctx;
+    if (rp->mark_ms > 0.0) {
+        push_turn(rp, thread_now_ms() - rp->mark_ms);
+        rp->mark_ms = 0.0;
+    }
+    if (rp->next >= rp->w->count) return 0;
+    snprintf(buf, (size_t)cap, "%s", rp->w->lines[rp->next++]);
+    rp->mark_ms = thread_now_ms();
+    return 1;
+}
+
+void workload_replay_init(WorkloadReplay *rp, const Workload *w) {
+    if (!rp) return;
+    memset(rp, 0, sizeof(*rp));
+    rp->w = w;
+}
+
+void workload_replay_free(WorkloadReplay *rp) {
+    if (!rp) return;
+    free(rp->turn_ms);
+    memset(rp, 0, sizeof(*rp));
+}
+
+void workload_replay_start(WorkloadReplay *rp) {
+    if (!rp || !rp->w) return;
+    rp->next = 0;
+    rp->mark_ms = thread_now_ms();
+    io_set_line_reader(replay_line, rp);
+}
+
+void workload_replay_stop(WorkloadReplay *rp) {
+    if (!rp) return;
+    io_set_line_reader(NULL, NULL);
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const double *sorted, int count, int pct) {
+    int rank;
+    if (count <= 0) return 0.0;
+    rank = (pct * count + 99) / 100;
+    if (rank < 1) rank = 1;
+    return sorted[rank - 1];
+}
+
+void workload_replay_stats(const WorkloadReplay *rp, double total_ms, WorkloadStats *out) {
+    double *sorted = NULL;
+    int count;
+
+    if (!rp || !out) return;
+    memset(out, 0, sizeof(*out));
+    count = rp->turns;
+    out->total_ms = total_ms;
+    out->turns = count;
+    out->peak_rss_kb = workload_peak_rss_kb();
+    if (count == 0) return;
+
+    sorted = (double *)malloc((size_t)count * sizeof(double));
+    if (!sorted) return;
+    memcpy(sorted, rp->turn_ms, (size_t)count * sizeof(double));
+    qsort(sorted, (size_t)count, sizeof(double), compare_double);
+    out->p50_ms = percentile(sorted, count, 50);
+    out->p90_ms = percentile(sorted, count, 90);
+    out->p99_ms = percentile(sorted, count, 99);
+    out->max_ms = sorted[count - 1];
+    free(sorted);
+}
+
+long workload_peak_rss_kb(void) {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) return 0;
+    return (long)(pmc.PeakWorkingSetSize / 1024);
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+    return (long)(usage.ru_maxrss / 1024);
+#else
+    return (long)usage.ru_maxrss;
+#endif
+#endif
+}
+
+void workload_print_stats(FILE *out, const WorkloadStats *s) {
+    if (!out || !s) return;
+    fprintf(out, "turns        %d\n", s->turns);
+    fprintf(out, "total_ms     %.3f\n", s->total_ms);
+    fprintf(out, "p50_ms       %.3f\n", s->p50_ms);
+    fprintf(out, "p90_ms       %.3f\n", s->p90_ms);
+    fprintf(out, "p99_ms       %.3f\n", s->p99_ms);
+    fprintf(out, "max_ms       %.3f\n", s->max_ms);
+    fprintf(out, "peak_rss_kb  %ld\n", s->peak_rss_kb);
+}
+
+int workload_save_baseline(const char *path, const WorkloadStats *s, char *err, size_t err_cap) {
+    FILE *fp;
+    if (!path || !s) return 0;
+    fp = fopen(path, "w");
+    if (!fp) {
+        set_err(err, err_cap, "Cannot create baseline file.");
+        return 0;
+    }
+    workload_print_stats(fp, s);
+    if (fclose(fp) != 0) {
+        set_err(err, err_cap, "Failed to write baseline file.");
+        return 0;
+    }
+    return 1;
+}
+
+int workload_load_baseline(const char *path, WorkloadStats *s, char *err, size_t err_cap) {
+    FILE *fp;
+    char key[32];
+    double value;
+    int seen = 0;
+
+    if (!path || !s) return 0;
+    fp = fopen(path, "r");
+    if (!fp) {
+        set_err(err, err_cap, "Cannot open baseline file.");
+        return 0;
+    }
+
+    memset(s, 0, sizeof(*s));
+    while (fscanf(fp, "%31s %lf", key, &value) == 2) {
+        if (strcmp(key, "turns") == 0) s->turns = (int)value;
+        else if (strcmp(key, "total_ms") == 0) s->total_ms = value;
+        else if (strcmp(key, "p50_ms") == 0) s->p50_ms = value;
+        else if (strcmp(key, "p90_ms") == 0) s->p90_ms = value;
+        else if (strcmp(key, "p99_ms") == 0) s->p99_ms = value;
+        else if (strcmp(key, "max_ms") == 0) s->max_ms = value;
+        else if (strcmp(key, "peak_rss_kb") == 0) s->peak_rss_kb = (long)value;
+        else continue;
+        seen++;
+    }
+    fclose(fp);
+
+    if (seen == 0 || s->total_ms <= 0.0) {
+        set_err(err, err_cap, "Invalid baseline file.");
+        return 0;
+    }
+    return 1;
+}
+
+/* A metric regresses when it grows by more than the allowed percentage
+ * and by more than the noise floor. */
+static int check_metric(FILE *out, const char *name, double base, double now, double pct, double noise, int gated) {
+    double change = base > 0.0 ? (now - base) * 100.0 / base : 0.0;
+    int bad = gated && now - base > noise && change > pct;
+    fprintf(out, "%-12s %12.3f %12.3f %+8.1f%%%s\n", name, base, now, change, bad ? "  REGRESSION" : "");
+    return !bad;
+}
+
+int workload_compare(FILE *out, const WorkloadStats *base, const WorkloadStats *now, double max_slowdown_pct) {
+    int ok = 1;
+    if (!out || !base || !now) return 0;
+    fprintf(out, "%-12s %12s %12s %9s\n", "metric", "baseline", "now", "change");
+    ok &= check_metric(out, "total_ms", base->total_ms, now->total_ms, max_slowdown_pct, WORKLOAD_NOISE_MS, 1);
+    ok &= check_metric(out, "p50_ms", base->p50_ms, now->p50_ms, max_slowdown_pct, WORKLOAD_NOISE_MS, 0);
+    ok &= check_metric(out, "p90_ms", base->p90_ms, now->p90_ms, max_slowdown_pct, WORKLOAD_NOISE_MS, 1);
+    ok &= check_metric(out, "p99_ms", base->p99_ms, now->p99_ms, max_slowdown_pct, WORKLOAD_NOISE_MS, 0);
+    ok &= check_metric(out, "max_ms", base->max_ms, now->max_ms, max_slowdown_pct, WORKLOAD_NOISE_MS, 0);
+    ok &= check_metric(out, "peak_rss_kb", (double)base->peak_rss_kb, (double)now->peak_rss_kb,
+                       max_slowdown_pct, (double)WORKLOAD_NOISE_KB, 1);
+    if (base->turns != now->turns) {
+        fprintf(out, "Note: turn count changed (%d -> %d); the replay took a different path.\n", base->turns, now->turns);
+    }
+    fprintf(out, "%s (allowed slowdown %.1f%%)\n", ok ? "PASS" : "FAIL", max_slowdown_pct);
+    return ok;
+}
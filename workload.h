@@ -0,0 +1,65 @@
+#ifndef SIMPLE_WORKLOAD_H
+#define SIMPLE_WORKLOAD_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "io.h"
+
+#define WORKLOAD_DEFAULT_SLOWDOWN 10.0
+
+/* A recorded session: the RNG seed and every input line, with the time
+ * the player spent before typing it. */
+typedef struct {
+    unsigned int seed;
+    char (*lines)[LINE_MAX_LEN];
+    double *wait_ms;
+    int count;
+    int capacity;
+} Workload;
+
+typedef struct {
+    FILE *fp;
+} WorkloadRecorder;
+
+/* Feeds a workload to io_read_line and times the work between reads;
+ * one sample per turn, kept across runs. */
+typedef struct {
+    const Workload *w;
+    int next;
+    double mark_ms;
+    double *turn_ms;
+    int turns;
+    int turn_capacity;
+} WorkloadReplay;
+
+typedef struct {
+    double total_ms;
+    double p50_ms;
+    double p90_ms;
+    double p99_ms;
+    double max_ms;
+    long peak_rss_kb;
+    int turns;
+} WorkloadStats;
+
+int workload_record_start(WorkloadRecorder *r, const char *path, unsigned int seed, char *err, size_t err_cap);
+void workload_record_stop(WorkloadRecorder *r);
+
+void workload_init(Workload *w);
+void workload_free(Workload *w);
+int workload_load(Workload *w, const char *path, char *err, size_t err_cap);
+
+void workload_replay_init(WorkloadReplay *rp, const Workload *w);
+void workload_replay_free(WorkloadReplay *rp);
+void workload_replay_start(WorkloadReplay *rp);
+void workload_replay_stop(WorkloadReplay *rp);
+void workload_replay_stats(const WorkloadReplay *rp, double total_ms, WorkloadStats *out);
+
+long workload_peak_rss_kb(void);
+void workload_print_stats(FILE *out, const WorkloadStats *s);
+int workload_save_baseline(const char *path, const WorkloadStats *s, char *err, size_t err_cap);
+int workload_load_baseline(const char *path, WorkloadStats *s, char *err, size_t err_cap);
+int workload_compare(FILE *out, const WorkloadStats *base, const WorkloadStats *now, double max_slowdown_pct);
+
+#endif